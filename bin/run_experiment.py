@@ -12,11 +12,13 @@ flags.mark_flag_as_required('exe_dir')
 flags.DEFINE_string("a", None, "The experiment parameters.")
 flags.mark_flag_as_required('a')
 flags.DEFINE_string('sif', None, "Run experiments through the given Singularity container.")
+flags.DEFINE_string('tree_cache_dir', None, "Reuse compiled game trees from this directory.")
 
 
 def run_experiment(_):
   x_params = xp.ExperimentParameters(flags.FLAGS.a)
-  command = x_params.command(flags.FLAGS.exe_dir, flags.FLAGS.sif)
+  command = x_params.command(flags.FLAGS.exe_dir, flags.FLAGS.sif,
+                             flags.FLAGS.tree_cache_dir)
   print(command, file=sys.stderr, flush=True)
   os.system(command)
 
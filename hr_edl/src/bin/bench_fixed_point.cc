@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/flags/usage.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "hr_edl/action_transformation.h"
+#include "hr_edl/stopwatch.h"
+#include "open_spiel/spiel_utils.h"
+
+ABSL_FLAG(std::string, num_actions, "2;3;4;5;8;13",
+          "Semicolon-separated action counts to benchmark.");
+ABSL_FLAG(size_t, num_transformations, 256,
+          "The number of random transformations per action count.");
+ABSL_FLAG(size_t, repetitions, 10,
+          "The number of times each transformation's fixed point is timed.");
+ABSL_FLAG(size_t, random_seed, 0, "Seed for the transformations' weights.");
+
+void run_experiment() {
+  const size_t num_transformations = absl::GetFlag(FLAGS_num_transformations);
+  const size_t repetitions = absl::GetFlag(FLAGS_repetitions);
+  std::mt19937 engine(absl::GetFlag(FLAGS_random_seed));
+  std::uniform_real_distribution<double> weight(0, 1);
+  hr_edl::Stopwatch stop_watch;
+
+  std::cout << "# num_actions  fixed_point_us  batch_us  svd_us  speedup  "
+               "max_abs_diff"
+            << std::endl;
+  const std::vector<std::string> action_counts =
+      absl::StrSplit(absl::GetFlag(FLAGS_num_actions), ';');
+  for (const std::string& action_count : action_counts) {
+    size_t num_actions;
+    SPIEL_CHECK_TRUE(absl::SimpleAtoi(action_count, &num_actions));
+    const auto internal_transformations =
+        hr_edl::SwapActionTranformation::Internal(num_actions);
+    const auto external_transformations =
+        hr_edl::SwapActionTranformation::External(num_actions);
+    // Like the sums of a learner with both internal and external deviations.
+    std::vector<hr_edl::WeightedActionTransformation> sums(
+        num_transformations, hr_edl::WeightedActionTransformation(num_actions));
+    for (auto& sum : sums) {
+      for (const auto& phi : internal_transformations) {
+        sum.Add(phi, weight(engine));
+      }
+      for (const auto& phi : external_transformations) {
+        sum.Add(phi, weight(engine));
+      }
+    }
+
+    std::vector<double> pi(num_actions);
+    std::vector<double> svd_pi(num_actions);
+    double fixed_point_us = 0;
+    double svd_us = 0;
+    double max_abs_diff = 0;
+    hr_edl::FixedPointBatch batch(num_actions);
+    std::vector<double> batch_pis(num_transformations * num_actions);
+    double batch_us = 0;
+    for (size_t r = 0; r < repetitions; ++r) {
+      stop_watch.reset();
+      for (size_t i = 0; i < num_transformations; ++i) {
+        batch.Add(sums[i], batch_pis.data() + i * num_actions);
+      }
+      batch.Solve();
+      batch_us += stop_watch.fractional_microseconds();
+
+      for (size_t i = 0; i < num_transformations; ++i) {
+        const auto& sum = sums[i];
+        stop_watch.reset();
+        sum.FixedPoint(pi);
+        fixed_point_us += stop_watch.fractional_microseconds();
+
+        stop_watch.reset();
+        sum.SvdFixedPoint(svd_pi.data());
+        svd_us += stop_watch.fractional_microseconds();
+
+        for (size_t a = 0; a < num_actions; ++a) {
+          max_abs_diff = std::max(max_abs_diff, std::abs(pi[a] - svd_pi[a]));
+          max_abs_diff = std::max(
+              max_abs_diff,
+              std::abs(batch_pis[i * num_actions + a] - svd_pi[a]));
+        }
+      }
+    }
+    const double num_solves = repetitions * num_transformations;
+    std::cout << absl::StrFormat(
+                     "%u  %g  %g  %g  %g  %g", num_actions,
+                     fixed_point_us / num_solves, batch_us / num_solves,
+                     svd_us / num_solves, svd_us / fixed_point_us, max_abs_diff)
+              << std::endl;
+  }
+}
+
+int main(int argc, char** argv) {
+  absl::SetProgramUsageMessage(
+      "Time WeightedActionTransformation::FixedPoint and FixedPointBatch "
+      "against the SVD solve that they replace, on random transformations "
+      "with internal and external deviations.");
+  absl::ParseCommandLine(argc, argv);
+  run_experiment();
+}
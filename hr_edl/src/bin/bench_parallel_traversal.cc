@@ -0,0 +1,95 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/flags/usage.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "hr_edl/decision_point.h"
+#include "hr_edl/policy.h"
+#include "hr_edl/policy_evaluation.h"
+#include "hr_edl/stopwatch.h"
+#include "open_spiel/game_transforms/turn_based_simultaneous_game.h"
+#include "open_spiel/spiel.h"
+
+ABSL_FLAG(std::string, games,
+          "leduc_poker;goofspiel(imp_info=True,num_cards=5,points_order="
+          "descending)",
+          "Semicolon-separated games to benchmark.");
+ABSL_FLAG(std::string, threads, "1;2;4;8",
+          "Semicolon-separated thread counts to benchmark.");
+ABSL_FLAG(size_t, task_depth, hr_edl::kDefaultTaskDepth,
+          "The depth at which traversals are split into tasks.");
+ABSL_FLAG(size_t, repetitions, 10, "The number of timed traversals.");
+
+void run_experiment() {
+  const size_t repetitions = absl::GetFlag(FLAGS_repetitions);
+  const size_t task_depth = absl::GetFlag(FLAGS_task_depth);
+  const hr_edl::MapPolicy profile = hr_edl::UniformRandomPolicy();
+  hr_edl::Stopwatch stop_watch;
+
+  std::cout << "# game  threads  policy_value_ms  cf_value_tree_ms  "
+               "matches_one_thread"
+            << std::endl;
+  const std::vector<std::string> game_names =
+      absl::StrSplit(absl::GetFlag(FLAGS_games), ';');
+  const std::vector<std::string> thread_counts =
+      absl::StrSplit(absl::GetFlag(FLAGS_threads), ';');
+  for (const std::string& game_name : game_names) {
+    const std::shared_ptr<const open_spiel::Game> game =
+        open_spiel::LoadGameAsTurnBased(game_name);
+    hr_edl::CompiledDecisionPoint root(game->NewInitialState(), false, false,
+                                       false);
+    std::vector<double> one_thread_values;
+    for (const std::string& thread_count : thread_counts) {
+      size_t num_threads;
+      SPIEL_CHECK_TRUE(absl::SimpleAtoi(thread_count, &num_threads));
+      std::vector<hr_edl::PolicyCfValueTreeEvaluator> evaluators;
+      for (int player = 0; player < root.NumPlayers(); ++player) {
+        evaluators.emplace_back(player);
+      }
+
+      std::vector<double> values;
+      double policy_value_ms = 0;
+      double cf_value_tree_ms = 0;
+      for (size_t r = 0; r < repetitions; ++r) {
+        values.clear();
+        for (int player = 0; player < root.NumPlayers(); ++player) {
+          stop_watch.reset();
+          values.push_back(hr_edl::PolicyValueInParallel(
+                               root, player, profile, num_threads, task_depth)
+                               .first);
+          policy_value_ms += stop_watch.fractional_milliseconds();
+
+          stop_watch.reset();
+          values.push_back(
+              evaluators[player]
+                  .ComputeCfValueTreeEvaluationInParallel(
+                      root, profile, num_threads, task_depth)
+                  .ev_);
+          cf_value_tree_ms += stop_watch.fractional_milliseconds();
+        }
+      }
+      if (one_thread_values.empty()) {
+        one_thread_values = values;
+      }
+      std::cout << absl::StrFormat("%s  %u  %g  %g  %d", game_name,
+                                   num_threads, policy_value_ms / repetitions,
+                                   cf_value_tree_ms / repetitions,
+                                   values == one_thread_values)
+                << std::endl;
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  absl::SetProgramUsageMessage(
+      "Time parallel policy value and counterfactual value tree evaluations "
+      "on each number of threads. `matches_one_thread` reports whether the "
+      "values are identical to those computed with the first thread count.");
+  absl::ParseCommandLine(argc, argv);
+  run_experiment();
+}
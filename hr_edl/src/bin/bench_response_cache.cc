@@ -0,0 +1,87 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/flags/usage.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "hr_edl/decision_point.h"
+#include "hr_edl/policy.h"
+#include "hr_edl/policy_evaluation.h"
+#include "hr_edl/samplers.h"
+#include "hr_edl/stopwatch.h"
+#include "open_spiel/game_transforms/turn_based_simultaneous_game.h"
+#include "open_spiel/spiel.h"
+
+ABSL_FLAG(std::string, games,
+          "kuhn_poker;leduc_poker;goofspiel(imp_info=True,num_cards=5,"
+          "points_order=descending)",
+          "Semicolon-separated games to benchmark.");
+ABSL_FLAG(std::string, samplers, "null",
+          "Semicolon-separated samplers to benchmark.");
+ABSL_FLAG(size_t, repetitions, 10, "The number of timed traversals.");
+ABSL_FLAG(size_t, random_seed, 0, "Seed for a sampler's random engine.");
+
+void run_experiment() {
+  const size_t repetitions = absl::GetFlag(FLAGS_repetitions);
+  const int random_seed = absl::GetFlag(FLAGS_random_seed);
+  const hr_edl::MapPolicy profile = hr_edl::UniformRandomPolicy();
+  hr_edl::Stopwatch stop_watch;
+
+  std::cout << "# game  sampler  decision_histories  responses  hits  "
+               "hit_rate  cf_value_tree_ms"
+            << std::endl;
+  const std::vector<std::string> game_names =
+      absl::StrSplit(absl::GetFlag(FLAGS_games), ';');
+  const std::vector<std::string> sampler_names =
+      absl::StrSplit(absl::GetFlag(FLAGS_samplers), ';');
+  for (const std::string& game_name : game_names) {
+    const std::shared_ptr<const open_spiel::Game> game =
+        open_spiel::LoadGameAsTurnBased(game_name);
+    hr_edl::CompiledDecisionPoint root(game->NewInitialState(), false, false,
+                                       false);
+    for (const std::string& sampler_name : sampler_names) {
+      hr_edl::MccfrSamplerPtr sampler =
+          hr_edl::NewSampler(sampler_name, random_seed);
+      std::vector<hr_edl::PolicyCfValueTreeEvaluator> evaluators;
+      for (int player = 0; player < root.NumPlayers(); ++player) {
+        evaluators.emplace_back(player);
+      }
+
+      size_t num_decision_histories = 0;
+      double cf_value_tree_ms = 0;
+      for (size_t r = 0; r < repetitions; ++r) {
+        for (auto& evaluator : evaluators) {
+          stop_watch.reset();
+          num_decision_histories +=
+              evaluator.ComputeCfValueTreeEvaluation(root, profile, *sampler)
+                  .num_histories_;
+          cf_value_tree_ms += stop_watch.fractional_milliseconds();
+        }
+      }
+      hr_edl::ResponseCacheStats stats;
+      for (const auto& evaluator : evaluators) {
+        stats += evaluator.ResponseStats();
+      }
+      std::cout << absl::StrFormat(
+                       "%s  %s  %u  %u  %u  %g  %g", game_name, sampler_name,
+                       num_decision_histories / repetitions,
+                       stats.misses / repetitions,
+                       stats.hits / repetitions, stats.HitRate(),
+                       cf_value_tree_ms / repetitions)
+                << std::endl;
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  absl::SetProgramUsageMessage(
+      "Report how often counterfactual value tree evaluations reuse a "
+      "policy's response to an information set within a traversal. "
+      "`responses` counts the responses the policy computed and `hits` the "
+      "histories that reused one.");
+  absl::ParseCommandLine(argc, argv);
+  run_experiment();
+}
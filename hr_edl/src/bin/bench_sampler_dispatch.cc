@@ -0,0 +1,90 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/flags/usage.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "hr_edl/decision_point.h"
+#include "hr_edl/policy.h"
+#include "hr_edl/policy_evaluation.h"
+#include "hr_edl/samplers.h"
+#include "hr_edl/stopwatch.h"
+#include "open_spiel/game_transforms/turn_based_simultaneous_game.h"
+#include "open_spiel/spiel.h"
+
+ABSL_FLAG(std::string, games,
+          "leduc_poker;goofspiel(imp_info=True,num_cards=5,points_order="
+          "descending)",
+          "Semicolon-separated games to benchmark.");
+ABSL_FLAG(std::string, samplers, "null",
+          "Semicolon-separated samplers to benchmark.");
+ABSL_FLAG(size_t, repetitions, 10, "The number of timed traversals.");
+ABSL_FLAG(size_t, random_seed, 0, "Seed for a sampler's random engine.");
+
+void run_experiment() {
+  const size_t repetitions = absl::GetFlag(FLAGS_repetitions);
+  const int random_seed = absl::GetFlag(FLAGS_random_seed);
+  const hr_edl::UniformPolicy profile;
+  hr_edl::Stopwatch stop_watch;
+
+  std::cout << "# game  sampler  dispatch  policy_value_ms  cf_regrets_ms  "
+               "cf_value_tree_ms"
+            << std::endl;
+  const std::vector<std::string> game_names =
+      absl::StrSplit(absl::GetFlag(FLAGS_games), ';');
+  const std::vector<std::string> sampler_names =
+      absl::StrSplit(absl::GetFlag(FLAGS_samplers), ';');
+  for (const std::string& game_name : game_names) {
+    const std::shared_ptr<const open_spiel::Game> game =
+        open_spiel::LoadGameAsTurnBased(game_name);
+    hr_edl::CompiledDecisionPoint root(game->NewInitialState(), false, false,
+                                       false);
+    for (const std::string& sampler_name : sampler_names) {
+      for (const bool specialized : {true, false}) {
+        hr_edl::MccfrSamplerPtr concrete_sampler =
+            hr_edl::NewSampler(sampler_name, random_seed);
+        hr_edl::VirtualSampler virtual_sampler(*concrete_sampler);
+        hr_edl::MccfrSampler& sampler =
+            specialized ? *concrete_sampler : virtual_sampler;
+
+        double policy_value_ms = 0;
+        double cf_regrets_ms = 0;
+        double cf_value_tree_ms = 0;
+        for (size_t r = 0; r < repetitions; ++r) {
+          for (int player = 0; player < root.NumPlayers(); ++player) {
+            stop_watch.reset();
+            hr_edl::PolicyValue(root, player, profile, sampler);
+            policy_value_ms += stop_watch.fractional_milliseconds();
+
+            stop_watch.reset();
+            hr_edl::PolicyCounterfactualRegrets(root, player, profile, sampler);
+            cf_regrets_ms += stop_watch.fractional_milliseconds();
+
+            hr_edl::PolicyCfValueTreeEvaluator evaluator(player);
+            stop_watch.reset();
+            evaluator.ComputeCfValueTreeEvaluation(root, profile, sampler);
+            cf_value_tree_ms += stop_watch.fractional_milliseconds();
+          }
+        }
+        std::cout << absl::StrFormat(
+                         "%s  %s  %s  %g  %g  %g", game_name, sampler_name,
+                         specialized ? "specialized" : "virtual",
+                         policy_value_ms / repetitions,
+                         cf_regrets_ms / repetitions,
+                         cf_value_tree_ms / repetitions)
+                  << std::endl;
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  absl::SetProgramUsageMessage(
+      "Time policy evaluations with evaluators specialized on the concrete "
+      "sampler and with virtual sampler calls.");
+  absl::ParseCommandLine(argc, argv);
+  run_experiment();
+}
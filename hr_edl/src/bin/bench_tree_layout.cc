@@ -0,0 +1,132 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/flags/usage.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "hr_edl/decision_point.h"
+#include "hr_edl/policy.h"
+#include "hr_edl/policy_evaluation.h"
+#include "hr_edl/samplers.h"
+#include "hr_edl/stopwatch.h"
+#include "open_spiel/game_transforms/turn_based_simultaneous_game.h"
+#include "open_spiel/spiel.h"
+
+ABSL_FLAG(std::string, games,
+          "leduc_poker;goofspiel(imp_info=True,num_cards=5,points_order="
+          "descending)",
+          "Semicolon-separated games to benchmark.");
+ABSL_FLAG(size_t, repetitions, 10, "The number of timed traversals.");
+ABSL_FLAG(size_t, flush_mb, 64,
+          "Megabytes of memory to overwrite before each timed traversal so "
+          "that it starts with a cold cache. Zero disables flushing.");
+
+// The first player's expected return under uniform play, which visits every
+// history with little work per history.
+double UniformValue(hr_edl::DecisionPoint& decision_point) {
+  if (decision_point.IsTerminal()) {
+    return decision_point.ReturnsRef()[0];
+  }
+  const size_t num_actions = decision_point.NumActions();
+  double value = 0;
+  for (size_t a = 0; a < num_actions; ++a) {
+    for (size_t outcome = 0; outcome < decision_point.NumOutcomes(a);
+         ++outcome) {
+      const double prob = decision_point.OutcomeProbabilitiesRef(a)[outcome];
+      decision_point.Apply(a, outcome);
+      value += prob * UniformValue(decision_point);
+      decision_point.Undo();
+    }
+  }
+  return value / num_actions;
+}
+
+void FlushCache(std::vector<char>& buffer) {
+  for (size_t i = 0; i < buffer.size(); i += 64) {
+    ++buffer[i];
+  }
+}
+
+void run_experiment() {
+  const size_t repetitions = absl::GetFlag(FLAGS_repetitions);
+  std::vector<char> flush_buffer(absl::GetFlag(FLAGS_flush_mb) << 20);
+  const std::vector<std::pair<std::string, hr_edl::TreeLayout>> layouts = {
+      {"siblings_first", hr_edl::TreeLayout::kSiblingsFirst},
+      {"pre_order", hr_edl::TreeLayout::kPreOrder},
+      {"blocked", hr_edl::TreeLayout::kBlocked}};
+  const hr_edl::UniformPolicy profile;
+  hr_edl::NullSampler sampler;
+  hr_edl::Stopwatch stop_watch;
+
+  std::cout << "# game  layout  num_histories  traversal_ms  cf_value_tree_ms  "
+               "policy_value_ms  memoised_decision_histories"
+            << std::endl;
+  const std::vector<std::string> game_names =
+      absl::StrSplit(absl::GetFlag(FLAGS_games), ';');
+  for (const std::string& game_name : game_names) {
+    const std::shared_ptr<const open_spiel::Game> game =
+        open_spiel::LoadGameAsTurnBased(game_name);
+    const hr_edl::CompiledDecisionPoint compiled(game->NewInitialState(),
+                                                 false, false, false);
+    std::vector<std::pair<std::string, hr_edl::CompiledDecisionPoint>> roots;
+    for (const auto& [label, layout] : layouts) {
+      roots.emplace_back(label, compiled.Relaid(layout));
+    }
+    // The undo stack that merged trees need, on an ordinary tree, to compare
+    // with the `parent_` reads that ordinary trees use.
+    roots.emplace_back("siblings_first_undo_stack",
+                       roots[0].second.WithUndoStack());
+    roots.emplace_back("merged", compiled.Merged());
+    for (auto& [label, root] : roots) {
+      double traversal_ms = 0;
+      double cf_value_tree_ms = 0;
+      double policy_value_ms = 0;
+      // Decision histories whose visits `PolicyValue` saved by memoising
+      // subtree values, summed over players. Only merged trees save any.
+      int num_memoised = 0;
+      for (size_t r = 0; r < repetitions; ++r) {
+        FlushCache(flush_buffer);
+        stop_watch.reset();
+        UniformValue(root);
+        traversal_ms += stop_watch.fractional_milliseconds();
+
+        for (int player = 0; player < root.NumPlayers(); ++player) {
+          hr_edl::PolicyCfValueTreeEvaluator evaluator(player);
+          FlushCache(flush_buffer);
+          stop_watch.reset();
+          evaluator.ComputeCfValueTreeEvaluation(root, profile, sampler);
+          cf_value_tree_ms += stop_watch.fractional_milliseconds();
+        }
+
+        num_memoised = 0;
+        for (int player = 0; player < root.NumPlayers(); ++player) {
+          hr_edl::PolicyValueEvaluator evaluator(player, profile, sampler,
+                                                 root.NumPlayers());
+          FlushCache(flush_buffer);
+          stop_watch.reset();
+          evaluator(root, 1.0, 0);
+          policy_value_ms += stop_watch.fractional_milliseconds();
+          num_memoised += evaluator.num_memoised_decision_histories_;
+        }
+      }
+      std::cout << absl::StrFormat(
+                       "%s  %s  %u  %g  %g  %g  %d", game_name, label,
+                       root.NumHistories(), traversal_ms / repetitions,
+                       cf_value_tree_ms / repetitions,
+                       policy_value_ms / repetitions, num_memoised)
+                << std::endl;
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  absl::SetProgramUsageMessage(
+      "Time tree traversals, counterfactual value tree evaluations, and "
+      "policy evaluations under each compiled tree layout, with an undo "
+      "stack, and with equivalent subtrees merged.");
+  absl::ParseCommandLine(argc, argv);
+  run_experiment();
+}
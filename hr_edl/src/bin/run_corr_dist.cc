@@ -41,7 +41,7 @@ void run_experiment() {
           "efg_game", {{"filename", open_spiel::GameParameter(
                                         absl::GetFlag(FLAGS_efg_file))}});
   const int iterations = absl::GetFlag(FLAGS_t);
-  hr_edl::CachedDecisionPoint root(game->NewInitialState());
+  hr_edl::CompiledDecisionPoint root(game->NewInitialState());
 
   const hr_edl::MultiplicativeCheckpointMarker report_marker(
       absl::GetFlag(FLAGS_report_gap_factor), absl::GetFlag(FLAGS_report_skip));
@@ -49,7 +49,7 @@ void run_experiment() {
   auto print_gaps_for_learner = [&report_marker, &game, &root_template = root,
                                  iterations](
                                     hr_edl::AdaptiveProfile&& learner) {
-    hr_edl::CachedDecisionPoint root(root_template);
+    hr_edl::CompiledDecisionPoint root(root_template);
     hr_edl::NullSampler sampler;
     open_spiel::algorithms::CorrDevBuilder cd_builder;
     const open_spiel::algorithms::CorrDistConfig config;
@@ -38,6 +38,17 @@ ABSL_FLAG(size_t, alg_group, 0,
 // Parallelism
 ABSL_FLAG(size_t, threads, 1, "The number of threads to use.");
 
+// Tree cache
+ABSL_FLAG(std::string, tree_cache_dir, "",
+          "A directory of compiled game trees to reuse between runs. Empty "
+          "disables the cache.");
+ABSL_FLAG(size_t, tree_capacity, 0,
+          "If positive, expand the game tree lazily and hold at most about "
+          "this many histories per thread instead of compiling it.");
+ABSL_FLAG(bool, merge_subtrees, false,
+          "Store equivalent subtrees of the compiled game tree once, so that "
+          "exhaustive policy evaluations compute each subtree's value once.");
+
 void run_experiment() {
   const bool show_num = absl::GetFlag(FLAGS_show_num);
   const size_t alg_group = absl::GetFlag(FLAGS_alg_group);
@@ -52,8 +63,6 @@ void run_experiment() {
   const std::shared_ptr<const open_spiel::Game> game =
       open_spiel::LoadGameAsTurnBased(game_name);
 
-  const std::unique_ptr<open_spiel::State> root_state = game->NewInitialState();
-
   const int random_seed = absl::GetFlag(FLAGS_random_seed);
   const size_t iterations = absl::GetFlag(FLAGS_t);
 
@@ -90,12 +99,30 @@ void run_experiment() {
 
   std::queue<std::thread> threads;
 
-  hr_edl::CachedDecisionPoint root(root_state->Clone(), false, true);
+  const size_t tree_capacity = absl::GetFlag(FLAGS_tree_capacity);
+  std::unique_ptr<hr_edl::CompiledDecisionPoint> compiled_root;
+  if (tree_capacity == 0) {
+    compiled_root = hr_edl::LoadOrCompileTree(
+        *game, absl::GetFlag(FLAGS_tree_cache_dir), num_threads);
+    if (absl::GetFlag(FLAGS_merge_subtrees)) {
+      compiled_root = std::make_unique<hr_edl::CompiledDecisionPoint>(
+          compiled_root->Merged());
+    }
+  }
+  const auto new_root = [&game, &compiled_root, tree_capacity]()
+      -> std::unique_ptr<hr_edl::DecisionPoint> {
+    if (compiled_root) {
+      return std::make_unique<hr_edl::CompiledDecisionPoint>(*compiled_root);
+    }
+    return std::make_unique<hr_edl::CachedDecisionPoint>(
+        game->NewInitialState(), false, false, tree_capacity);
+  };
   for (size_t col_alg = 0; col_alg < col_learner_profiles.size(); ++col_alg) {
     const auto f = [&stop_watch, &milliseconds, &expected_values,
-                    &col_learner_profiles, &root_template = root, &sampler,
+                    &col_learner_profiles, &new_root, &sampler,
                     &labeled_algs, col_alg, iterations, utility_diameter] {
-      hr_edl::CachedDecisionPoint root(root_template);
+      const auto root_ptr = new_root();
+      hr_edl::DecisionPoint& root = *root_ptr;
       std::vector<hr_edl::AdaptiveProfilePtr> row_algs;
       for (size_t row_alg = 0; row_alg < col_learner_profiles.size() + 1;
            ++row_alg) {
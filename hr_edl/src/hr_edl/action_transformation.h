@@ -1,7 +1,11 @@
 #ifndef HR_EDL_ACTION_TRANSFORMATION_H_
 #define HR_EDL_ACTION_TRANSFORMATION_H_
 
+#include <algorithm>
 #include <cassert>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include "eigen/Eigen/Dense"
 #include "hr_edl/math.h"
@@ -98,28 +102,80 @@ class SwapActionTranformation {
 };
 using Sat = SwapActionTranformation;
 
+// Writes the regrets of the transformations in
+// `SwapActionTranformation::External(cfvs.Size())` against `policy` to
+// `out`, in order, without building them.
+inline void ExternalRegrets(const CfValues& cfvs, const double* policy,
+                            double* out) {
+  const size_t num_actions = cfvs.Size();
+  double policy_sum = 0;
+  for (size_t a = 0; a < num_actions; ++a) {
+    policy_sum += policy[a];
+  }
+  for (size_t a = 0; a < num_actions; ++a) {
+    out[a] = cfvs[a] * policy_sum - cfvs();
+  }
+}
+
+// Writes the regrets of the transformations in
+// `SwapActionTranformation::Internal(cfvs.Size())` against `policy` to `out`,
+// in order. A swap from `a1` to `a2` only moves `a1`'s probability, so its
+// regret is the regret of `policy` plus `policy[a1] * (cfvs[a2] - cfvs[a1])`.
+inline void InternalRegrets(const CfValues& cfvs, const double* policy,
+                            double* out) {
+  const size_t num_actions = cfvs.Size();
+  double policy_value = 0;
+  for (size_t a = 0; a < num_actions; ++a) {
+    policy_value += cfvs[a] * policy[a];
+  }
+  const double policy_regret = policy_value - cfvs();
+  size_t i = 0;
+  for (size_t a1 = 0; a1 < num_actions; ++a1) {
+    for (size_t a2 = 0; a2 < num_actions; ++a2) {
+      if (a1 != a2) {
+        out[i] = policy_regret + policy[a1] * (cfvs[a2] - cfvs[a1]);
+        ++i;
+      }
+    }
+  }
+}
+
 class WeightedActionTransformation {
  private:
-  inline static Eigen::MatrixXd ProjectiveEye(size_t num_actions) {
-    Eigen::MatrixXd a =
-        -Eigen::MatrixXd::Identity(num_actions + 1, num_actions);
-    a.row(num_actions) = Eigen::VectorXd::Constant(num_actions, 1.0);
-    return a;
-  }
-  inline static Eigen::VectorXd BVector(size_t num_actions) {
-    Eigen::VectorXd b = Eigen::VectorXd::Zero(num_actions + 1);
-    b(num_actions) = 1.0;
-    return b;
+  // The least-squares system that `SvdFixedPoint` solves, minus the
+  // transformation. It only depends on the number of actions.
+  struct ProjectiveSystem {
+    ProjectiveSystem(size_t num_actions)
+        : eye_(-Eigen::MatrixXd::Identity(num_actions + 1, num_actions)),
+          b_(Eigen::VectorXd::Zero(num_actions + 1)) {
+      eye_.row(num_actions) = Eigen::VectorXd::Constant(num_actions, 1.0);
+      b_(num_actions) = 1.0;
+    }
+    Eigen::MatrixXd eye_;
+    Eigen::VectorXd b_;
+  };
+  // Shared by every transformation with `num_actions` actions.
+  static const ProjectiveSystem* InternedProjectiveSystem(size_t num_actions) {
+    static std::mutex mutex;
+    static std::vector<std::unique_ptr<const ProjectiveSystem>> systems;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (systems.size() <= num_actions) {
+      systems.resize(num_actions + 1);
+    }
+    if (!systems[num_actions]) {
+      systems[num_actions].reset(new ProjectiveSystem(num_actions));
+    }
+    return systems[num_actions].get();
   }
 
  public:
   WeightedActionTransformation(size_t num_actions)
       : weight_sum_(0),
+        identity_weight_(0),
         weighted_phi_blocks_(Eigen::MatrixXd::Zero(num_actions, num_actions)),
         weighted_external_blocks_(Eigen::VectorXd::Zero(num_actions)),
         all_external_(true),
-        projective_eye_(ProjectiveEye(num_actions)),
-        b_(BVector(num_actions)) {}
+        projective_system_(InternedProjectiveSystem(num_actions)) {}
   virtual ~WeightedActionTransformation() = default;
 
   void Add(const Sat& phi, double weight = 1.0) {
@@ -134,8 +190,31 @@ class WeightedActionTransformation {
     }
   }
 
+  // Adds the transformation that always chooses `action`, like
+  // `Add(SwapActionTranformation::External(NumActions())[action], weight)`.
+  void AddExternal(size_t action, double weight = 1.0) {
+    weight_sum_ += weight;
+    weighted_external_blocks_(action) += weight;
+  }
+  // Adds the swap from `from` to `to`, in constant time rather than the
+  // number of actions.
+  void AddInternal(size_t from, size_t to, double weight = 1.0) {
+    if (NumActions() == 2) {
+      AddExternal(to, weight);  // Swapping one of two actions is external.
+      return;
+    }
+    weight_sum_ += weight;
+    all_external_ = false;
+    identity_weight_ += weight;
+    weighted_phi_blocks_(from, from) -= weight;
+    weighted_phi_blocks_(to, from) += weight;
+  }
+
   Eigen::MatrixXd ToMatrix() const {
-    return weighted_phi_blocks_.colwise() + weighted_external_blocks_;
+    Eigen::MatrixXd matrix =
+        weighted_phi_blocks_.colwise() + weighted_external_blocks_;
+    matrix.diagonal().array() += identity_weight_;
+    return matrix;
   }
 
   std::vector<double> FixedPoint() const {
@@ -145,39 +224,240 @@ class WeightedActionTransformation {
   }
 
   void FixedPoint(std::vector<double>& pi_mem) const {
+    pi_mem.resize(NumActions());
+    FixedPoint(pi_mem.data());
+  }
+  void FixedPoint(double* pi_mem) const {
     if (weight_sum_ > 0) {
-      Eigen::Map<Eigen::VectorXd> pi(pi_mem.data(), NumActions());
       if (all_external_) {
+        Eigen::Map<Eigen::VectorXd> pi(pi_mem, NumActions());
         pi = weighted_external_blocks_ / weight_sum_;
-      } else {
-        Eigen::MatrixXd A = projective_eye_;
-        A.topRows(NumActions()) += ToMatrix() / weight_sum_;
-        pi = (A.jacobiSvd(Eigen::ComputeThinU | Eigen::ComputeThinV).solve(b_))
-                 .cwiseMax(0)
-                 .cwiseMin(1.0);
+      } else if (!StationaryDistribution(pi_mem)) {
+        SvdFixedPoint(pi_mem);
       }
     } else {
-      pi_mem.assign(NumActions(), 1.0 / NumActions());
+      std::fill_n(pi_mem, NumActions(), 1.0 / NumActions());
     }
   }
 
+  // The fixed point as the least-squares solution of the projective system,
+  // computed with an SVD. `FixedPoint` only falls back to this when the
+  // transformation's Markov chain is reducible. Requires a positive weight
+  // sum.
+  void SvdFixedPoint(double* pi_mem) const {
+    Eigen::Map<Eigen::VectorXd> pi(pi_mem, NumActions());
+    Eigen::MatrixXd A = projective_system_->eye_;
+    A.topRows(NumActions()) += ToMatrix() / weight_sum_;
+    pi = (A.jacobiSvd(Eigen::ComputeThinU | Eigen::ComputeThinV)
+              .solve(projective_system_->b_))
+             .cwiseMax(0)
+             .cwiseMin(1.0);
+  }
+
   double WeightSum() const { return weight_sum_; }
 
   void Reset() {
     weight_sum_ = 0;
+    all_external_ = true;
+    identity_weight_ = 0;
     weighted_phi_blocks_.setZero();
     weighted_external_blocks_.setZero();
   }
 
   size_t NumActions() const { return weighted_phi_blocks_.rows(); }
 
+ private:
+  friend class FixedPointBatch;
+
+  // Writes the stationary distribution of the Markov chain that moves from
+  // action `a` to action `b` in proportion to `ToMatrix()(b, a)` to `pi`.
+  //
+  // Uses the Grassmann-Taksar-Heyman algorithm, which eliminates actions
+  // from last to first and only adds, multiplies, and divides nonnegative
+  // numbers, so it is accurate without pivoting. With two actions it reduces
+  // to the closed form. Self-transitions, including `identity_weight_`, do
+  // not affect the result. Returns false if an eliminated action cannot reach
+  // the remaining ones, i.e., if the chain is reducible and its stationary
+  // distribution may not be unique.
+  bool StationaryDistribution(double* pi) const {
+    const size_t n = NumActions();
+    // Row-major transition weights, which need not be normalized.
+    double p[n * n];
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t j = 0; j < n; ++j) {
+        p[i * n + j] =
+            weighted_phi_blocks_(j, i) + weighted_external_blocks_(j);
+      }
+    }
+    for (size_t k = n - 1; k > 0; --k) {
+      double exit_weight = 0;
+      for (size_t j = 0; j < k; ++j) {
+        exit_weight += p[k * n + j];
+      }
+      if (!(exit_weight > 0)) {
+        return false;
+      }
+      for (size_t i = 0; i < k; ++i) {
+        const double p_ik = p[i * n + k] / exit_weight;
+        p[i * n + k] = p_ik;
+        for (size_t j = 0; j < k; ++j) {
+          p[i * n + j] += p_ik * p[k * n + j];
+        }
+      }
+    }
+    double total = 1;
+    pi[0] = 1;
+    for (size_t k = 1; k < n; ++k) {
+      double pi_k = 0;
+      for (size_t i = 0; i < k; ++i) {
+        pi_k += pi[i] * p[i * n + k];
+      }
+      pi[k] = pi_k;
+      total += pi_k;
+    }
+    for (size_t k = 0; k < n; ++k) {
+      pi[k] /= total;
+    }
+    return true;
+  }
+
  private:
   double weight_sum_;
+  // Added to the diagonal of `weighted_phi_blocks_` so that swaps can be
+  // added without touching every action.
+  double identity_weight_;
   Eigen::MatrixXd weighted_phi_blocks_;
   Eigen::VectorXd weighted_external_blocks_;
   bool all_external_;
-  const Eigen::MatrixXd projective_eye_;
-  const Eigen::VectorXd b_;
+  const ProjectiveSystem* projective_system_;
+};
+
+// Solves the fixed points of many transformations with the same number of
+// actions together. The transition weights are stored action pair by action
+// pair with the transformations side by side, so each step of the
+// Grassmann-Taksar-Heyman elimination is a loop over the batch that the
+// compiler can vectorize. Transformations are solved `kMaxLanes` at a time so
+// that the weights stay in cache. The arithmetic on each transformation is
+// the same as in `WeightedActionTransformation::FixedPoint`.
+class FixedPointBatch {
+ public:
+  FixedPointBatch(size_t num_actions)
+      : num_actions_(num_actions), sums_(), outputs_(), p_(), pi_(), total_(),
+        exit_weight_(), ok_() {}
+
+  // Writes `sum`'s fixed point to `pi` once `Solve` is called. `sum` must
+  // not change until then. Fixed points with a closed form are written
+  // immediately.
+  void Add(const WeightedActionTransformation& sum, double* pi) {
+    assert(sum.NumActions() == num_actions_);
+    if (!(sum.weight_sum_ > 0) || sum.all_external_) {
+      sum.FixedPoint(pi);
+    } else {
+      sums_.push_back(&sum);
+      outputs_.push_back(pi);
+    }
+  }
+
+  void Solve() {
+    for (size_t first = 0; first < sums_.size(); first += kMaxLanes) {
+      SolveLanes(first, std::min(kMaxLanes, sums_.size() - first));
+    }
+    sums_.clear();
+    outputs_.clear();
+  }
+
+  size_t Size() const { return sums_.size(); }
+  size_t NumActions() const { return num_actions_; }
+
+ private:
+  // Solves the `m` transformations from `first` together.
+  void SolveLanes(size_t first, size_t m) {
+    const size_t n = num_actions_;
+    p_.resize(n * n * m);
+    pi_.resize(n * m);
+    total_.resize(m);
+    exit_weight_.resize(m);
+    ok_.assign(m, true);
+    for (size_t b = 0; b < m; ++b) {
+      const WeightedActionTransformation& sum = *sums_[first + b];
+      for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+          p_[(i * n + j) * m + b] = sum.weighted_phi_blocks_(j, i) +
+                                    sum.weighted_external_blocks_(j);
+        }
+      }
+    }
+    double* p = p_.data();
+    double* exit_weight = exit_weight_.data();
+    for (size_t k = n - 1; k > 0; --k) {
+      std::fill_n(exit_weight, m, 0.0);
+      for (size_t j = 0; j < k; ++j) {
+        const double* p_kj = p + (k * n + j) * m;
+        for (size_t b = 0; b < m; ++b) {
+          exit_weight[b] += p_kj[b];
+        }
+      }
+      for (size_t b = 0; b < m; ++b) {
+        if (!(exit_weight[b] > 0)) {
+          // Left to `FixedPoint`. The rest of the batch is unaffected.
+          ok_[b] = false;
+          exit_weight[b] = 1;
+        }
+      }
+      for (size_t i = 0; i < k; ++i) {
+        double* p_ik = p + (i * n + k) * m;
+        for (size_t b = 0; b < m; ++b) {
+          p_ik[b] /= exit_weight[b];
+        }
+        for (size_t j = 0; j < k; ++j) {
+          double* p_ij = p + (i * n + j) * m;
+          const double* p_kj = p + (k * n + j) * m;
+          for (size_t b = 0; b < m; ++b) {
+            p_ij[b] += p_ik[b] * p_kj[b];
+          }
+        }
+      }
+    }
+    double* pi = pi_.data();
+    double* total = total_.data();
+    std::fill_n(pi, m, 1.0);
+    std::fill_n(total, m, 1.0);
+    for (size_t k = 1; k < n; ++k) {
+      double* pi_k = pi + k * m;
+      std::fill_n(pi_k, m, 0.0);
+      for (size_t i = 0; i < k; ++i) {
+        const double* pi_i = pi + i * m;
+        const double* p_ik = p + (i * n + k) * m;
+        for (size_t b = 0; b < m; ++b) {
+          pi_k[b] += pi_i[b] * p_ik[b];
+        }
+      }
+      for (size_t b = 0; b < m; ++b) {
+        total[b] += pi_k[b];
+      }
+    }
+    for (size_t b = 0; b < m; ++b) {
+      if (ok_[b]) {
+        for (size_t k = 0; k < n; ++k) {
+          outputs_[first + b][k] = pi[k * m + b] / total[b];
+        }
+      } else {
+        sums_[first + b]->FixedPoint(outputs_[first + b]);
+      }
+    }
+  }
+
+ private:
+  static constexpr size_t kMaxLanes = 32;
+
+  size_t num_actions_;
+  std::vector<const WeightedActionTransformation*> sums_;
+  std::vector<double*> outputs_;
+  std::vector<double> p_;
+  std::vector<double> pi_;
+  std::vector<double> total_;
+  std::vector<double> exit_weight_;
+  std::vector<char> ok_;
 };
 
 }  // namespace hr_edl
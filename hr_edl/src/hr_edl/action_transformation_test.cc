@@ -1,5 +1,7 @@
 #include "hr_edl/action_transformation.h"
 
+#include <random>
+
 #include "open_spiel/spiel_utils.h"
 #include "hr_edl/test_extra.h"
 
@@ -201,6 +203,166 @@ void AllInternalTransformations() {
     }
   }
 }
+
+void FixedPointMatchesSvd() {
+  std::mt19937 engine(0);
+  std::uniform_real_distribution<double> weight(0, 1);
+  for (size_t num_actions = 2; num_actions < 8; ++num_actions) {
+    const auto internal_transformations =
+        SwapActionTranformation::Internal(num_actions);
+    const auto external_transformations =
+        SwapActionTranformation::External(num_actions);
+    for (size_t trial = 0; trial < 10; ++trial) {
+      WeightedActionTransformation sum(num_actions);
+      for (const auto& phi : internal_transformations) {
+        sum.Add(phi, weight(engine));
+      }
+      if (trial % 2 == 0) {
+        for (const auto& phi : external_transformations) {
+          sum.Add(phi, weight(engine));
+        }
+      }
+      const std::vector<double> prob_vec = sum.FixedPoint();
+      std::vector<double> svd_prob_vec(num_actions);
+      sum.SvdFixedPoint(svd_prob_vec.data());
+      for (size_t a = 0; a < num_actions; ++a) {
+        SPIEL_CHECK_FLOAT_NEAR(prob_vec[a], svd_prob_vec[a], 1e-10);
+      }
+    }
+  }
+  {
+    // Actions 1 and 2 are both absorbing, so the fixed point is not unique
+    // and the SVD's is used.
+    WeightedActionTransformation sum(3);
+    sum.Add(SwapActionTranformation({1, 1, 2}), 1.0);
+    const std::vector<double> prob_vec = sum.FixedPoint();
+    SPIEL_CHECK_FLOAT_NEAR(prob_vec[0], 0, 1e-10);
+    SPIEL_CHECK_FLOAT_NEAR(prob_vec[1], 0.5, 1e-10);
+    SPIEL_CHECK_FLOAT_NEAR(prob_vec[2], 0.5, 1e-10);
+  }
+}
+
+void ClosedFormsMatchTransformations() {
+  std::mt19937 engine(0);
+  std::uniform_real_distribution<double> unit(0, 1);
+  for (size_t num_actions = 2; num_actions < 7; ++num_actions) {
+    const auto internal_transformations =
+        SwapActionTranformation::Internal(num_actions);
+    const auto external_transformations =
+        SwapActionTranformation::External(num_actions);
+
+    std::vector<double> policy(num_actions);
+    double policy_sum = 0;
+    for (auto& p : policy) {
+      p = unit(engine);
+      policy_sum += p;
+    }
+    for (auto& p : policy) {
+      p /= policy_sum;
+    }
+    CfValues cfvs(num_actions);
+    for (size_t a = 0; a < num_actions; ++a) {
+      cfvs[a] = 2 * unit(engine) - 1;
+    }
+    cfvs.ev_ = cfvs(policy);
+
+    double ex_regrets[num_actions];
+    ExternalRegrets(cfvs, policy.data(), ex_regrets);
+    for (size_t i = 0; i < external_transformations.size(); ++i) {
+      SPIEL_CHECK_FLOAT_NEAR(ex_regrets[i],
+                             external_transformations[i].Regret(cfvs, policy),
+                             1e-12);
+    }
+    double in_regrets[internal_transformations.size()];
+    InternalRegrets(cfvs, policy.data(), in_regrets);
+    for (size_t i = 0; i < internal_transformations.size(); ++i) {
+      SPIEL_CHECK_FLOAT_NEAR(in_regrets[i],
+                             internal_transformations[i].Regret(cfvs, policy),
+                             1e-12);
+    }
+
+    WeightedActionTransformation sum(num_actions);
+    WeightedActionTransformation closed_form_sum(num_actions);
+    size_t i = 0;
+    for (size_t from = 0; from < num_actions; ++from) {
+      for (size_t to = 0; to < num_actions; ++to) {
+        if (from == to) {
+          continue;
+        }
+        const double w = unit(engine);
+        sum.Add(internal_transformations[i], w);
+        closed_form_sum.AddInternal(from, to, w);
+        ++i;
+      }
+    }
+    for (size_t a = 0; a < num_actions; ++a) {
+      const double w = unit(engine);
+      sum.Add(external_transformations[a], w);
+      closed_form_sum.AddExternal(a, w);
+    }
+    SPIEL_CHECK_FLOAT_NEAR(closed_form_sum.WeightSum(), sum.WeightSum(),
+                           1e-12);
+    const auto matrix = sum.ToMatrix();
+    const auto closed_form_matrix = closed_form_sum.ToMatrix();
+    for (size_t row = 0; row < num_actions; ++row) {
+      for (size_t col = 0; col < num_actions; ++col) {
+        SPIEL_CHECK_FLOAT_NEAR(closed_form_matrix(row, col), matrix(row, col),
+                               1e-12);
+      }
+    }
+    const auto prob_vec = sum.FixedPoint();
+    const auto closed_form_prob_vec = closed_form_sum.FixedPoint();
+    for (size_t a = 0; a < num_actions; ++a) {
+      SPIEL_CHECK_FLOAT_NEAR(closed_form_prob_vec[a], prob_vec[a], 1e-12);
+    }
+  }
+}
+
+void FixedPointBatchMatchesFixedPoint() {
+  std::mt19937 engine(0);
+  std::uniform_real_distribution<double> weight(0, 1);
+  for (size_t num_actions = 2; num_actions < 6; ++num_actions) {
+    const auto internal_transformations =
+        SwapActionTranformation::Internal(num_actions);
+    const auto external_transformations =
+        SwapActionTranformation::External(num_actions);
+    std::vector<WeightedActionTransformation> sums;
+    for (size_t trial = 0; trial < 12; ++trial) {
+      sums.emplace_back(num_actions);
+      if (trial % 4 == 1) {
+        continue;  // No weight
+      }
+      if (trial % 4 != 2) {
+        for (const auto& phi : internal_transformations) {
+          sums.back().Add(phi, weight(engine));
+        }
+      }
+      if (trial % 2 == 0) {
+        for (const auto& phi : external_transformations) {
+          sums.back().Add(phi, weight(engine));
+        }
+      }
+    }
+    // Reducible, so it falls back to the SVD.
+    sums.emplace_back(num_actions);
+    sums.back().Add(internal_transformations[0], 1.0);
+
+    FixedPointBatch batch(num_actions);
+    std::vector<std::vector<double>> batch_prob_vecs(
+        sums.size(), std::vector<double>(num_actions));
+    for (size_t i = 0; i < sums.size(); ++i) {
+      batch.Add(sums[i], batch_prob_vecs[i].data());
+    }
+    batch.Solve();
+    SPIEL_CHECK_EQ(batch.Size(), 0);
+    for (size_t i = 0; i < sums.size(); ++i) {
+      const std::vector<double> prob_vec = sums[i].FixedPoint();
+      for (size_t a = 0; a < num_actions; ++a) {
+        SPIEL_CHECK_FLOAT_NEAR(batch_prob_vecs[i][a], prob_vec[a], 1e-14);
+      }
+    }
+  }
+}
 }  // namespace
 }  // namespace test
 }  // namespace phi_regret_matching
@@ -213,6 +375,9 @@ int main(int argc, char** argv) {
   RUN_TEST(WeightedActionTransformationSum);
   RUN_TEST(WeightedActionTransformationFixedPoint);
   RUN_TEST(WeightedActionTransformationFixedPointInternalExternalAndSwap);
+  RUN_TEST(FixedPointMatchesSvd);
+  RUN_TEST(ClosedFormsMatchTransformations);
+  RUN_TEST(FixedPointBatchMatchesFixedPoint);
   RUN_TEST(AllInternalTransformations);
   RUN_TEST(AllExternalTransformations);
 }
@@ -19,14 +19,29 @@ class AdaptiveProfile {
   virtual Policy* Strategy(size_t player) const = 0;
   Cfv Ev(DecisionPoint& root, MccfrSampler& sampler,
          const PolicyProfile& compatriots) const {
+    const std::vector<Cfv> evs = PlayerEvs(root, sampler, compatriots);
     double avg = 0.0;
+    for (size_t player = 0; player < evs.size(); ++player) {
+      avg += (evs[player] - avg) / (player + 1.0);
+    }
+    return avg;
+  }
+  // Each player's expected value when it plays its strategy with
+  // `compatriots`.
+  std::vector<Cfv> PlayerEvs(DecisionPoint& root, MccfrSampler& sampler,
+                             const PolicyProfile& compatriots) const {
+    if (sampler.IsExhaustive()) {
+      return PolicyValues(root, compatriots, Strategies(root.NumPlayers()))
+          .first;
+    }
+    std::vector<Cfv> evs;
     for (int player = 0; player < root.NumPlayers(); ++player) {
       const auto [v, _] = PolicyValue(
           root, player, compatriots.WithSubstitute(Strategy(player), player),
           sampler);
-      avg += (v - avg) / (player + 1.0);
+      evs.push_back(v);
     }
-    return avg;
+    return evs;
   }
   virtual Cfv UpdateAndReturnEv(DecisionPoint& root, MccfrSampler& sampler,
                                 const PolicyProfile& compatriots) = 0;
@@ -37,6 +52,16 @@ class AdaptiveProfile {
   MapPolicy ToMapPolicy(DecisionPoint& root) const {
     return MapPolicy(Frozen(), root);
   }
+
+ protected:
+  std::vector<const Policy*> Strategies(size_t num_players) const {
+    std::vector<const Policy*> strategies;
+    strategies.reserve(num_players);
+    for (size_t player = 0; player < num_players; ++player) {
+      strategies.push_back(Strategy(player));
+    }
+    return strategies;
+  }
 };
 
 class CfTreeLearnerProfile : public AdaptiveProfile {
@@ -50,12 +75,27 @@ class CfTreeLearnerProfile : public AdaptiveProfile {
   Cfv UpdateAndReturnEv(DecisionPoint& root, MccfrSampler& sampler,
                         const PolicyProfile& compatriots) override final {
     double avg = 0.0;
+    if (sampler.IsExhaustive()) {
+      // Every player's update only depends on `compatriots` and its own
+      // learner, so all of them can be evaluated in one traversal.
+      const std::vector<const Policy*> substitutes =
+          Strategies(learners_.size());
+      const auto evaluations =
+          FusedCfValueTreeEvaluator(evaluators_, compatriots, substitutes)
+              .ComputeCfValueTreeEvaluations(root);
+      for (int player = 0; player < root.NumPlayers(); ++player) {
+        const auto& [v, cf_value_tree, _] = evaluations[player];
+        learners_[player]->Update(*cf_value_tree);
+        avg += (v - avg) / (player + 1.0);
+      }
+      return avg;
+    }
     for (int player = 0; player < root.NumPlayers(); ++player) {
-      const auto [v, initial_info_states, cf_value_tree, _] =
+      const auto [v, cf_value_tree, _] =
           evaluators_[player].ComputeCfValueTreeEvaluation(
               root, compatriots.WithSubstitute(Strategy(player), player),
               sampler);
-      learners_[player]->Update(initial_info_states, *cf_value_tree);
+      learners_[player]->Update(*cf_value_tree);
       avg += (v - avg) / (player + 1.0);
     }
     return avg;
@@ -65,10 +105,10 @@ class CfTreeLearnerProfile : public AdaptiveProfile {
                                  MccfrSampler& sampler) override final {
     double avg = 0.0;
     for (int player = 0; player < root.NumPlayers(); ++player) {
-      const auto [v, initial_info_states, cf_value_tree, _] =
+      const auto [v, cf_value_tree, _] =
           evaluators_[player].ComputeCfValueTreeEvaluation(
               root, PolicyRefProfile(learners_), sampler);
-      learners_[player]->Update(initial_info_states, *cf_value_tree);
+      learners_[player]->Update(*cf_value_tree);
       avg += (v - avg) / (player + 1.0);
     }
     return avg;
@@ -114,14 +154,10 @@ class PolicyIterationProfile : public MapPolicyAdaptiveProfile {
 
   Cfv UpdateAndReturnEv(DecisionPoint& root, MccfrSampler& sampler,
                         const PolicyProfile& compatriots) override final {
-    double avg = 0.0;
+    const Cfv avg = Ev(root, sampler, compatriots);
     for (int player = 0; player < root.NumPlayers(); ++player) {
-      const auto [v, _] = PolicyValue(
-          root, player, compatriots.WithSubstitute(Strategy(player), player),
-          sampler);
       profile_[player].reset(new MapPolicy(
           BestResponse(compatriots).Policy(root, -player - 1).first));
-      avg += (v - avg) / (player + 1.0);
     }
     return avg;
   }
@@ -149,13 +185,7 @@ class AntiPolicyIterationProfile : public MapPolicyAdaptiveProfile {
 
   Cfv UpdateAndReturnEv(DecisionPoint& root, MccfrSampler& sampler,
                         const PolicyProfile& compatriots) override final {
-    double avg = 0.0;
-    for (int player = 0; player < root.NumPlayers(); ++player) {
-      const auto [v, _] = PolicyValue(
-          root, player, compatriots.WithSubstitute(Strategy(player), player),
-          sampler);
-      avg += (v - avg) / (player + 1.0);
-    }
+    const Cfv avg = Ev(root, sampler, compatriots);
     policy_iteration_.UpdateAndReturnEv(root, sampler, compatriots);
     const auto pi_profile = policy_iteration_.Frozen();
 
@@ -223,13 +253,7 @@ class FictitiousPlayProfile : public MapPolicyAdaptiveProfile {
 
   Cfv UpdateAndReturnEv(DecisionPoint& root, MccfrSampler& sampler,
                         const PolicyProfile& compatriots) override final {
-    double avg = 0.0;
-    for (int player = 0; player < root.NumPlayers(); ++player) {
-      const auto [v, _] = PolicyValue(
-          root, player, compatriots.WithSubstitute(Strategy(player), player),
-          sampler);
-      avg += (v - avg) / (player + 1.0);
-    }
+    const Cfv avg = Ev(root, sampler, compatriots);
     compatriot_empirical_play_.Avg(compatriots, root);
 
     for (int player = 0; player < root.NumPlayers(); ++player) {
@@ -44,9 +44,9 @@ std::pair<MapPolicy, double> BestResponse::Policy(
 }
 
 void BestResponse::BackwardPassValue() const {
-  for (int depth = iss_by_depth_.size() - 1; depth > -1; --depth) {
-    for (const auto& iss : iss_by_depth_[depth]) {
-      const auto& info_set = info_set_values_.at(iss);
+  for (int depth = slots_by_depth_.size() - 1; depth > -1; --depth) {
+    for (const size_t slot : slots_by_depth_[depth]) {
+      const auto& info_set = info_set_values_[slot];
 
       size_t br_action = 0;
       double max_value = std::numeric_limits<double>::lowest();
@@ -65,9 +65,9 @@ void BestResponse::BackwardPassValue() const {
 InfoStateUvm<std::vector<double>> BestResponse::BackwardPassMap() const {
   InfoStateUvm<std::vector<double>> policy;
 
-  for (int depth = iss_by_depth_.size() - 1; depth > -1; --depth) {
-    for (const auto& iss : iss_by_depth_[depth]) {
-      const auto& info_set = info_set_values_.at(iss);
+  for (int depth = slots_by_depth_.size() - 1; depth > -1; --depth) {
+    for (const size_t slot : slots_by_depth_[depth]) {
+      const auto& info_set = info_set_values_[slot];
 
       size_t br_action = 0;
       double max_value = std::numeric_limits<double>::lowest();
@@ -80,7 +80,7 @@ InfoStateUvm<std::vector<double>> BestResponse::BackwardPassMap() const {
       }
       std::vector<double> bp(info_set.second.size(), 0);
       bp[br_action] = 1.0;
-      policy[iss] = std::move(bp);
+      policy[keys_[slot]] = std::move(bp);
 
       *info_set.first += info_set.second[br_action];
     }
@@ -88,64 +88,86 @@ InfoStateUvm<std::vector<double>> BestResponse::BackwardPassMap() const {
   return policy;
 }
 
-void BestResponse::RecursiveDfs(DecisionPoint& decision_point, size_t depth,
-                                double prob, double* parent_value,
-                                open_spiel::Player player, size_t action) {
-  const auto& outcome_probs = decision_point.OutcomeProbabilities(action);
-  for (size_t outcome = 0; outcome < outcome_probs.size(); ++outcome) {
+template <class DP>
+void BestResponse::RecursiveDecisionPointDfs(DP& decision_point, size_t depth,
+                                             double prob, double* parent_value,
+                                             open_spiel::Player player,
+                                             size_t action) {
+  for (size_t outcome = 0; outcome < decision_point.NumOutcomes(action);
+       ++outcome) {
+    const double outcome_prob =
+        decision_point.OutcomeProbabilitiesRef(action)[outcome];
     decision_point.Apply(action, outcome);
-    RecursiveDfs(decision_point, depth, prob * outcome_probs[outcome],
-                 parent_value, player);
+    RecursiveDecisionPointDfs(decision_point, depth, prob * outcome_prob,
+                              parent_value, player);
     decision_point.Undo();
   }
 }
 void BestResponse::Dfs(DecisionPoint& decision_point, double* br_value,
                        int player) {
-  iss_by_depth_.clear();
+  Clear(decision_point.NumPlayers());
+  response_cache_.Reset();
+  WithConcreteDecisionPoint(
+      decision_point, [this, br_value, player](auto& concrete_decision_point) {
+        RecursiveDecisionPointDfs(concrete_decision_point, 0, 1.0, br_value,
+                                  player, 0);
+      });
+}
+
+void BestResponse::Clear(size_t num_players) {
+  slots_by_depth_.clear();
+  keys_.clear();
   info_set_values_.clear();
-  RecursiveDfs(decision_point, 0, 1.0, br_value, player, 0);
+  slot_by_key_.clear();
+  slot_by_id_.assign(num_players, std::vector<size_t>());
 }
 
-double* BestResponse::NewParentValue(const std::string& iss,
-                                     double* parent_value, size_t num_actions,
-                                     size_t depth) {
-  if (iss_by_depth_.size() <= depth) {
-    iss_by_depth_.emplace_back();
+size_t BestResponse::NewInfoSet(const std::string& iss, double* parent_value,
+                                size_t num_actions, size_t depth) {
+  if (slots_by_depth_.size() <= depth) {
+    slots_by_depth_.emplace_back();
   }
-  iss_by_depth_[depth].push_back(iss);
-  auto iter_status_pair = info_set_values_.emplace(
-      std::piecewise_construct, std::forward_as_tuple(iss),
-      std::forward_as_tuple(std::piecewise_construct,
-                            std::forward_as_tuple(parent_value),
-                            std::forward_as_tuple(num_actions, 0)));
-  return iter_status_pair.first->second.second.data();
+  const size_t slot = info_set_values_.size();
+  slots_by_depth_[depth].push_back(slot);
+  keys_.push_back(iss);
+  info_set_values_.emplace_back(std::piecewise_construct,
+                                std::forward_as_tuple(parent_value),
+                                std::forward_as_tuple(num_actions, 0));
+  return slot;
 }
 
-void BestResponse::RecursiveDfs(DecisionPoint& decision_point, size_t depth,
-                                double prob, double* parent_value, int player) {
+template <class DP>
+void BestResponse::RecursiveDecisionPointDfs(DP& decision_point, size_t depth,
+                                             double prob, double* parent_value,
+                                             int player) {
   if (decision_point.IsTerminal()) {
     *parent_value += CfReturn(decision_point.Returns(), prob, player);
   } else if (UsePolicy(decision_point.PlayerToAct(), player)) {
-    const auto action_probs =
-        policy_.Response(*decision_point.OpenSpielStatePtr());
+    const absl::Span<const double> action_probs =
+        response_cache_.Response(decision_point);
     for (size_t a = 0; a < action_probs.size(); ++a) {
       if (action_probs[a] > 0) {
-        RecursiveDfs(decision_point, depth, prob * action_probs[a],
-                     parent_value, player, a);
+        RecursiveDecisionPointDfs(decision_point, depth,
+                                  prob * action_probs[a], parent_value, player,
+                                  a);
       }
     }
   } else {
-    const std::string& iss = decision_point.InformationStateStringRef();
-
-    double* next_parent_value =
-        info_set_values_.contains(iss)
-            ? info_set_values_.at(iss).second.data()
-            : NewParentValue(iss, parent_value, decision_point.NumActions(),
-                             depth);
+    const open_spiel::Player player_to_act = decision_point.PlayerToAct();
+    const size_t id = decision_point.InfoSetId();
+    auto& slots = slot_by_id_[player_to_act];
+    if (slots.size() <= id) {
+      slots.resize(decision_point.NumInfoSets(player_to_act), kNoSlot);
+    }
+    if (slots[id] == kNoSlot) {
+      slots[id] = NewInfoSet(decision_point.InformationStateStringRef(),
+                             parent_value, decision_point.NumActions(), depth);
+    }
+    double* next_parent_value = info_set_values_[slots[id]].second.data();
 
     for (size_t a = 0; a < decision_point.NumActions(); ++a) {
-      RecursiveDfs(decision_point, depth + 1, prob, next_parent_value, player,
-                   a);
+      RecursiveDecisionPointDfs(decision_point, depth + 1, prob,
+                                next_parent_value, player, a);
       ++next_parent_value;
     }
   }
@@ -153,8 +175,7 @@ void BestResponse::RecursiveDfs(DecisionPoint& decision_point, size_t depth,
 
 void BestResponse::Dfs(const open_spiel::State& history, double* br_value,
                        int player) {
-  iss_by_depth_.clear();
-  info_set_values_.clear();
+  Clear(history.NumPlayers());
   RecursiveDfs(history, 0, 1.0, br_value, player);
 }
 
@@ -182,21 +203,12 @@ void BestResponse::RecursiveDfs(const open_spiel::State& h, size_t depth,
     const std::string iss = h.InformationStateString();
     const auto legal_actions = h.LegalActions();
 
-    double* next_parent_value;
-    if (!info_set_values_.contains(iss)) {
-      if (iss_by_depth_.size() <= depth) {
-        iss_by_depth_.emplace_back();
-      }
-      iss_by_depth_[depth].push_back(iss);
-      auto iter_status_pair = info_set_values_.emplace(
-          std::piecewise_construct, std::forward_as_tuple(iss),
-          std::forward_as_tuple(
-              std::piecewise_construct, std::forward_as_tuple(parent_value),
-              std::forward_as_tuple(legal_actions.size(), 0)));
-      next_parent_value = iter_status_pair.first->second.second.data();
-    } else {
-      next_parent_value = info_set_values_[iss].second.data();
+    auto [iter, inserted] =
+        slot_by_key_.try_emplace(iss, info_set_values_.size());
+    if (inserted) {
+      NewInfoSet(iss, parent_value, legal_actions.size(), depth);
     }
+    double* next_parent_value = info_set_values_[iter->second].second.data();
     const size_t next_depth = depth + 1;
     for (const open_spiel::Action a : legal_actions) {
       RecursiveDfs(*h.Child(a), next_depth, prob, next_parent_value, player);
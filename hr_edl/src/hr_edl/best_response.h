@@ -1,6 +1,8 @@
 #ifndef HR_EDL_BEST_RESPONSE_H_
 #define HR_EDL_BEST_RESPONSE_H_
 
+#include <limits>
+
 #include "hr_edl/decision_point.h"
 #include "hr_edl/policy.h"
 
@@ -9,7 +11,13 @@ namespace hr_edl {
 class BestResponse {
  public:
   BestResponse(const Policy& policy)
-      : policy_(policy), iss_by_depth_(), info_set_values_() {}
+      : policy_(policy),
+        slots_by_depth_(),
+        keys_(),
+        info_set_values_(),
+        slot_by_key_(),
+        slot_by_id_(),
+        response_cache_(policy) {}
 
   double Value(DecisionPoint& decision_point, int player);
   double Value(const open_spiel::State& history, int player);
@@ -17,9 +25,13 @@ class BestResponse {
                                       int player);
   std::pair<MapPolicy, double> Policy(const open_spiel::State& history,
                                       int player);
+  const ResponseCacheStats& ResponseStats() const {
+    return response_cache_.Stats();
+  }
 
  private:
   using InfoSetValues = std::pair<double*, std::vector<double>>;
+  static constexpr size_t kNoSlot = std::numeric_limits<size_t>::max();
 
   // A policy_player of -i means that all positions except i - 1 should use
   // the policy while i - 1 uses a BR.
@@ -30,24 +42,36 @@ class BestResponse {
                          int policy_player);
 
  private:
-  double* NewParentValue(const std::string& iss, double* parent_value,
-                         size_t num_actions, size_t depth);
+  void Clear(size_t num_players);
+  size_t NewInfoSet(const std::string& iss, double* parent_value,
+                    size_t num_actions, size_t depth);
   void BackwardPassValue() const;
   InfoStateUvm<std::vector<double>> BackwardPassMap() const;
   MapPolicy BackwardPassPolicy() const { return BackwardPassMap(); }
-  void RecursiveDfs(DecisionPoint& decision_point, size_t depth, double prob,
-                    double* parent_value, int player, size_t action);
+  // Traverses with the instantiation for `decision_point`'s concrete type if
+  // there is one.
   void Dfs(DecisionPoint& decision_point, double* br_value, int player);
-  void RecursiveDfs(DecisionPoint& decision_point, size_t depth, double prob,
-                    double* parent_value, int player);
+  template <class DP>
+  void RecursiveDecisionPointDfs(DP& decision_point, size_t depth, double prob,
+                                 double* parent_value, int player,
+                                 size_t action);
+  template <class DP>
+  void RecursiveDecisionPointDfs(DP& decision_point, size_t depth, double prob,
+                                 double* parent_value, int player);
   void Dfs(const open_spiel::State& history, double* br_value, int player);
   void RecursiveDfs(const open_spiel::State& h, size_t depth, double prob,
                     double* parent_value, int player);
 
  private:
   const class Policy& policy_;
-  std::vector<std::vector<std::string>> iss_by_depth_;
-  InfoStateUvm<InfoSetValues> info_set_values_;
+  std::vector<std::vector<size_t>> slots_by_depth_;
+  std::vector<std::string> keys_;
+  std::vector<InfoSetValues> info_set_values_;
+  // Info set slots are looked up by key when traversing OpenSpiel states and
+  // by info set ID when traversing decision points.
+  InfoStateUvm<size_t> slot_by_key_;
+  PlayerMap<std::vector<size_t>> slot_by_id_;
+  ResponseCache response_cache_;
 };
 
 // TODO: This is not sufficiently general
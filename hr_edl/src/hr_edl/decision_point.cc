@@ -1,37 +1,161 @@
 #include "hr_edl/decision_point.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#include "absl/base/casts.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
 #include "hr_edl/containers.h"
 #include "hr_edl/samplers.h"
 
+#ifndef HR_EDL_OPEN_SPIEL_COMMIT
+#define HR_EDL_OPEN_SPIEL_COMMIT "unknown"
+#endif
+
 namespace hr_edl {
 
+namespace {
+constexpr char kTreeFileMagic[] = "hr_edl tree v1";
+
+template <class T>
+void WriteArray(std::ostream& out, const std::vector<T>& array) {
+  const uint64_t size = array.size();
+  out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  out.write(reinterpret_cast<const char*>(array.data()), size * sizeof(T));
+}
+void WriteString(std::ostream& out, const std::string& s) {
+  WriteArray(out, std::vector<char>(s.begin(), s.end()));
+}
+
+// Reads from a memory-mapped tree file, failing on truncated input.
+class TreeFileReader {
+ public:
+  TreeFileReader(const char* data, size_t size)
+      : next_(data), end_(data + size) {}
+
+  template <class T>
+  bool ReadArray(std::vector<T>& array) {
+    uint64_t size;
+    if (!Read(&size, sizeof(size)) || size > Remaining() / sizeof(T)) {
+      return false;
+    }
+    array.resize(size);
+    return Read(array.data(), size * sizeof(T));
+  }
+  bool ReadString(std::string& s) {
+    std::vector<char> chars;
+    if (!ReadArray(chars)) {
+      return false;
+    }
+    s.assign(chars.begin(), chars.end());
+    return true;
+  }
+  bool Done() const { return next_ == end_; }
+  size_t Remaining() const { return end_ - next_; }
+
+ private:
+  bool Read(void* out, size_t num_bytes) {
+    if (num_bytes > Remaining()) {
+      return false;
+    }
+    std::memcpy(out, next_, num_bytes);
+    next_ += num_bytes;
+    return true;
+  }
+
+ private:
+  const char* next_;
+  const char* end_;
+};
+
+uint64_t Fnv1aHash(const std::string& s) {
+  uint64_t hash = 14695981039346656037ull;
+  for (const char c : s) {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+  }
+  return hash;
+}
+
+// Creates `dir` and any of its missing ancestors. On failure, `errno` says
+// why.
+bool MakeDirs(const std::string& dir) {
+  for (size_t end = dir.find('/', 1);; end = dir.find('/', end + 1)) {
+    const std::string prefix = dir.substr(0, end);
+    if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+      return false;
+    }
+    if (end == std::string::npos) {
+      return true;
+    }
+  }
+}
+}  // namespace
+
+size_t NewInfoSetIdSpace() {
+  static std::atomic<size_t> next_id_space(1);
+  return next_id_space++;
+}
+
+size_t DecisionPoint::SampleOutcome(size_t action,
+                                    double random_number) const {
+  const auto probs = OutcomeProbabilitiesRef(action);
+  double cumulative_prob = 0;
+  for (size_t outcome = 0; outcome < probs.size() - 1; ++outcome) {
+    cumulative_prob += probs[outcome];
+    if (cumulative_prob > random_number) {
+      return outcome;
+    }
+  }
+  return probs.size() - 1;
+}
+
 double DecisionPoint::ApplySampledOutcome(size_t action, double random_number) {
-  const std::vector<double>& pi = OutcomeProbabilities(action);
-  const size_t outcome = SampleActionIndex(pi, random_number);
-  const double prob = pi[outcome];
+  const size_t outcome = SampleOutcome(action, random_number);
+  const double prob = OutcomeProbabilitiesRef(action)[outcome];
   Apply(action, outcome);
   return prob;
 }
 
 CachedDecisionPoint::CachedDecisionPoint(open_spiel::StatePtr&& root,
-                                         bool save_root, bool save_terminals)
+                                         bool save_root, bool save_terminals,
+                                         size_t capacity)
     : DecisionPoint(root->NumPlayers(), root->NumDistinctActions()),
       idx_(0),
       histories_(),
-      save_terminals_(save_terminals) {
+      info_set_ids_(root->NumPlayers()),
+      id_space_(),
+      save_terminals_(save_terminals),
+      capacity_(capacity),
+      free_slots_(),
+      referenced_(),
+      clock_hand_(0),
+      stats_() {
   if (root->IsTerminal()) {
     if (save_terminals_) {
-      histories_.emplace_back(std::move(root), idx_);
+      NewHistory(std::move(root), idx_);
     } else {
-      histories_.emplace_back(root->Returns(), idx_);
+      NewHistory(root->Returns(), idx_);
     }
   } else if (root->IsChanceNode() && save_root) {
-    histories_.emplace_back(std::move(root));
+    NewHistory(std::move(root));
     histories_[idx_].outcomes_.emplace_back();
     RecursiveCache(*(histories_[idx_].os_state_), 1.0, 0);
   } else {
-    histories_.emplace_back();
+    NewHistory();
     histories_[idx_].outcomes_.emplace_back();
     RecursiveCache(std::move(root), 1.0, 0);
   }
@@ -54,13 +178,23 @@ void CachedDecisionPoint::RecursiveCache(open_spiel::StatePtr&& child,
       return;
     }
   } else if (!save_terminals_) {
-    histories_[idx_].outcomes_[aidx].PushBack(histories_.size(), prob);
-    histories_.emplace_back(child->Returns(), idx_);
+    const size_t h = NewHistory(child->Returns(), idx_);
+    histories_[idx_].outcomes_[aidx].PushBack(h, prob);
     return;
   }
   // Non-trivial decision node or terminal to be saved.
-  histories_[idx_].outcomes_[aidx].PushBack(histories_.size(), prob);
-  histories_.emplace_back(std::move(child), idx_);
+  const size_t h = NewHistory(std::move(child), idx_);
+  histories_[idx_].outcomes_[aidx].PushBack(h, prob);
+  AssignInfoSetId(histories_[h]);
+}
+void CachedDecisionPoint::AssignInfoSetId(
+    _decision_point::HistoryCache& history) {
+  if (history.player_to_act_ < 0) {
+    return;
+  }
+  auto& ids = info_set_ids_[history.player_to_act_];
+  history.info_set_id_ =
+      ids.try_emplace(history.info_state_key_, ids.size()).first->second;
 }
 void CachedDecisionPoint::CacheOutcomes() {
   if (IsTerminal() || histories_[idx_].outcomes_.size() > 0) {
@@ -71,20 +205,739 @@ void CachedDecisionPoint::CacheOutcomes() {
     histories_[idx_].outcomes_.emplace_back();
     RecursiveCache(histories_[idx_].os_state_->Child(actions[aidx]), 1.0, aidx);
   }
+  if (capacity_ > 0 && NumHistories() > capacity_) {
+    Evict();
+  }
+}
+void CachedDecisionPoint::Evict() {
+  std::vector<size_t> path(1, idx_);
+  while (path.back() != 0) {
+    path.push_back(histories_[path.back()].parent_idx_);
+  }
+  // Two full sweeps clear every reference bit, so any history that is still
+  // held after that is pinned.
+  for (size_t i = 0; i < 2 * histories_.size() && NumHistories() > capacity_;
+       ++i) {
+    clock_hand_ = (clock_hand_ + 1) % histories_.size();
+    const auto& history = histories_[clock_hand_];
+    if (history.IsTerminal() || history.outcomes_.empty() ||
+        std::find(path.begin(), path.end(), clock_hand_) != path.end()) {
+      continue;
+    }
+    if (referenced_[clock_hand_]) {
+      referenced_[clock_hand_] = false;
+      continue;
+    }
+    for (const auto& outcomes : history.outcomes_) {
+      for (size_t outcome = 0; outcome < outcomes.Size(); ++outcome) {
+        DiscardSubtree(outcomes.Idx(outcome));
+      }
+    }
+    histories_[clock_hand_].outcomes_.clear();
+    ++stats_.evictions;
+  }
 }
+void CachedDecisionPoint::DiscardSubtree(size_t h) {
+  for (const auto& outcomes : histories_[h].outcomes_) {
+    for (size_t outcome = 0; outcome < outcomes.Size(); ++outcome) {
+      DiscardSubtree(outcomes.Idx(outcome));
+    }
+  }
+  histories_[h] = _decision_point::HistoryCache();
+  referenced_[h] = false;
+  free_slots_.push_back(h);
+}
+
+namespace _decision_point {
+CompiledTree::CompiledTree(size_t num_players, size_t num_distinct_actions,
+                           bool save_terminals, bool save_states)
+    : num_players_(num_players),
+      num_distinct_actions_(num_distinct_actions),
+      first_outcome_({0}),
+      info_state_keys_(num_players),
+      info_set_id_space_(NewInfoSetIdSpace()),
+      empty_info_state_key_(),
+      save_terminals_(save_terminals && save_states),
+      save_states_(save_states),
+      merged_(false),
+      info_set_ids_() {}
 
+void CompiledTree::Compile(open_spiel::StatePtr&& root, bool save_root,
+                           size_t num_threads) {
+  info_set_ids_.resize(num_players_);
+  ChildStates child_states;
+  if (root->IsTerminal()) {
+    NewTerminal(0, std::move(root));
+  } else if (root->IsChanceNode() && save_root) {
+    const std::shared_ptr<const open_spiel::State> root_state(std::move(root));
+    const size_t h = NewHistory(0, -1, root_state);
+    Expand(h, *root_state, child_states);
+  } else {
+    // Artificial root
+    NewHistory(0, -1, nullptr);
+    num_actions_[0] = 1;
+    CompileOutcomes(std::move(root), 1.0, 0, child_states);
+    first_outcome_.push_back(outcome_children_.size());
+  }
+  if (num_threads < 2 || child_states.empty()) {
+    for (auto& [child, child_state] : child_states) {
+      Compile(child, *child_state);
+      child_state.reset();
+    }
+  } else {
+    CompileInParallel(child_states, num_threads);
+  }
+  info_set_ids_ = PlayerMap<InfoStateUvm<size_t>>();
+  AccumulateOutcomeProbs();
+}
+
+bool CompiledTree::IsConsistent() const {
+  const size_t num_histories = parent_.size();
+  if (num_histories == 0 || player_to_act_.size() != num_histories ||
+      info_set_id_.size() != num_histories ||
+      first_action_.size() != num_histories ||
+      num_actions_.size() != num_histories || first_outcome_.empty() ||
+      first_outcome_[0] != 0 ||
+      first_outcome_.back() != outcome_children_.size() ||
+      outcome_probs_.size() != outcome_children_.size()) {
+    return false;
+  }
+  const size_t num_edges = first_outcome_.size() - 1;
+  for (size_t e = 0; e < num_edges; ++e) {
+    if (first_outcome_[e] > first_outcome_[e + 1]) {
+      return false;
+    }
+  }
+  for (const size_t child : outcome_children_) {
+    if (child >= num_histories) {
+      return false;
+    }
+  }
+  for (size_t h = 0; h < num_histories; ++h) {
+    const open_spiel::Player player = player_to_act_[h];
+    if (parent_[h] >= num_histories || player < -1 ||
+        player >= static_cast<open_spiel::Player>(num_players_) ||
+        (player >= 0 &&
+         info_set_id_[h] >= info_state_keys_[player].size())) {
+      return false;
+    }
+    // Terminal histories index their returns instead of their edges.
+    const size_t end = num_actions_[h] == 0 ? returns_.size() : num_edges;
+    const size_t count = num_actions_[h] == 0 ? num_players_ : num_actions_[h];
+    if (first_action_[h] > end || count > end - first_action_[h]) {
+      return false;
+    }
+  }
+  // Traversals recurse into children until they reach a terminal, so the
+  // edges must form a DAG. Each history's `parent_` must also be one of the
+  // histories with an edge to it.
+  std::vector<size_t> num_parents(num_histories, 0);
+  std::vector<bool> parent_has_edge(num_histories, false);
+  for (size_t h = 0; h < num_histories; ++h) {
+    ForEachDescendant(h, 1, [this, h, &num_parents,
+                             &parent_has_edge](size_t child) {
+      ++num_parents[child];
+      parent_has_edge[child] =
+          parent_has_edge[child] || parent_[child] == h;
+    });
+  }
+  if (parent_[0] != 0) {
+    return false;
+  }
+  for (size_t h = 1; h < num_histories; ++h) {
+    if (!parent_has_edge[h]) {
+      return false;
+    }
+  }
+  // Removes histories without remaining parents until none are left, which
+  // fails on a cycle.
+  std::vector<size_t> sources;
+  for (size_t h = 0; h < num_histories; ++h) {
+    if (num_parents[h] == 0) {
+      sources.push_back(h);
+    }
+  }
+  size_t num_removed = 0;
+  while (!sources.empty()) {
+    const size_t h = sources.back();
+    sources.pop_back();
+    ++num_removed;
+    ForEachDescendant(h, 1, [&num_parents, &sources](size_t child) {
+      if (--num_parents[child] == 0) {
+        sources.push_back(child);
+      }
+    });
+  }
+  return num_removed == num_histories;
+}
+
+bool CompiledTree::HasSharedChildren() const {
+  std::vector<bool> has_parent(parent_.size(), false);
+  for (const size_t child : outcome_children_) {
+    if (has_parent[child]) {
+      return true;
+    }
+    has_parent[child] = true;
+  }
+  return false;
+}
+
+void CompiledTree::AccumulateOutcomeProbs() {
+  // Summed in the same order as `SampleActionIndex` so that sampling
+  // selects the same outcomes.
+  cumulative_outcome_probs_.resize(outcome_probs_.size());
+  for (size_t e = 0; e + 1 < first_outcome_.size(); ++e) {
+    double cumulative_prob = 0;
+    for (size_t i = first_outcome_[e]; i < first_outcome_[e + 1]; ++i) {
+      cumulative_prob += outcome_probs_[i];
+      cumulative_outcome_probs_[i] = cumulative_prob;
+    }
+  }
+}
+
+void CompiledTree::CompileInParallel(ChildStates& child_states,
+                                     size_t num_threads) {
+  // A history whose subtree is compiled into its own tree and then appended
+  // in order, so the result is identical to compiling serially. Histories
+  // are expanded a level at a time until there are enough subtrees to keep
+  // `num_threads` threads busy. An expanded history's tree only holds its
+  // children, and its `parts` are the subtrees below them.
+  struct Part {
+    size_t h;
+    std::shared_ptr<const open_spiel::State> state;
+    std::unique_ptr<CompiledTree> tree;
+    std::vector<Part> parts;
+  };
+  const auto new_tree = [this](const Part& part) {
+    std::unique_ptr<CompiledTree> tree(new CompiledTree(
+        num_players_, num_distinct_actions_, save_terminals_, save_states_));
+    tree->info_set_ids_.resize(num_players_);
+    tree->NewHistory(0, part.state->CurrentPlayer(), part.state);
+    return tree;
+  };
+
+  std::vector<Part> parts;
+  for (auto& [child, child_state] : child_states) {
+    parts.push_back({child, std::move(child_state), nullptr, {}});
+  }
+  child_states.clear();
+  std::vector<Part*> leaves;
+  for (Part& part : parts) {
+    leaves.push_back(&part);
+  }
+  while (!leaves.empty() && leaves.size() < num_threads) {
+    std::vector<Part*> next_leaves;
+    for (Part* part : leaves) {
+      part->tree = new_tree(*part);
+      ChildStates grandchild_states;
+      part->tree->Expand(0, *part->state, grandchild_states);
+      part->state.reset();
+      for (auto& [grandchild, grandchild_state] : grandchild_states) {
+        part->parts.push_back(
+            {grandchild, std::move(grandchild_state), nullptr, {}});
+      }
+    }
+    // Only once `parts` have stopped growing.
+    for (Part* part : leaves) {
+      for (Part& child_part : part->parts) {
+        next_leaves.push_back(&child_part);
+      }
+    }
+    leaves = std::move(next_leaves);
+  }
+
+  std::atomic<size_t> next_leaf(0);
+  const auto compile_leaves = [&leaves, &next_leaf, &new_tree] {
+    for (size_t i = next_leaf++; i < leaves.size(); i = next_leaf++) {
+      Part& part = *leaves[i];
+      part.tree = new_tree(part);
+      part.tree->Compile(0, *part.state);
+      part.tree->info_set_ids_ = PlayerMap<InfoStateUvm<size_t>>();
+      part.state.reset();
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < std::min(num_threads, leaves.size()); ++i) {
+    threads.emplace_back(compile_leaves);
+  }
+  Wait(threads);
+
+  const auto append_parts = [](CompiledTree& tree, std::vector<Part>& parts,
+                               const auto& append_parts) -> void {
+    for (Part& part : parts) {
+      append_parts(*part.tree, part.parts, append_parts);
+      part.tree->info_set_ids_ = PlayerMap<InfoStateUvm<size_t>>();
+      tree.Append(part.h, *part.tree);
+      part.tree.reset();
+    }
+  };
+  append_parts(*this, parts, append_parts);
+}
+
+void CompiledTree::Append(size_t h, const CompiledTree& subtree) {
+  // Subtree history 0 is `h` and the rest are appended after the current
+  // histories, so local history i > 0 becomes `history_offset + i`.
+  const size_t history_offset = parent_.size() - 1;
+  const size_t edge_offset = first_outcome_.size() - 1;
+  const size_t outcome_offset = outcome_children_.size();
+  const size_t returns_offset = returns_.size();
+  const auto global_history = [h, history_offset](size_t i) {
+    return i == 0 ? h : history_offset + i;
+  };
+
+  PlayerMap<std::vector<size_t>> global_ids(num_players_);
+  for (open_spiel::Player player = 0; player < num_players_; ++player) {
+    for (const std::string& key : subtree.info_state_keys_[player]) {
+      global_ids[player].push_back(InfoSetId(player, key));
+    }
+  }
+
+  first_action_[h] = subtree.first_action_[0] + edge_offset;
+  num_actions_[h] = subtree.num_actions_[0];
+  for (size_t i = 1; i < subtree.parent_.size(); ++i) {
+    const open_spiel::Player player = subtree.player_to_act_[i];
+    parent_.push_back(global_history(subtree.parent_[i]));
+    player_to_act_.push_back(player);
+    info_set_id_.push_back(
+        player < 0 ? 0 : global_ids[player][subtree.info_set_id_[i]]);
+    num_actions_.push_back(subtree.num_actions_[i]);
+    first_action_.push_back(
+        subtree.first_action_[i] +
+        (subtree.num_actions_[i] == 0 ? returns_offset : edge_offset));
+    if (save_states_) {
+      os_states_.push_back(subtree.os_states_[i]);
+    }
+  }
+  for (size_t e = 1; e < subtree.first_outcome_.size(); ++e) {
+    first_outcome_.push_back(subtree.first_outcome_[e] + outcome_offset);
+  }
+  for (const size_t child : subtree.outcome_children_) {
+    outcome_children_.push_back(global_history(child));
+  }
+  Concat(outcome_probs_, subtree.outcome_probs_);
+  Concat(returns_, subtree.returns_);
+}
+
+bool CompiledTree::Write(const std::string& file_name,
+                         const std::string& key) const {
+  std::ofstream out(file_name, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    return false;
+  }
+  WriteString(out, kTreeFileMagic);
+  WriteString(out, key);
+  WriteArray(out, std::vector<uint64_t>{num_players_, num_distinct_actions_});
+  WriteArray(out, parent_);
+  WriteArray(out, player_to_act_);
+  WriteArray(out, info_set_id_);
+  WriteArray(out, first_action_);
+  WriteArray(out, num_actions_);
+  WriteArray(out, first_outcome_);
+  WriteArray(out, outcome_children_);
+  WriteArray(out, outcome_probs_);
+  WriteArray(out, returns_);
+  for (const auto& keys : info_state_keys_) {
+    WriteArray(out, std::vector<uint64_t>{keys.size()});
+    for (const auto& info_state_key : keys) {
+      WriteString(out, info_state_key);
+    }
+  }
+  out.close();
+  return !out.fail();
+}
+
+std::unique_ptr<CompiledTree> CompiledTree::Read(const std::string& file_name,
+                                                 const std::string& key) {
+  const int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+    close(fd);
+    return nullptr;
+  }
+  const size_t size = file_stat.st_size;
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return nullptr;
+  }
+  madvise(data, size, MADV_SEQUENTIAL);
+
+  TreeFileReader reader(static_cast<const char*>(data), size);
+  std::unique_ptr<CompiledTree> tree;
+  std::string magic;
+  std::string file_key;
+  std::vector<uint64_t> sizes;
+  if (reader.ReadString(magic) && magic == kTreeFileMagic &&
+      reader.ReadString(file_key) && file_key == key &&
+      reader.ReadArray(sizes) && sizes.size() == 2 && sizes[0] > 0 &&
+      // Each player's key table starts with its size.
+      sizes[0] <= reader.Remaining() / sizeof(uint64_t)) {
+    tree.reset(new CompiledTree(sizes[0], sizes[1], false, false));
+    bool ok = reader.ReadArray(tree->parent_) &&
+              reader.ReadArray(tree->player_to_act_) &&
+              reader.ReadArray(tree->info_set_id_) &&
+              reader.ReadArray(tree->first_action_) &&
+              reader.ReadArray(tree->num_actions_) &&
+              reader.ReadArray(tree->first_outcome_) &&
+              reader.ReadArray(tree->outcome_children_) &&
+              reader.ReadArray(tree->outcome_probs_) &&
+              reader.ReadArray(tree->returns_);
+    for (auto& keys : tree->info_state_keys_) {
+      // Each key starts with its length.
+      ok = ok && reader.ReadArray(sizes) && sizes.size() == 1 &&
+           sizes[0] <= reader.Remaining() / sizeof(uint64_t);
+      if (ok) {
+        keys.resize(sizes[0]);
+        for (auto& info_state_key : keys) {
+          ok = ok && reader.ReadString(info_state_key);
+        }
+      }
+    }
+    if (!ok || !reader.Done() || !tree->IsConsistent()) {
+      tree.reset();
+    } else {
+      tree->AccumulateOutcomeProbs();
+      tree->merged_ = tree->HasSharedChildren();
+    }
+  }
+  munmap(data, size);
+  return tree;
+}
+
+std::unique_ptr<CompiledTree> CompiledTree::Relaid(TreeLayout layout) const {
+  std::vector<size_t> order;
+  order.reserve(parent_.size());
+  switch (layout) {
+    case TreeLayout::kSiblingsFirst:
+      order.push_back(0);
+      SiblingsFirstOrder(0, order);
+      break;
+    case TreeLayout::kPreOrder:
+      PreOrder(0, order);
+      break;
+    case TreeLayout::kBlocked:
+      BlockedOrder(0, Height(0), order);
+      break;
+  }
+  SPIEL_CHECK_EQ(order.size(), parent_.size());
+  std::vector<size_t> new_index(order.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    new_index[order[i]] = i;
+  }
+  return Rebuilt(order, new_index);
+}
+
+std::unique_ptr<CompiledTree> CompiledTree::Merged() const {
+  SPIEL_CHECK_FALSE(save_states_);
+  // Histories are hashed bottom-up, so two histories are merged when they
+  // act alike and their children were merged pairwise.
+  std::vector<size_t> canonical(parent_.size());
+  absl::flat_hash_map<std::vector<uint64_t>, size_t> canonical_by_signature;
+  std::vector<size_t> post_order;
+  PreOrder(0, post_order);
+  std::reverse(post_order.begin(), post_order.end());
+  std::vector<uint64_t> signature;
+  for (const size_t h : post_order) {
+    signature.clear();
+    signature.push_back(num_actions_[h]);
+    signature.push_back(player_to_act_[h]);
+    signature.push_back(info_set_id_[h]);
+    if (num_actions_[h] == 0) {
+      for (size_t i = 0; i < num_players_; ++i) {
+        signature.push_back(absl::bit_cast<uint64_t>(
+            returns_[first_action_[h] + i]));
+      }
+    }
+    for (size_t e = first_action_[h]; e < first_action_[h] + num_actions_[h];
+         ++e) {
+      signature.push_back(first_outcome_[e + 1] - first_outcome_[e]);
+      for (size_t i = first_outcome_[e]; i < first_outcome_[e + 1]; ++i) {
+        signature.push_back(canonical[outcome_children_[i]]);
+        signature.push_back(absl::bit_cast<uint64_t>(outcome_probs_[i]));
+      }
+    }
+    canonical[h] =
+        canonical_by_signature.try_emplace(signature, h).first->second;
+  }
+
+  // Lay out the distinct histories siblings-first.
+  std::vector<size_t> order(1, 0);
+  std::vector<bool> visited(parent_.size(), false);
+  visited[0] = true;
+  for (size_t next = 0; next < order.size(); ++next) {
+    ForEachDescendant(order[next], 1,
+                      [&canonical, &order, &visited](size_t child) {
+                        const size_t c = canonical[child];
+                        if (!visited[c]) {
+                          visited[c] = true;
+                          order.push_back(c);
+                        }
+                      });
+  }
+  std::vector<size_t> new_index(parent_.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    new_index[order[i]] = i;
+  }
+  for (size_t h = 0; h < parent_.size(); ++h) {
+    new_index[h] = new_index[canonical[h]];
+  }
+  return Rebuilt(order, new_index);
+}
+
+std::unique_ptr<CompiledTree> CompiledTree::Rebuilt(
+    const std::vector<size_t>& order,
+    const std::vector<size_t>& new_index) const {
+  std::unique_ptr<CompiledTree> tree(new CompiledTree(
+      num_players_, num_distinct_actions_, save_terminals_, save_states_));
+  tree->info_state_keys_ = info_state_keys_;
+  tree->info_set_id_space_ = info_set_id_space_;
+  for (const size_t h : order) {
+    tree->parent_.push_back(new_index[parent_[h]]);
+    tree->player_to_act_.push_back(player_to_act_[h]);
+    tree->info_set_id_.push_back(info_set_id_[h]);
+    tree->num_actions_.push_back(num_actions_[h]);
+    if (save_states_) {
+      tree->os_states_.push_back(os_states_[h]);
+    }
+    if (num_actions_[h] == 0) {
+      tree->first_action_.push_back(tree->returns_.size());
+      for (size_t i = 0; i < num_players_; ++i) {
+        tree->returns_.push_back(returns_[first_action_[h] + i]);
+      }
+      continue;
+    }
+    tree->first_action_.push_back(tree->first_outcome_.size() - 1);
+    for (size_t e = first_action_[h]; e < first_action_[h] + num_actions_[h];
+         ++e) {
+      for (size_t i = first_outcome_[e]; i < first_outcome_[e + 1]; ++i) {
+        tree->outcome_children_.push_back(new_index[outcome_children_[i]]);
+        tree->outcome_probs_.push_back(outcome_probs_[i]);
+      }
+      tree->first_outcome_.push_back(tree->outcome_children_.size());
+    }
+  }
+  tree->AccumulateOutcomeProbs();
+  tree->merged_ = tree->HasSharedChildren();
+  return tree;
+}
+
+size_t CompiledTree::Height(size_t h) const {
+  size_t height = 0;
+  ForEachDescendant(h, 1, [this, &height](size_t child) {
+    height = std::max(height, Height(child));
+  });
+  return height + 1;
+}
+
+void CompiledTree::SiblingsFirstOrder(size_t h,
+                                      std::vector<size_t>& order) const {
+  const size_t first_child = order.size();
+  ForEachDescendant(h, 1, [&order](size_t child) { order.push_back(child); });
+  const size_t last_child = order.size();
+  for (size_t i = first_child; i < last_child; ++i) {
+    SiblingsFirstOrder(order[i], order);
+  }
+}
+
+void CompiledTree::PreOrder(size_t h, std::vector<size_t>& order) const {
+  order.push_back(h);
+  ForEachDescendant(h, 1, [this, &order](size_t child) {
+    PreOrder(child, order);
+  });
+}
+
+void CompiledTree::BlockedOrder(size_t h, size_t height,
+                                std::vector<size_t>& order) const {
+  if (height == 1) {
+    order.push_back(h);
+    return;
+  }
+  const size_t top_height = height / 2;
+  BlockedOrder(h, top_height, order);
+  ForEachDescendant(h, top_height,
+                    [this, height, top_height, &order](size_t bottom_root) {
+                      BlockedOrder(bottom_root, height - top_height, order);
+                    });
+}
+
+void CompiledTree::ForEachDescendant(
+    size_t h, size_t depth, const std::function<void(size_t)>& f) const {
+  if (depth == 0) {
+    f(h);
+    return;
+  }
+  for (size_t e = first_action_[h]; e < first_action_[h] + num_actions_[h];
+       ++e) {
+    for (size_t i = first_outcome_[e]; i < first_outcome_[e + 1]; ++i) {
+      ForEachDescendant(outcome_children_[i], depth - 1, f);
+    }
+  }
+}
+
+size_t CompiledTree::NewHistory(
+    size_t parent_idx, open_spiel::Player player,
+    const std::shared_ptr<const open_spiel::State>& os_state) {
+  const size_t h = parent_.size();
+  parent_.push_back(parent_idx);
+  player_to_act_.push_back(player);
+  info_set_id_.push_back(
+      player < 0 ? 0 : InfoSetId(player, os_state->InformationStateString()));
+  first_action_.push_back(first_outcome_.size() - 1);
+  num_actions_.push_back(0);
+  if (save_states_) {
+    os_states_.push_back(os_state);
+  }
+  return h;
+}
+
+size_t CompiledTree::InfoSetId(open_spiel::Player player,
+                               const std::string& key) {
+  auto& ids = info_set_ids_[player];
+  auto iter = ids.find(key);
+  if (iter == ids.end()) {
+    iter = ids.emplace(key, info_state_keys_[player].size()).first;
+    info_state_keys_[player].push_back(key);
+  }
+  return iter->second;
+}
+
+size_t CompiledTree::NewTerminal(size_t parent_idx,
+                                 open_spiel::StatePtr&& os_state) {
+  const std::vector<double> returns = os_state->Returns();
+  const size_t h = NewHistory(
+      parent_idx, -1,
+      save_terminals_ ? std::shared_ptr<const open_spiel::State>(
+                            std::move(os_state))
+                      : nullptr);
+  first_action_[h] = returns_.size();
+  Concat(returns_, returns);
+  return h;
+}
+
+void CompiledTree::Compile(size_t h, const open_spiel::State& os_state) {
+  ChildStates child_states;
+  Expand(h, os_state, child_states);
+  // The children of each history are contiguous and precede their subtrees.
+  for (auto& [child, child_state] : child_states) {
+    Compile(child, *child_state);
+    child_state.reset();
+  }
+}
+
+void CompiledTree::Expand(size_t h, const open_spiel::State& os_state,
+                          ChildStates& child_states) {
+  first_action_[h] = first_outcome_.size() - 1;
+  if (os_state.IsChanceNode()) {
+    num_actions_[h] = 1;
+    CompileOutcomes(os_state, 1.0, h, child_states);
+    first_outcome_.push_back(outcome_children_.size());
+  } else {
+    const auto actions = os_state.LegalActions();
+    num_actions_[h] = actions.size();
+    for (const open_spiel::Action a : actions) {
+      CompileOutcomes(os_state.Child(a), 1.0, h, child_states);
+      first_outcome_.push_back(outcome_children_.size());
+    }
+  }
+}
+
+void CompiledTree::CompileOutcomes(const open_spiel::State& child,
+                                   double prob, size_t parent_idx,
+                                   ChildStates& child_states) {
+  for (const auto& [outcome, next_prob] : child.ChanceOutcomes()) {
+    CompileOutcomes(child.Child(outcome), prob * next_prob, parent_idx,
+                    child_states);
+  }
+}
+
+void CompiledTree::CompileOutcomes(open_spiel::StatePtr&& child, double prob,
+                                   size_t parent_idx,
+                                   ChildStates& child_states) {
+  // Since `child` is owned here, its last successor is reached by applying
+  // an action in place rather than cloning.
+  size_t h;
+  if (child->IsChanceNode()) {
+    const auto outcomes = child->ChanceOutcomes();
+    for (size_t i = 0; i < outcomes.size() - 1; ++i) {
+      CompileOutcomes(child->Child(outcomes[i].first),
+                      prob * outcomes[i].second, parent_idx, child_states);
+    }
+    child->ApplyAction(outcomes.back().first);
+    CompileOutcomes(std::move(child), prob * outcomes.back().second,
+                    parent_idx, child_states);
+    return;
+  } else if (child->IsTerminal()) {
+    h = NewTerminal(parent_idx, std::move(child));
+  } else {
+    const auto actions = child->LegalActions();
+    if (actions.size() < 2) {
+      child->ApplyAction(actions[0]);
+      CompileOutcomes(std::move(child), prob, parent_idx, child_states);
+      return;
+    }
+    const open_spiel::Player player = child->CurrentPlayer();
+    std::shared_ptr<const open_spiel::State> child_state(std::move(child));
+    h = NewHistory(parent_idx, player, child_state);
+    child_states.emplace_back(h, std::move(child_state));
+  }
+  outcome_children_.push_back(h);
+  outcome_probs_.push_back(prob);
+}
+
+}  // namespace _decision_point
+
+CompiledDecisionPoint::CompiledDecisionPoint(open_spiel::StatePtr&& root,
+                                             bool save_root,
+                                             bool save_terminals,
+                                             bool save_states,
+                                             size_t num_threads)
+    : DecisionPoint(root->NumPlayers(), root->NumDistinctActions()),
+      tree_(),
+      idx_(0),
+      use_path_(false),
+      path_() {
+  auto tree = std::make_shared<_decision_point::CompiledTree>(
+      NumPlayers(), NumDistinctActions(), save_terminals, save_states);
+  tree->Compile(std::move(root), save_root, num_threads);
+  tree_ = std::move(tree);
+  use_path_ = tree_->merged_;
+}
+
+CompiledDecisionPoint::CompiledDecisionPoint(
+    std::shared_ptr<const _decision_point::CompiledTree>&& tree)
+    : DecisionPoint(tree->num_players_, tree->num_distinct_actions_),
+      tree_(std::move(tree)),
+      idx_(0),
+      use_path_(tree_->merged_),
+      path_() {}
+
+std::unique_ptr<CompiledDecisionPoint> CompiledDecisionPoint::Read(
+    const std::string& file_name, const std::string& key) {
+  std::shared_ptr<const _decision_point::CompiledTree> tree =
+      _decision_point::CompiledTree::Read(file_name, key);
+  if (!tree) {
+    return nullptr;
+  }
+  return std::unique_ptr<CompiledDecisionPoint>(
+      new CompiledDecisionPoint(std::move(tree)));
+}
+
+template <class DP>
 void _ForEachState(absl::flat_hash_set<std::string>& already_observed,
-                   DecisionPoint& decision_point,
+                   DP& decision_point,
                    const std::function<void(const DecisionPoint&)>& f,
                    int player) {
   if (decision_point.IsTerminal()) {
     return;
   }
-  const std::string info_state = decision_point.InformationStateString();
   if (player < 0 || player == decision_point.PlayerToAct()) {
+    const std::string& info_state = decision_point.InformationStateStringRef();
     if (!already_observed.contains(info_state)) {
       f(decision_point);
-      already_observed.insert(std::move(info_state));
+      already_observed.insert(info_state);
     };
   }
   for (size_t a = 0; a < decision_point.NumActions(); ++a) {
@@ -101,15 +954,66 @@ void ForEachState(DecisionPoint& root,
                   const std::function<void(const DecisionPoint&)>& f,
                   int player) {
   absl::flat_hash_set<std::string> already_observed;
-  if (root.NumActions() < 2) {
-    for (size_t outcome = 0; outcome < root.NumOutcomes(0); ++outcome) {
-      root.Apply(0, outcome);
-      _ForEachState(already_observed, root, f, player);
-      root.Undo();
+  WithConcreteDecisionPoint(root, [&already_observed, &f,
+                                   player](auto& concrete_root) {
+    if (concrete_root.NumActions() < 2) {
+      for (size_t outcome = 0; outcome < concrete_root.NumOutcomes(0);
+           ++outcome) {
+        concrete_root.Apply(0, outcome);
+        _ForEachState(already_observed, concrete_root, f, player);
+        concrete_root.Undo();
+      }
+    } else {
+      _ForEachState(already_observed, concrete_root, f, player);
     }
-  } else {
-    _ForEachState(already_observed, root, f, player);
+  });
+}
+
+std::string TreeCacheKey(const open_spiel::Game& game) {
+  return absl::StrCat(game.ToString(), " @ open_spiel ",
+                      HR_EDL_OPEN_SPIEL_COMMIT);
+}
+
+std::string TreeCacheFileName(const open_spiel::Game& game,
+                              const std::string& cache_dir) {
+  return absl::StrCat(cache_dir, "/",
+                      absl::Hex(Fnv1aHash(TreeCacheKey(game)),
+                                absl::kZeroPad16),
+                      ".tree");
+}
+
+std::unique_ptr<CompiledDecisionPoint> LoadOrCompileTree(
+    const open_spiel::Game& game, const std::string& cache_dir,
+    size_t num_threads) {
+  if (cache_dir.empty()) {
+    return std::make_unique<CompiledDecisionPoint>(
+        game.NewInitialState(), false, false, false, num_threads);
+  }
+  const std::string key = TreeCacheKey(game);
+  const std::string file_name = TreeCacheFileName(game, cache_dir);
+  if (auto root = CompiledDecisionPoint::Read(file_name, key);
+      root && root->NumPlayers() == game.NumPlayers() &&
+      root->NumDistinctActions() == game.NumDistinctActions()) {
+    return root;
+  }
+  auto root = std::make_unique<CompiledDecisionPoint>(
+      game.NewInitialState(), false, false, false, num_threads);
+  // Write to a private file first so that concurrent runs never read a
+  // partially written tree.
+  if (!MakeDirs(cache_dir)) {
+    const int error = errno;
+    std::cerr << "Warning: cannot create tree cache directory " << cache_dir
+              << ": " << std::strerror(error) << std::endl;
+    return root;
+  }
+  const std::string tmp_file_name = absl::StrCat(file_name, ".", getpid());
+  if (!root->Write(tmp_file_name, key) ||
+      std::rename(tmp_file_name.c_str(), file_name.c_str()) != 0) {
+    std::remove(tmp_file_name.c_str());
+    std::cerr << "Warning: cannot write tree cache file " << file_name
+              << std::endl;
   }
+  return root;
 }
 
 int NumStates(DecisionPoint& root, int player) {
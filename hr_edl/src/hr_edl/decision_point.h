@@ -1,14 +1,30 @@
 #ifndef HR_EDL_DECISION_POINT_H_
 #define HR_EDL_DECISION_POINT_H_
 
+#include <algorithm>
+#include <functional>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
+#include "absl/types/span.h"
 #include "open_spiel/spiel.h"
 #include "hr_edl/spiel_extra.h"
 
 namespace hr_edl {
 
+// Orders in which a compiled tree can store its histories.
+enum class TreeLayout {
+  // The children of each history are contiguous and precede their subtrees.
+  // This is the order in which trees are compiled.
+  kSiblingsFirst,
+  // Depth-first pre-order.
+  kPreOrder,
+  // A van Emde Boas layout over depth: the top half of the tree's levels is
+  // laid out recursively, followed by each of the subtrees below it.
+  kBlocked
+};
+
 // A private namespace.
 namespace _decision_point {
 class Outcomes {
@@ -36,6 +52,7 @@ class HistoryCache {
         parent_idx_(0),
         info_state_key_(),
         player_to_act_(-1),
+        info_set_id_(0),
         outcomes_(),
         returns_() {}
   HistoryCache(std::vector<double>&& returns, size_t parent_idx)  // Terminal
@@ -43,6 +60,7 @@ class HistoryCache {
         parent_idx_(parent_idx),
         info_state_key_(),
         player_to_act_(-1),
+        info_set_id_(0),
         outcomes_(),
         returns_(std::move(returns)) {
     SPIEL_CHECK_TRUE(IsTerminal());
@@ -52,6 +70,7 @@ class HistoryCache {
         parent_idx_(0),
         info_state_key_(),
         player_to_act_(-1),
+        info_set_id_(0),
         outcomes_(),
         returns_(os_state_->IsTerminal() ? os_state_->Returns()
                                          : std::vector<double>()) {
@@ -64,6 +83,7 @@ class HistoryCache {
             os_state_->IsTerminal() ? "" : os_state_->InformationStateString()),
         player_to_act_(os_state_->IsTerminal() ? -1
                                                : os_state_->CurrentPlayer()),
+        info_set_id_(0),
         outcomes_(),
         returns_(os_state_->IsTerminal() ? os_state_->Returns()
                                          : std::vector<double>()) {
@@ -77,12 +97,134 @@ class HistoryCache {
   bool IsTerminal() const { return !returns_.empty(); }
 
  public:
-  const std::shared_ptr<const open_spiel::State> os_state_;
-  const size_t parent_idx_;
-  const std::string info_state_key_;
-  const open_spiel::Player player_to_act_;
+  // Not const so that the slots of evicted histories can be reused.
+  std::shared_ptr<const open_spiel::State> os_state_;
+  size_t parent_idx_;
+  std::string info_state_key_;
+  open_spiel::Player player_to_act_;
+  size_t info_set_id_;
   std::vector<Outcomes> outcomes_;
-  const std::vector<double> returns_;
+  std::vector<double> returns_;
+};
+
+// The arrays behind a `CompiledDecisionPoint`.
+//
+// History properties are stored in flat arrays indexed by history. The
+// actions of history `h` are the edges
+// `[first_action_[h], first_action_[h] + num_actions_[h])` and the outcomes of
+// edge `e` are `[first_outcome_[e], first_outcome_[e + 1])`. Terminal
+// histories have no actions, so `first_action_` instead indexes the first of
+// their `num_players_` entries in `returns_`.
+class CompiledTree {
+ public:
+  CompiledTree(size_t num_players, size_t num_distinct_actions,
+               bool save_terminals, bool save_states);
+
+  // Compiles the subtrees below the root on up to `num_threads` threads.
+  void Compile(open_spiel::StatePtr&& root, bool save_root,
+               size_t num_threads);
+  bool Write(const std::string& file_name, const std::string& key) const;
+  static std::unique_ptr<CompiledTree> Read(const std::string& file_name,
+                                            const std::string& key);
+  // A copy of this tree with its histories, edges, and outcomes stored in
+  // `layout` order.
+  std::unique_ptr<CompiledTree> Relaid(TreeLayout layout) const;
+  // A copy of this tree in which equivalent subtrees are stored once, so the
+  // result may be a DAG. Requires that OpenSpiel states are not saved.
+  std::unique_ptr<CompiledTree> Merged() const;
+
+ private:
+  using ChildStates = std::vector<
+      std::pair<size_t, std::shared_ptr<const open_spiel::State>>>;
+
+  size_t NewHistory(size_t parent_idx, open_spiel::Player player,
+                    const std::shared_ptr<const open_spiel::State>& os_state);
+  size_t NewTerminal(size_t parent_idx, open_spiel::StatePtr&& os_state);
+  size_t InfoSetId(open_spiel::Player player, const std::string& key);
+  void Compile(size_t h, const open_spiel::State& os_state);
+  void Expand(size_t h, const open_spiel::State& os_state,
+              ChildStates& child_states);
+  void CompileInParallel(ChildStates& child_states, size_t num_threads);
+  // Appends `subtree`, whose root is history `h` of this tree.
+  void Append(size_t h, const CompiledTree& subtree);
+  void CompileOutcomes(open_spiel::StatePtr&& child, double prob,
+                       size_t parent_idx, ChildStates& child_states);
+  void CompileOutcomes(const open_spiel::State& child, double prob,
+                       size_t parent_idx, ChildStates& child_states);
+  void AccumulateOutcomeProbs();
+  // Whether every index in the arrays is in range and the edges form a DAG
+  // that agrees with `parent_`, as a tree read from a file may not.
+  bool IsConsistent() const;
+  bool HasSharedChildren() const;
+  // Copies the histories in `order`, redirecting each edge to history `h` to
+  // `new_index[h]`.
+  std::unique_ptr<CompiledTree> Rebuilt(
+      const std::vector<size_t>& order,
+      const std::vector<size_t>& new_index) const;
+  size_t Height(size_t h) const;
+  void SiblingsFirstOrder(size_t h, std::vector<size_t>& order) const;
+  void PreOrder(size_t h, std::vector<size_t>& order) const;
+  void BlockedOrder(size_t h, size_t height, std::vector<size_t>& order) const;
+  void ForEachDescendant(size_t h, size_t depth,
+                         const std::function<void(size_t)>& f) const;
+
+ public:
+  const size_t num_players_;
+  const size_t num_distinct_actions_;
+
+  // History arrays
+  // In a merged tree, this is only one of possibly many parents.
+  std::vector<size_t> parent_;
+  std::vector<open_spiel::Player> player_to_act_;
+  std::vector<size_t> info_set_id_;
+  std::vector<size_t> first_action_;
+  std::vector<size_t> num_actions_;
+  // Empty unless `save_states_`.
+  std::vector<std::shared_ptr<const open_spiel::State>> os_states_;
+
+  // Edge and outcome arrays
+  std::vector<size_t> first_outcome_;
+  std::vector<size_t> outcome_children_;
+  std::vector<double> outcome_probs_;
+  // Running sums of `outcome_probs_` within each edge, for sampling.
+  std::vector<double> cumulative_outcome_probs_;
+
+  std::vector<double> returns_;
+  std::vector<std::vector<std::string>> info_state_keys_;
+  // Shared with the trees relaid or merged from this one, whose IDs are the
+  // same.
+  size_t info_set_id_space_;
+  const std::string empty_info_state_key_;
+  const bool save_terminals_;
+  const bool save_states_;
+  // Whether some history has more than one parent.
+  bool merged_;
+
+ private:
+  // Only used during compilation.
+  PlayerMap<InfoStateUvm<size_t>> info_set_ids_;
+};
+}  // namespace _decision_point
+
+// A new value for `DecisionPoint::InfoSetIdSpace`, unique within the process.
+size_t NewInfoSetIdSpace();
+
+namespace _decision_point {
+// The ID space of a tree that assigns IDs as it grows. A copy gets a new
+// space, since the copies may go on to assign the same new ID to different
+// information sets.
+class GrowingIdSpace {
+ public:
+  GrowingIdSpace() : id_space_(NewInfoSetIdSpace()) {}
+  GrowingIdSpace(const GrowingIdSpace&) : GrowingIdSpace() {}
+  GrowingIdSpace& operator=(const GrowingIdSpace&) {
+    id_space_ = NewInfoSetIdSpace();
+    return *this;
+  }
+  size_t Get() const { return id_space_; }
+
+ private:
+  size_t id_space_;
 };
 }  // namespace _decision_point
 
@@ -104,21 +246,41 @@ class DecisionPoint {
   std::string InformationStateString() const {
     return InformationStateStringRef();
   }
+  // A dense, per-player index of the acting player's information set. IDs are
+  // assigned by the tree that caches the history, so they are only
+  // comparable between decision points that share the same tree or copies of
+  // it.
+  virtual size_t InfoSetId() const = 0;
+  // Identifies the mapping from IDs to information sets. Decision points
+  // with the same ID space assign the same ID to the same information set,
+  // so storage keyed by ID only needs to check the space once per traversal
+  // rather than the information state of every lookup.
+  virtual size_t InfoSetIdSpace() const = 0;
+  // The number of IDs assigned to `player`'s information sets so far.
+  virtual size_t NumInfoSets(open_spiel::Player player) const = 0;
   virtual size_t NumActions() const = 0;
   virtual bool IsRoot() const = 0;
   virtual open_spiel::Player PlayerToAct() const = 0;
   virtual bool IsTerminal() const = 0;
-  virtual const std::vector<double>& ReturnsRef() const = 0;
-  std::vector<double> Returns() const { return ReturnsRef(); }
+  virtual absl::Span<const double> ReturnsRef() const = 0;
+  std::vector<double> Returns() const {
+    const auto returns = ReturnsRef();
+    return std::vector<double>(returns.begin(), returns.end());
+  }
   virtual bool TerminalsAreSaved() const = 0;
 
   // Action-conditional properties
-  virtual const std::vector<double>& OutcomeProbabilitiesRef(
+  virtual absl::Span<const double> OutcomeProbabilitiesRef(
       size_t action) const = 0;
   std::vector<double> OutcomeProbabilities(size_t action) const {
-    return OutcomeProbabilitiesRef(action);
+    const auto probs = OutcomeProbabilitiesRef(action);
+    return std::vector<double>(probs.begin(), probs.end());
   }
   virtual size_t NumOutcomes(size_t action) const = 0;
+  // The outcome of `action` that `random_number`, drawn uniformly from
+  // [0, 1), selects. Matches `SampleActionIndex` on the outcome
+  // probabilities.
+  virtual size_t SampleOutcome(size_t action, double random_number) const;
 
   // Transformation methods
   virtual void Undo() = 0;
@@ -131,17 +293,44 @@ class DecisionPoint {
   size_t num_distinct_actions_;
 };
 
-class CachedDecisionPoint : public DecisionPoint {
+// Counters for the history lookups made by a `CachedDecisionPoint`.
+struct HistoryCacheStats {
+  // Transitions into a history that was already expanded.
+  size_t hits = 0;
+  // Transitions into a history that had to be expanded.
+  size_t misses = 0;
+  // Subtrees discarded to stay within capacity.
+  size_t evictions = 0;
+};
+
+// A lazily expanded game tree.
+//
+// If `capacity` is positive, the tree holds roughly at most `capacity`
+// histories. When an expansion exceeds it, the subtrees below cold histories
+// are discarded, chosen by a clock (second chance) sweep. A discarded
+// subtree is expanded again from its root's retained OpenSpiel state when it
+// is next visited. Histories on the path to the current history are never
+// discarded, so the capacity is exceeded when they alone do not fit.
+// Information set IDs are stable under eviction.
+class CachedDecisionPoint final : public DecisionPoint {
  public:
   CachedDecisionPoint(open_spiel::StatePtr&& root, bool save_root = false,
-                      bool save_terminals = false);
+                      bool save_terminals = false, size_t capacity = 0);
   CachedDecisionPoint(const open_spiel::State& root, bool save_root = false,
-                      bool save_terminals = false)
-      : CachedDecisionPoint(root.Clone(), save_root, save_terminals) {}
+                      bool save_terminals = false, size_t capacity = 0)
+      : CachedDecisionPoint(root.Clone(), save_root, save_terminals,
+                            capacity) {}
 
   const std::string& InformationStateStringRef() const override final {
     return histories_[idx_].info_state_key_;
   }
+  size_t InfoSetId() const override final {
+    return histories_[idx_].info_set_id_;
+  }
+  size_t InfoSetIdSpace() const override final { return id_space_.Get(); }
+  size_t NumInfoSets(open_spiel::Player player) const override final {
+    return info_set_ids_[player].size();
+  }
   std::shared_ptr<const open_spiel::State> OpenSpielState()
       const override final {
     return histories_[idx_].os_state_;
@@ -159,14 +348,14 @@ class CachedDecisionPoint : public DecisionPoint {
   bool IsTerminal() const override final {
     return histories_[idx_].IsTerminal();
   }
-  const std::vector<double>& OutcomeProbabilitiesRef(
+  absl::Span<const double> OutcomeProbabilitiesRef(
       size_t action) const override final {
     return histories_[idx_].outcomes_[action].Probs();
   }
   size_t NumOutcomes(size_t action) const override final {
     return histories_[idx_].outcomes_[action].Size();
   }
-  const std::vector<double>& ReturnsRef() const override final {
+  absl::Span<const double> ReturnsRef() const override final {
     return histories_[idx_].returns_;
   }
   bool TerminalsAreSaved() const override final {
@@ -176,28 +365,271 @@ class CachedDecisionPoint : public DecisionPoint {
   void UndoAll() override final { idx_ = 0; }
   void Apply(size_t action, size_t outcome) override final {
     idx_ = histories_[idx_].outcomes_[action].Idx(outcome);
-    CacheOutcomes();
+    if (IsTerminal() || !histories_[idx_].outcomes_.empty()) {
+      ++stats_.hits;
+    } else {
+      ++stats_.misses;
+      CacheOutcomes();
+    }
+    referenced_[idx_] = true;
+  }
+
+  // The number of histories currently held.
+  size_t NumHistories() const {
+    return histories_.size() - free_slots_.size();
   }
+  size_t Capacity() const { return capacity_; }
+  const HistoryCacheStats& Stats() const { return stats_; }
 
  protected:
   void RecursiveCache(const open_spiel::State& child, double prob, size_t aidx);
   void RecursiveCache(open_spiel::StatePtr&& child, double prob, size_t aidx);
   void CacheOutcomes();
+  void AssignInfoSetId(_decision_point::HistoryCache& history);
+  template <typename... Args>
+  size_t NewHistory(Args&&... args) {
+    if (free_slots_.empty()) {
+      histories_.emplace_back(std::forward<Args>(args)...);
+      referenced_.push_back(false);
+      return histories_.size() - 1;
+    }
+    const size_t h = free_slots_.back();
+    free_slots_.pop_back();
+    histories_[h] = _decision_point::HistoryCache(std::forward<Args>(args)...);
+    return h;
+  }
+  void Evict();
+  void DiscardSubtree(size_t h);
 
  private:
   size_t idx_;
   std::vector<_decision_point::HistoryCache> histories_;
+  PlayerMap<InfoStateUvm<size_t>> info_set_ids_;
+  _decision_point::GrowingIdSpace id_space_;
   bool save_terminals_;
+  size_t capacity_;
+  std::vector<size_t> free_slots_;
+  std::vector<bool> referenced_;
+  size_t clock_hand_;
+  HistoryCacheStats stats_;
+};
+
+// An eagerly expanded, immutable version of `CachedDecisionPoint`.
+//
+// The tree is compiled once and shared by all copies, so a copy is only a
+// cursor into the same tree and can traverse it concurrently with the
+// original.
+//
+// If `save_states` is false, OpenSpiel states are released as soon as their
+// subtree is compiled and `OpenSpielStatePtr()` always returns null. The tree
+// then only supports policies that can respond to a `DecisionPoint` directly,
+// e.g., policies that are keyed by information state.
+//
+// With `num_threads > 1`, the tree is expanded from the root, a level of
+// decision points at a time, until there are at least `num_threads` subtrees,
+// which are then compiled concurrently. The resulting tree is identical to a
+// serial compilation.
+class CompiledDecisionPoint final : public DecisionPoint {
+ public:
+  CompiledDecisionPoint(open_spiel::StatePtr&& root, bool save_root = false,
+                        bool save_terminals = false, bool save_states = true,
+                        size_t num_threads = 1);
+  CompiledDecisionPoint(const open_spiel::State& root, bool save_root = false,
+                        bool save_terminals = false, bool save_states = true,
+                        size_t num_threads = 1)
+      : CompiledDecisionPoint(root.Clone(), save_root, save_terminals,
+                              save_states, num_threads) {}
+
+  const std::string& InformationStateStringRef() const override final {
+    const open_spiel::Player player = tree_->player_to_act_[idx_];
+    return player < 0 ? tree_->empty_info_state_key_
+                      : tree_->info_state_keys_[player][InfoSetId()];
+  }
+  size_t InfoSetId() const override final {
+    return tree_->info_set_id_[idx_];
+  }
+  size_t InfoSetIdSpace() const override final {
+    return tree_->info_set_id_space_;
+  }
+  size_t NumInfoSets(open_spiel::Player player) const override final {
+    return tree_->info_state_keys_[player].size();
+  }
+  std::shared_ptr<const open_spiel::State> OpenSpielState()
+      const override final {
+    return StatesAreSaved() ? tree_->os_states_[idx_] : nullptr;
+  }
+  const open_spiel::State* OpenSpielStatePtr() const override final {
+    return StatesAreSaved() ? tree_->os_states_[idx_].get() : nullptr;
+  }
+  size_t NumActions() const override final {
+    return tree_->num_actions_[idx_];
+  }
+  bool IsRoot() const override final { return idx_ == 0; }
+  open_spiel::Player PlayerToAct() const override final {
+    return tree_->player_to_act_[idx_];
+  }
+  bool IsTerminal() const override final { return NumActions() == 0; }
+  absl::Span<const double> OutcomeProbabilitiesRef(
+      size_t action) const override final {
+    const size_t edge = tree_->first_action_[idx_] + action;
+    const size_t first = tree_->first_outcome_[edge];
+    return absl::MakeConstSpan(tree_->outcome_probs_.data() + first,
+                               tree_->first_outcome_[edge + 1] - first);
+  }
+  size_t NumOutcomes(size_t action) const override final {
+    const size_t edge = tree_->first_action_[idx_] + action;
+    return tree_->first_outcome_[edge + 1] - tree_->first_outcome_[edge];
+  }
+  size_t SampleOutcome(size_t action,
+                       double random_number) const override final {
+    const size_t edge = tree_->first_action_[idx_] + action;
+    const auto first =
+        tree_->cumulative_outcome_probs_.begin() + tree_->first_outcome_[edge];
+    const auto last = tree_->cumulative_outcome_probs_.begin() +
+                      tree_->first_outcome_[edge + 1] - 1;
+    return std::upper_bound(first, last, random_number) - first;
+  }
+  absl::Span<const double> ReturnsRef() const override final {
+    if (!IsTerminal()) {
+      return {};
+    }
+    return absl::MakeConstSpan(
+        tree_->returns_.data() + tree_->first_action_[idx_], NumPlayers());
+  }
+  bool TerminalsAreSaved() const override final {
+    return tree_->save_terminals_;
+  }
+  bool StatesAreSaved() const { return tree_->save_states_; }
+  void Undo() override final {
+    if (use_path_) {
+      idx_ = path_.back();
+      path_.pop_back();
+    } else {
+      idx_ = tree_->parent_[idx_];
+    }
+  }
+  void UndoAll() override final {
+    idx_ = 0;
+    path_.clear();
+  }
+  void Apply(size_t action, size_t outcome) override final {
+    if (use_path_) {
+      path_.push_back(idx_);
+    }
+    idx_ = tree_->outcome_children_
+               [tree_->first_outcome_[tree_->first_action_[idx_] + action] +
+                outcome];
+    PrefetchFirstChild();
+  }
+
+  size_t NumHistories() const { return tree_->parent_.size(); }
+  // The index of the current history in the tree, in [0, `NumHistories()`).
+  // Equivalent histories share an index in a merged tree.
+  size_t HistoryIndex() const { return idx_; }
+  // Whether this is a cursor into a tree returned by `Merged` in which some
+  // history has more than one parent.
+  bool IsMerged() const { return tree_->merged_; }
+  // Whether `other` is a cursor into the same tree.
+  bool SharesTree(const CompiledDecisionPoint& other) const {
+    return tree_ == other.tree_;
+  }
+
+  // Writes this tree to `file_name` in a native-endian binary format, tagged
+  // with `key`. OpenSpiel states are never written. Returns false if the file
+  // could not be written.
+  bool Write(const std::string& file_name, const std::string& key) const {
+    return tree_->Write(file_name, key);
+  }
+  // Memory-maps a file produced by `Write` and returns the state-free tree
+  // that it contains. Returns null if the file does not exist, is malformed,
+  // or was written with a different key.
+  static std::unique_ptr<CompiledDecisionPoint> Read(
+      const std::string& file_name, const std::string& key);
+
+  // A root cursor into a copy of this tree that is stored in `layout` order.
+  // Information set IDs are unchanged.
+  CompiledDecisionPoint Relaid(TreeLayout layout) const {
+    return CompiledDecisionPoint(tree_->Relaid(layout));
+  }
+  // A root cursor into a copy of this tree in which equivalent subtrees,
+  // e.g., transpositions, are stored once. Subtrees are equivalent when
+  // all of their histories have the same players, information sets, outcome
+  // probabilities, and returns, so traversals of the merged tree are
+  // indistinguishable from traversals of the original. Requires a tree that
+  // does not save OpenSpiel states. A merged tree cannot be relaid.
+  CompiledDecisionPoint Merged() const {
+    return CompiledDecisionPoint(tree_->Merged());
+  }
+  // A root cursor into this tree that undoes moves with a stack, as cursors
+  // into merged trees must, even if the tree is not merged. Only useful to
+  // measure what the stack costs.
+  CompiledDecisionPoint WithUndoStack() const {
+    CompiledDecisionPoint root(*this);
+    root.UndoAll();
+    root.use_path_ = true;
+    return root;
+  }
+
+ private:
+  CompiledDecisionPoint(
+      std::shared_ptr<const _decision_point::CompiledTree>&& tree);
+
+  // Starts loading the history that a depth-first traversal visits next
+  // so that it is more likely to be in cache by the time it is applied.
+  void PrefetchFirstChild() const {
+    if (IsTerminal()) {
+      return;
+    }
+    const size_t child = tree_->outcome_children_
+                             [tree_->first_outcome_[tree_->first_action_[idx_]]];
+    __builtin_prefetch(&tree_->first_action_[child]);
+    __builtin_prefetch(&tree_->num_actions_[child]);
+    __builtin_prefetch(&tree_->player_to_act_[child]);
+  }
+
+ private:
+  std::shared_ptr<const _decision_point::CompiledTree> tree_;
+  size_t idx_;
+  // Whether `Undo` pops `path_` rather than reading `parent_`, which is only
+  // needed in merged trees, where a history can have several parents.
+  bool use_path_;
+  // The histories above `idx_` if `use_path_`.
+  std::vector<size_t> path_;
 };
 
-void _ForEachState(std::unordered_set<std::string>& already_observed,
-                   DecisionPoint& decision_point,
-                   const std::function<void(const DecisionPoint&)>& f,
-                   int player);
+// Calls `f` with `decision_point` as its concrete type if it is one of the
+// decision points above, so that `f` can be instantiated on that type and
+// inline its calls, and with `decision_point` itself otherwise.
+template <class F>
+decltype(auto) WithConcreteDecisionPoint(DecisionPoint& decision_point,
+                                         F&& f) {
+  if (auto* compiled = dynamic_cast<CompiledDecisionPoint*>(&decision_point)) {
+    return f(*compiled);
+  } else if (auto* cached =
+                 dynamic_cast<CachedDecisionPoint*>(&decision_point)) {
+    return f(*cached);
+  }
+  return f(decision_point);
+}
+
 void ForEachState(DecisionPoint& root,
                   const std::function<void(const DecisionPoint&)>& f,
                   int player);
 int NumStates(DecisionPoint& root, int player = ALL_PLAYERS);
+
+// Identifies `game` and the OpenSpiel version that its trees were compiled
+// with.
+std::string TreeCacheKey(const open_spiel::Game& game);
+// The file in `cache_dir` that holds `game`'s tree.
+std::string TreeCacheFileName(const open_spiel::Game& game,
+                              const std::string& cache_dir);
+// Returns the state-free tree of `game`, reading it from `cache_dir` if an
+// up-to-date tree file exists there and otherwise compiling it and writing
+// it to `cache_dir`, which is created if necessary. Warns on stderr when the
+// tree cannot be written. An empty `cache_dir` disables the cache.
+std::unique_ptr<CompiledDecisionPoint> LoadOrCompileTree(
+    const open_spiel::Game& game, const std::string& cache_dir,
+    size_t num_threads = 1);
 ActionMap<int> NumStatesWithAction(DecisionPoint& root, int player);
 
 }  // namespace hr_edl
@@ -1,5 +1,16 @@
 #include "hr_edl/decision_point.h"
 
+#include <stdlib.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <type_traits>
+
+#include "hr_edl/samplers.h"
 #include "hr_edl/test_extra.h"
 #include "open_spiel/spiel.h"
 #include "open_spiel/spiel_utils.h"
@@ -107,6 +118,441 @@ void CachedDecisionPointWithTerminals() {
                  std::string("0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12"));
 }
 
+void CheckSameTree(DecisionPoint& expected, DecisionPoint& actual) {
+  SPIEL_CHECK_EQ(actual.IsTerminal(), expected.IsTerminal());
+  SPIEL_CHECK_EQ(actual.PlayerToAct(), expected.PlayerToAct());
+  SPIEL_CHECK_EQ(actual.InformationStateStringRef(),
+                 expected.InformationStateStringRef());
+  SPIEL_CHECK_EQ(actual.ReturnsRef().size(), expected.ReturnsRef().size());
+  for (size_t i = 0; i < actual.ReturnsRef().size(); ++i) {
+    SPIEL_CHECK_FLOAT_EQ(actual.ReturnsRef()[i], expected.ReturnsRef()[i]);
+  }
+  SPIEL_CHECK_EQ(actual.NumActions(), expected.NumActions());
+  for (size_t a = 0; a < actual.NumActions(); ++a) {
+    SPIEL_CHECK_EQ(actual.NumOutcomes(a), expected.NumOutcomes(a));
+    for (size_t outcome = 0; outcome < actual.NumOutcomes(a); ++outcome) {
+      SPIEL_CHECK_FLOAT_EQ(actual.OutcomeProbabilitiesRef(a)[outcome],
+                           expected.OutcomeProbabilitiesRef(a)[outcome]);
+      expected.Apply(a, outcome);
+      actual.Apply(a, outcome);
+      CheckSameTree(expected, actual);
+      expected.Undo();
+      actual.Undo();
+    }
+  }
+}
+
+void CompiledDecisionPointMatchesCached(const std::string& game_name,
+                                        bool save_terminals) {
+  const auto game = open_spiel::LoadGame(game_name);
+  CachedDecisionPoint cached(game->NewInitialState(), false, save_terminals);
+  CompiledDecisionPoint compiled(game->NewInitialState(), false,
+                                 save_terminals);
+  SPIEL_CHECK_TRUE(compiled.IsRoot());
+  SPIEL_CHECK_EQ(compiled.TerminalsAreSaved(), save_terminals);
+  CheckSameTree(cached, compiled);
+  SPIEL_CHECK_TRUE(compiled.IsRoot());
+  SPIEL_CHECK_EQ(NumStates(compiled), NumStates(cached));
+}
+
+void CompiledDecisionPointWithTerminals() {
+  CompiledDecisionPoint decision_point(
+      open_spiel::LoadGame("liars_dice")->NewInitialState(), false, true);
+  while (!decision_point.IsTerminal()) {
+    decision_point.Apply(0, 0);
+  }
+  SPIEL_CHECK_TRUE(decision_point.OpenSpielStatePtr());
+  SPIEL_CHECK_EQ(decision_point.OpenSpielStatePtr()->HistoryString(),
+                 std::string("0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12"));
+  decision_point.UndoAll();
+  SPIEL_CHECK_TRUE(decision_point.IsRoot());
+}
+
+void CompiledDecisionPointCopiesShareTree() {
+  const auto game = open_spiel::LoadGame("liars_dice");
+  CompiledDecisionPoint root(game->NewInitialState());
+  const int num_states = NumStates(root);
+
+  CompiledDecisionPoint cursor(root);
+  SPIEL_CHECK_TRUE(cursor.SharesTree(root));
+  cursor.Apply(0, 0);
+  SPIEL_CHECK_FALSE(cursor.IsRoot());
+  SPIEL_CHECK_TRUE(root.IsRoot());
+
+  std::vector<int> counts(4, 0);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    threads.emplace_back([&root, &counts, i] {
+      CompiledDecisionPoint cursor(root);
+      counts[i] = NumStates(cursor);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const int count : counts) {
+    SPIEL_CHECK_EQ(count, num_states);
+  }
+}
+
+void CheckDenseInfoSetIds(DecisionPoint& root) {
+  for (int player = 0; player < root.NumPlayers(); ++player) {
+    std::vector<bool> observed;
+    ForEachState(
+        root,
+        [&observed](const DecisionPoint& dp) {
+          const size_t id = dp.InfoSetId();
+          if (observed.size() <= id) {
+            observed.resize(id + 1, false);
+          }
+          SPIEL_CHECK_FALSE(observed[id]);
+          observed[id] = true;
+        },
+        player);
+    SPIEL_CHECK_EQ(observed.size(), NumStates(root, player));
+    SPIEL_CHECK_EQ(root.NumInfoSets(player), observed.size());
+  }
+}
+
+void InfoSetIdsAreDense(const std::string& game_name) {
+  const auto game = open_spiel::LoadGame(game_name);
+  CachedDecisionPoint cached(game->NewInitialState());
+  CheckDenseInfoSetIds(cached);
+  CompiledDecisionPoint compiled(game->NewInitialState());
+  CheckDenseInfoSetIds(compiled);
+}
+
+// A new directory that no other test uses, even in another process.
+std::string TempDir() {
+  char dir[] = "/tmp/hr_edl_decision_point_test.XXXXXX";
+  SPIEL_CHECK_TRUE(mkdtemp(dir) != nullptr);
+  return dir;
+}
+
+std::string ReadFile(const std::string& file_name) {
+  std::ifstream in(file_name, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in),
+                     std::istreambuf_iterator<char>());
+}
+
+void WriteFile(const std::string& file_name, const std::string& contents) {
+  std::ofstream out(file_name, std::ios::binary | std::ios::trunc);
+  out << contents;
+  SPIEL_CHECK_TRUE(out.good());
+}
+
+// The arrays of a tree file, in the order that `CompiledTree::Write` writes
+// them, up to the last one that the tests corrupt.
+enum TreeFileArray {
+  kMagic,
+  kKey,
+  kSizes,
+  kParent,
+  kPlayerToAct,
+  kInfoSetId,
+  kFirstAction,
+  kNumActions,
+  kFirstOutcome,
+  kOutcomeChildren
+};
+
+// The offset of `array`'s size in a tree file's contents.
+size_t TreeFileOffset(const std::string& contents, TreeFileArray array) {
+  const size_t value_sizes[] = {
+      1, 1, sizeof(uint64_t), sizeof(size_t), sizeof(open_spiel::Player),
+      sizeof(size_t), sizeof(size_t), sizeof(size_t), sizeof(size_t)};
+  size_t offset = 0;
+  for (int skipped = kMagic; skipped < array; ++skipped) {
+    uint64_t size;
+    std::memcpy(&size, contents.data() + offset, sizeof(size));
+    offset += sizeof(size) + size * value_sizes[skipped];
+  }
+  return offset;
+}
+
+size_t TreeFileArraySize(const std::string& contents, TreeFileArray array) {
+  uint64_t size;
+  std::memcpy(&size, contents.data() + TreeFileOffset(contents, array),
+              sizeof(size));
+  return size;
+}
+
+// Returns a tree file's contents with the `i`th value of `array`, which must
+// hold `size_t` values, replaced by `value`.
+std::string WithTreeFileValue(std::string contents, TreeFileArray array,
+                              size_t i, size_t value) {
+  SPIEL_CHECK_LT(i, TreeFileArraySize(contents, array));
+  const size_t offset =
+      TreeFileOffset(contents, array) + sizeof(uint64_t) + i * sizeof(value);
+  std::memcpy(contents.data() + offset, &value, sizeof(value));
+  return contents;
+}
+
+void CompiledDecisionPointFileRoundTrip(const std::string& game_name) {
+  const auto game = open_spiel::LoadGame(game_name);
+  const std::string dir = TempDir();
+  const std::string file_name = dir + "/game.tree";
+  const std::string key = TreeCacheKey(*game);
+  CompiledDecisionPoint compiled(game->NewInitialState(), false, true);
+  SPIEL_CHECK_TRUE(compiled.Write(file_name, key));
+
+  SPIEL_CHECK_FALSE(CompiledDecisionPoint::Read(file_name, key + "x"));
+  SPIEL_CHECK_FALSE(CompiledDecisionPoint::Read(file_name + "x", key));
+  const auto loaded = CompiledDecisionPoint::Read(file_name, key);
+  std::filesystem::remove_all(dir);
+  SPIEL_CHECK_TRUE(loaded);
+  SPIEL_CHECK_FALSE(loaded->StatesAreSaved());
+  SPIEL_CHECK_TRUE(loaded->OpenSpielStatePtr() == nullptr);
+  SPIEL_CHECK_EQ(loaded->NumHistories(), compiled.NumHistories());
+  CheckSameTree(compiled, *loaded);
+  for (int player = 0; player < compiled.NumPlayers(); ++player) {
+    SPIEL_CHECK_EQ(loaded->NumInfoSets(player), compiled.NumInfoSets(player));
+  }
+  CheckDenseInfoSetIds(*loaded);
+}
+
+void CorruptTreeFilesAreRejected(const std::string& game_name) {
+  const auto game = open_spiel::LoadGame(game_name);
+  const std::string dir = TempDir();
+  const std::string file_name = dir + "/game.tree";
+  const std::string key = TreeCacheKey(*game);
+  CompiledDecisionPoint compiled(game->NewInitialState(), false, false,
+                                 false);
+  SPIEL_CHECK_TRUE(compiled.Write(file_name, key));
+  const std::string contents = ReadFile(file_name);
+  const size_t num_histories = compiled.NumHistories();
+  const size_t num_outcomes = TreeFileArraySize(contents, kOutcomeChildren);
+  SPIEL_CHECK_TRUE(CompiledDecisionPoint::Read(file_name, key));
+
+  const std::vector<std::string> corrupt_contents = {
+      contents.substr(0, contents.size() - 1),
+      contents.substr(0, contents.size() / 2),
+      WithTreeFileValue(contents, kOutcomeChildren, 0, num_histories),
+      // The root's first child is the root itself.
+      WithTreeFileValue(contents, kOutcomeChildren, 0, 0),
+      // The last child is the root, which is an ancestor of every history.
+      WithTreeFileValue(contents, kOutcomeChildren, num_outcomes - 1, 0),
+      WithTreeFileValue(contents, kParent, num_histories - 1,
+                        num_histories - 1),
+      WithTreeFileValue(contents, kParent, 0, num_histories - 1)};
+  for (const std::string& corrupt : corrupt_contents) {
+    WriteFile(file_name, corrupt);
+    SPIEL_CHECK_FALSE(CompiledDecisionPoint::Read(file_name, key));
+  }
+  std::filesystem::remove_all(dir);
+}
+
+void LoadOrCompileTreeCachesTrees() {
+  const auto game = open_spiel::LoadGame("kuhn_poker");
+  const std::string dir = TempDir();
+  // Missing ancestors of the cache directory are created.
+  const std::string cache_dir = dir + "/a/b";
+  const std::string file_name = TreeCacheFileName(*game, cache_dir);
+  const std::string key = TreeCacheKey(*game);
+  CompiledDecisionPoint compiled(game->NewInitialState(), false, false,
+                                 false);
+
+  auto loaded = LoadOrCompileTree(*game, cache_dir);
+  SPIEL_CHECK_TRUE(loaded);
+  CheckSameTree(compiled, *loaded);
+  loaded = CompiledDecisionPoint::Read(file_name, key);
+  SPIEL_CHECK_TRUE(loaded);
+  CheckSameTree(compiled, *loaded);
+
+  // A cached tree with the wrong number of players is compiled again.
+  const auto three_player_game =
+      open_spiel::LoadGame("kuhn_poker(players=3)");
+  CompiledDecisionPoint three_player(three_player_game->NewInitialState(),
+                                     false, false, false);
+  SPIEL_CHECK_TRUE(three_player.Write(file_name, key));
+  loaded = LoadOrCompileTree(*game, cache_dir);
+  SPIEL_CHECK_EQ(loaded->NumPlayers(), game->NumPlayers());
+  CheckSameTree(compiled, *loaded);
+
+  // As is one with the wrong number of actions.
+  const auto leduc = open_spiel::LoadGame("leduc_poker");
+  CompiledDecisionPoint leduc_root(leduc->NewInitialState(), false, false,
+                                   false);
+  SPIEL_CHECK_NE(leduc->NumDistinctActions(), game->NumDistinctActions());
+  SPIEL_CHECK_TRUE(leduc_root.Write(file_name, key));
+  loaded = LoadOrCompileTree(*game, cache_dir);
+  SPIEL_CHECK_EQ(loaded->NumDistinctActions(), game->NumDistinctActions());
+  CheckSameTree(compiled, *loaded);
+
+  // Each of these rewrote the cache with the right tree.
+  loaded = CompiledDecisionPoint::Read(file_name, key);
+  SPIEL_CHECK_TRUE(loaded);
+  CheckSameTree(compiled, *loaded);
+  std::filesystem::remove_all(dir);
+}
+
+void CheckSameInfoSetIds(DecisionPoint& expected, DecisionPoint& actual) {
+  if (!actual.IsTerminal() && actual.PlayerToAct() >= 0) {
+    SPIEL_CHECK_EQ(actual.InfoSetId(), expected.InfoSetId());
+  }
+  for (size_t a = 0; a < actual.NumActions(); ++a) {
+    for (size_t outcome = 0; outcome < actual.NumOutcomes(a); ++outcome) {
+      expected.Apply(a, outcome);
+      actual.Apply(a, outcome);
+      CheckSameInfoSetIds(expected, actual);
+      expected.Undo();
+      actual.Undo();
+    }
+  }
+}
+
+void CompiledDecisionPointParallelMatchesSerial(const std::string& game_name,
+                                                bool save_states,
+                                                size_t num_threads) {
+  const auto game = open_spiel::LoadGame(game_name);
+  CompiledDecisionPoint serial(game->NewInitialState(), false, true,
+                               save_states);
+  CompiledDecisionPoint parallel(game->NewInitialState(), false, true,
+                                 save_states, num_threads);
+  SPIEL_CHECK_EQ(parallel.NumHistories(), serial.NumHistories());
+  CheckSameTree(serial, parallel);
+  CheckSameInfoSetIds(serial, parallel);
+  for (int player = 0; player < serial.NumPlayers(); ++player) {
+    SPIEL_CHECK_EQ(parallel.NumInfoSets(player), serial.NumInfoSets(player));
+  }
+}
+
+void BoundedCachedDecisionPointMatchesUnbounded() {
+  const auto game = open_spiel::LoadGame("liars_dice");
+  CompiledDecisionPoint compiled(game->NewInitialState());
+  CachedDecisionPoint unbounded(game->NewInitialState());
+  CheckSameTree(compiled, unbounded);
+  SPIEL_CHECK_EQ(unbounded.NumHistories(), compiled.NumHistories());
+  SPIEL_CHECK_EQ(unbounded.Stats().evictions, 0);
+
+  const size_t capacity = compiled.NumHistories() / 4;
+  CachedDecisionPoint bounded(game->NewInitialState(), false, false, capacity);
+  SPIEL_CHECK_EQ(bounded.Capacity(), capacity);
+  CheckSameTree(compiled, bounded);
+  SPIEL_CHECK_EQ(bounded.Stats().hits + bounded.Stats().misses,
+                 unbounded.Stats().hits + unbounded.Stats().misses);
+  SPIEL_CHECK_GT(bounded.Stats().evictions, 0);
+  SPIEL_CHECK_TRUE(bounded.IsRoot());
+  SPIEL_CHECK_LE(bounded.NumHistories(), capacity);
+  CheckSameInfoSetIds(compiled, bounded);
+
+  // Revisiting the tree re-expands discarded subtrees.
+  const size_t misses = bounded.Stats().misses;
+  CheckSameTree(compiled, bounded);
+  SPIEL_CHECK_GT(bounded.Stats().misses, misses);
+  SPIEL_CHECK_LE(bounded.NumHistories(), capacity);
+}
+
+void CheckSampleOutcome(DecisionPoint& decision_point) {
+  for (size_t a = 0; a < decision_point.NumActions(); ++a) {
+    const auto probs = decision_point.OutcomeProbabilities(a);
+    std::vector<double> random_numbers = {0.0, 0.999999};
+    double cumulative_prob = 0;
+    for (const double prob : probs) {
+      cumulative_prob += prob;
+      random_numbers.push_back(cumulative_prob);
+      random_numbers.push_back(cumulative_prob - prob / 2);
+    }
+    for (const double random_number : random_numbers) {
+      if (random_number < 1) {
+        SPIEL_CHECK_EQ(decision_point.SampleOutcome(a, random_number),
+                       SampleActionIndex(probs, random_number));
+      }
+    }
+    for (size_t outcome = 0; outcome < probs.size(); ++outcome) {
+      decision_point.Apply(a, outcome);
+      CheckSampleOutcome(decision_point);
+      decision_point.Undo();
+    }
+  }
+}
+
+void SampleOutcomeMatchesSampleActionIndex(const std::string& game_name) {
+  const auto game = open_spiel::LoadGame(game_name);
+  CachedDecisionPoint cached(game->NewInitialState());
+  CheckSampleOutcome(cached);
+  CompiledDecisionPoint compiled(game->NewInitialState());
+  CheckSampleOutcome(compiled);
+}
+
+void RelaidTreesMatchCompiled(const std::string& game_name) {
+  const auto game = open_spiel::LoadGame(game_name);
+  CompiledDecisionPoint compiled(game->NewInitialState(), false, true);
+  for (const TreeLayout layout :
+       {TreeLayout::kSiblingsFirst, TreeLayout::kPreOrder,
+        TreeLayout::kBlocked}) {
+    CompiledDecisionPoint relaid = compiled.Relaid(layout);
+    SPIEL_CHECK_FALSE(relaid.SharesTree(compiled));
+    SPIEL_CHECK_TRUE(relaid.IsRoot());
+    SPIEL_CHECK_EQ(relaid.NumHistories(), compiled.NumHistories());
+    CheckSameTree(compiled, relaid);
+    CheckSameInfoSetIds(compiled, relaid);
+    CheckSampleOutcome(relaid);
+  }
+}
+
+void MergedTreeMatchesCompiled(const std::string& game_name) {
+  const auto game = open_spiel::LoadGame(game_name);
+  CompiledDecisionPoint compiled(game->NewInitialState(), false, false,
+                                 false);
+  CompiledDecisionPoint merged = compiled.Merged();
+  SPIEL_CHECK_LT(merged.NumHistories(), compiled.NumHistories());
+  CheckSameTree(compiled, merged);
+  CheckSameInfoSetIds(compiled, merged);
+  CheckSampleOutcome(merged);
+  for (int player = 0; player < compiled.NumPlayers(); ++player) {
+    SPIEL_CHECK_EQ(merged.NumInfoSets(player), compiled.NumInfoSets(player));
+    SPIEL_CHECK_EQ(NumStates(merged, player), NumStates(compiled, player));
+  }
+
+  // Undo returns along the path that was applied, whichever parent it took.
+  while (!merged.IsTerminal()) {
+    const size_t a = merged.NumActions() - 1;
+    merged.Apply(a, merged.NumOutcomes(a) - 1);
+    compiled.Apply(a, compiled.NumOutcomes(a) - 1);
+  }
+  CompiledDecisionPoint cursor(merged);
+  while (!merged.IsRoot()) {
+    merged.Undo();
+    compiled.Undo();
+    CheckSameTree(compiled, merged);
+  }
+  cursor.UndoAll();
+  SPIEL_CHECK_TRUE(cursor.IsRoot());
+
+  // Merged trees read from a file still undo along the applied path.
+  const std::string dir = TempDir();
+  const std::string file_name = dir + "/merged.tree";
+  SPIEL_CHECK_TRUE(merged.Write(file_name, game_name));
+  const auto loaded = CompiledDecisionPoint::Read(file_name, game_name);
+  std::filesystem::remove_all(dir);
+  SPIEL_CHECK_TRUE(loaded);
+  CheckSameTree(compiled, *loaded);
+
+  CompiledDecisionPoint with_undo_stack = compiled.WithUndoStack();
+  CheckSameTree(compiled, with_undo_stack);
+}
+
+void WithConcreteDecisionPointUsesConcreteType() {
+  const auto game = open_spiel::LoadGame("kuhn_poker");
+  CachedDecisionPoint cached(game->NewInitialState());
+  CompiledDecisionPoint compiled(game->NewInitialState());
+  const auto type_of = [](DecisionPoint& decision_point) {
+    return WithConcreteDecisionPoint(
+        decision_point, [](auto& concrete_decision_point) -> std::string {
+          using DP = std::decay_t<decltype(concrete_decision_point)>;
+          if (std::is_same_v<DP, CachedDecisionPoint>) {
+            return "cached";
+          } else if (std::is_same_v<DP, CompiledDecisionPoint>) {
+            return "compiled";
+          }
+          return "virtual";
+        });
+  };
+  SPIEL_CHECK_EQ(type_of(cached), "cached");
+  SPIEL_CHECK_EQ(type_of(compiled), "compiled");
+  SPIEL_CHECK_EQ(NumStates(cached), NumStates(compiled));
+}
 }  // namespace
 }  // namespace hr_edl
 
@@ -117,4 +563,32 @@ int main(int argc, char** argv) {
   RUN_TEST(CachedDecisionPointApplyAndUndo);
   RUN_TEST(CachedDecisionPointLiarsDiceTraversal);
   RUN_TEST(CachedDecisionPointWithTerminals);
+  RUN_TEST(CompiledDecisionPointMatchesCached, "kuhn_poker", false);
+  RUN_TEST(CompiledDecisionPointMatchesCached, "liars_dice", true);
+  RUN_TEST(CompiledDecisionPointWithTerminals);
+  RUN_TEST(CompiledDecisionPointCopiesShareTree);
+  RUN_TEST(InfoSetIdsAreDense, "kuhn_poker");
+  RUN_TEST(InfoSetIdsAreDense, "liars_dice");
+  RUN_TEST(CompiledDecisionPointFileRoundTrip, "kuhn_poker");
+  RUN_TEST(CompiledDecisionPointFileRoundTrip, "liars_dice");
+  RUN_TEST(CorruptTreeFilesAreRejected, "kuhn_poker");
+  RUN_TEST(CorruptTreeFilesAreRejected, "liars_dice");
+  RUN_TEST(LoadOrCompileTreeCachesTrees);
+  RUN_TEST(CompiledDecisionPointParallelMatchesSerial, "kuhn_poker", true, 3);
+  RUN_TEST(CompiledDecisionPointParallelMatchesSerial, "liars_dice", false, 3);
+  // More threads than deals, so the subtrees below the first actions are
+  // split off as well.
+  RUN_TEST(CompiledDecisionPointParallelMatchesSerial, "kuhn_poker", true, 8);
+  // Starts at a decision point rather than a deal.
+  RUN_TEST(CompiledDecisionPointParallelMatchesSerial,
+           "goofspiel(imp_info=True,num_cards=3,points_order=descending)",
+           false, 4);
+  RUN_TEST(BoundedCachedDecisionPointMatchesUnbounded);
+  RUN_TEST(SampleOutcomeMatchesSampleActionIndex, "kuhn_poker");
+  RUN_TEST(SampleOutcomeMatchesSampleActionIndex, "liars_dice");
+  RUN_TEST(RelaidTreesMatchCompiled, "kuhn_poker");
+  RUN_TEST(RelaidTreesMatchCompiled, "liars_dice");
+  RUN_TEST(MergedTreeMatchesCompiled, "kuhn_poker");
+  RUN_TEST(MergedTreeMatchesCompiled, "liars_dice");
+  RUN_TEST(WithConcreteDecisionPointUsesConcreteType);
 }
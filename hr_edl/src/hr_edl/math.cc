@@ -102,13 +102,17 @@ void Add(std::vector<double>& sum, const std::vector<double>& v) {
 }
 
 void SafeDivide(std::vector<double>& v, double s, bool set_uniform) {
+  SafeDivide(v.data(), v.size(), s, set_uniform);
+}
+
+void SafeDivide(double* v, size_t n, double s, bool set_uniform) {
   if (s > 0) {
-    for (double& v_i : v) {
-      v_i = v_i / s;
+    for (size_t i = 0; i < n; ++i) {
+      v[i] = v[i] / s;
     }
   } else if (set_uniform) {
-    for (double& v_i : v) {
-      v_i = 1.0 / v.size();
+    for (size_t i = 0; i < n; ++i) {
+      v[i] = 1.0 / n;
     }
   }
 }
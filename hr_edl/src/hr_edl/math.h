@@ -6,6 +6,7 @@
 namespace hr_edl {
 
 void SafeDivide(std::vector<double>& v, double s, bool set_uniform = false);
+void SafeDivide(double* v, size_t n, double s, bool set_uniform = false);
 double CounterfactualReachProb(const std::vector<double>& reach_probabilities,
                                int player);
 std::vector<double> CounterfactualReturns(
@@ -1,6 +1,9 @@
 #ifndef HR_EDL_POLICY_H_
 #define HR_EDL_POLICY_H_
 
+#include <algorithm>
+
+#include "absl/types/span.h"
 #include "open_spiel/policy.h"
 #include "open_spiel/spiel.h"
 #include "hr_edl/containers.h"
@@ -16,6 +19,21 @@ class Policy : public open_spiel::Policy {
   virtual ~Policy() = default;
   virtual std::vector<double> Response(
       const open_spiel::State& state) const = 0;
+  // Policies that only depend on the information state should override this
+  // so that they can be evaluated on trees that do not save OpenSpiel states.
+  virtual std::vector<double> Response(
+      const DecisionPoint& decision_point) const {
+    SPIEL_CHECK_TRUE(decision_point.OpenSpielStatePtr() != nullptr);
+    return Response(*decision_point.OpenSpielStatePtr());
+  }
+  // Writes the response at `decision_point` to `out`, which must hold
+  // `decision_point.NumActions()` values. Policies that can respond without
+  // allocating should override this.
+  virtual void ResponseInto(const DecisionPoint& decision_point,
+                            double* out) const {
+    const auto response = Response(decision_point);
+    std::copy(response.begin(), response.end(), out);
+  }
   open_spiel::ActionsAndProbs GetStatePolicy(
       const open_spiel::State& state) const override final {
     const auto legal_actions = state.LegalActions();
@@ -31,6 +49,123 @@ class Policy : public open_spiel::Policy {
 };
 using PolicyPtr = std::unique_ptr<Policy>;
 
+// Counters for the responses looked up through a `ResponseCache`.
+struct ResponseCacheStats {
+  // Responses to information sets that were already computed.
+  size_t hits = 0;
+  // Responses that had to be computed by the policy.
+  size_t misses = 0;
+
+  double HitRate() const {
+    const size_t lookups = hits + misses;
+    return lookups > 0 ? static_cast<double>(hits) / lookups : 0.0;
+  }
+  ResponseCacheStats& operator+=(const ResponseCacheStats& other) {
+    hits += other.hits;
+    misses += other.misses;
+    return *this;
+  }
+};
+
+// Memoises a policy's responses by information set ID so that, within a
+// traversal, the policy responds once per information set rather than once
+// per history. Every decision point passed to `Response` between calls to
+// `Reset` must belong to the same tree. Returned spans stay valid until the
+// next call to `Reset`. Statistics accumulate across traversals.
+//
+// Responses are written into blocks that are reused by later traversals, so
+// once a traversal has been seen, repeating it allocates nothing.
+class ResponseCache {
+ public:
+  ResponseCache()
+      : policy_(nullptr),
+        traversal_(0),
+        entries_(),
+        blocks_(),
+        block_(0),
+        block_size_(0),
+        stats_() {}
+  explicit ResponseCache(const Policy& policy) : ResponseCache() {
+    Reset(policy);
+  }
+
+  // Starts a new traversal, which forgets every cached response without
+  // releasing its storage.
+  void Reset(const Policy& policy) {
+    policy_ = &policy;
+    ++traversal_;
+    block_ = 0;
+    block_size_ = 0;
+  }
+  // Requires a policy from the constructor or an earlier `Reset`.
+  void Reset() {
+    SPIEL_CHECK_TRUE(policy_ != nullptr);
+    Reset(*policy_);
+  }
+
+  template <class DP>
+  absl::Span<const double> Response(const DP& decision_point) {
+    if (entries_.empty()) {
+      entries_.resize(decision_point.NumPlayers());
+    }
+    const open_spiel::Player player = decision_point.PlayerToAct();
+    auto& entries = entries_[player];
+    const size_t id = decision_point.InfoSetId();
+    if (entries.size() <= id) {
+      entries.resize(std::max(id + 1, decision_point.NumInfoSets(player)));
+    }
+    auto& [traversal, response] = entries[id];
+    const size_t num_actions = decision_point.NumActions();
+    if (traversal == traversal_) {
+      ++stats_.hits;
+    } else {
+      ++stats_.misses;
+      traversal = traversal_;
+      response = Allocate(num_actions);
+      policy_->ResponseInto(decision_point, response);
+    }
+    return absl::MakeConstSpan(response, num_actions);
+  }
+
+  const ResponseCacheStats& Stats() const { return stats_; }
+  const Policy& CachedPolicy() const {
+    SPIEL_CHECK_TRUE(policy_ != nullptr);
+    return *policy_;
+  }
+
+ private:
+  static constexpr size_t kMinBlockSize = 4096;
+
+  double* Allocate(size_t n) {
+    while (block_ < blocks_.size() &&
+           block_size_ + n > blocks_[block_].size()) {
+      ++block_;
+      block_size_ = 0;
+    }
+    if (block_ == blocks_.size()) {
+      blocks_.emplace_back(std::max(n, kMinBlockSize));
+    }
+    double* out = blocks_[block_].data() + block_size_;
+    block_size_ += n;
+    return out;
+  }
+
+ private:
+  // The traversal that computed each response and where it was written, by
+  // player and info set ID.
+  using Entry = std::pair<size_t, double*>;
+
+  const Policy* policy_;
+  size_t traversal_;
+  PlayerMap<std::vector<Entry>> entries_;
+  // Growing `blocks_` moves the blocks but not their contents, so written
+  // responses stay in place.
+  std::vector<std::vector<double>> blocks_;
+  size_t block_;
+  size_t block_size_;
+  ResponseCacheStats stats_;
+};
+
 inline std::unordered_map<std::string, open_spiel::ActionsAndProbs>
 ActionsAndProbsTable(const open_spiel::Game& game, const Policy& policy) {
   std::unordered_map<std::string, open_spiel::ActionsAndProbs> map;
@@ -71,6 +206,27 @@ class ResponsePolicyAdapter : public Policy {
     }
     return response;
   }
+  std::vector<double> Response(
+      const DecisionPoint& decision_point) const override final {
+    std::vector<double> response(decision_point.NumActions());
+    ResponseInto(decision_point, response.data());
+    return response;
+  }
+  void ResponseInto(const DecisionPoint& decision_point,
+                    double* out) const override final {
+    // Many OpenSpiel policies only respond to states, so the info state is
+    // only used on trees that do not save them.
+    const open_spiel::State* state = decision_point.OpenSpielStatePtr();
+    const auto action_prob_pairs =
+        state != nullptr
+            ? policy_->GetStatePolicy(*state)
+            : policy_->GetStatePolicy(
+                  decision_point.InformationStateStringRef());
+    SPIEL_CHECK_EQ(action_prob_pairs.size(), decision_point.NumActions());
+    for (int i = 0; i < action_prob_pairs.size(); ++i) {
+      out[i] = action_prob_pairs[i].second;
+    }
+  }
 
   open_spiel::ActionsAndProbs GetStatePolicy(
       const std::string& info_state) const override final {
@@ -101,22 +257,35 @@ class MapPolicy : public Policy {
 
   std::vector<double> Response(
       const open_spiel::State& state) const override final {
-    const std::string iss = state.InformationStateString();
-    if (map_.contains(iss)) {
-      auto policy = map_.at(iss);
-      double z = 0;
-      for (const auto prob : policy) {
-        z += prob;
-      }
-      if (z > 1.0 || z < 1.0) {
-        SafeDivide(policy, z, true);
-      }
-      return policy;
+    const auto iter = map_.find(state.InformationStateString());
+    if (iter != map_.end()) {
+      return Normalized(iter->second);
     } else {
       const size_t num_actions = state.LegalActions().size();
       return std::vector<double>(num_actions, 1.0 / num_actions);
     }
   }
+  std::vector<double> Response(
+      const DecisionPoint& decision_point) const override final {
+    const auto iter = map_.find(decision_point.InformationStateStringRef());
+    if (iter != map_.end()) {
+      return Normalized(iter->second);
+    } else {
+      const size_t num_actions = decision_point.NumActions();
+      return std::vector<double>(num_actions, 1.0 / num_actions);
+    }
+  }
+  void ResponseInto(const DecisionPoint& decision_point,
+                    double* out) const override final {
+    const size_t num_actions = decision_point.NumActions();
+    const auto iter = map_.find(decision_point.InformationStateStringRef());
+    if (iter != map_.end()) {
+      std::copy(iter->second.begin(), iter->second.end(), out);
+      Normalize(out, num_actions);
+    } else {
+      std::fill_n(out, num_actions, 1.0 / num_actions);
+    }
+  }
 
   MapPolicyPtr Clone() const { return std::make_unique<MapPolicy>(map_); }
 
@@ -125,15 +294,45 @@ class MapPolicy : public Policy {
     // Compute their sequence weights and add them to the current sequence
     // weights in map_
     std::vector<double> their_reach_probs(root.NumPlayers(), 1.0);
-    InfoStateUvm<std::vector<double>> their_seq_probs;
-    for (size_t outcome_idx = 0; outcome_idx < root.NumOutcomes(0);
-         ++outcome_idx) {
-      root.Apply(0, outcome_idx);
-      Avg_r(their_seq_probs, their_reach_probs, other, root, player);
-      root.Undo();
+    PlayerMap<std::vector<SeqProbs>> their_seq_probs(root.NumPlayers());
+    WithConcreteDecisionPoint(root, [&](auto& concrete_root) {
+      for (size_t outcome_idx = 0; outcome_idx < concrete_root.NumOutcomes(0);
+           ++outcome_idx) {
+        concrete_root.Apply(0, outcome_idx);
+        Avg_r(their_seq_probs, their_reach_probs, other, concrete_root,
+              player);
+        concrete_root.Undo();
+      }
+    });
+    for (const auto& seq_probs_by_id : their_seq_probs) {
+      for (const auto& [iss, seq_probs] : seq_probs_by_id) {
+        AddSeqProbs(iss, seq_probs, weight);
+      }
+    }
+  }
+
+ private:
+  // An info state string and sequence weights, indexed by info set ID.
+  using SeqProbs = std::pair<std::string, std::vector<double>>;
+
+  static std::vector<double> Normalized(std::vector<double> policy) {
+    Normalize(policy.data(), policy.size());
+    return policy;
+  }
+  static void Normalize(double* policy, size_t num_actions) {
+    double z = 0;
+    for (size_t a = 0; a < num_actions; ++a) {
+      z += policy[a];
     }
-    for (const auto& [iss, seq_probs] : their_seq_probs) {
-      const size_t num_actions = seq_probs.size();
+    if (z > 1.0 || z < 1.0) {
+      SafeDivide(policy, num_actions, z, true);
+    }
+  }
+
+  void AddSeqProbs(const std::string& iss, const std::vector<double>& seq_probs,
+                   double weight) {
+    const size_t num_actions = seq_probs.size();
+    if (num_actions > 0) {
       auto& policy_ref = GetOrCreate<std::string, std::vector<double>>(
           map_, iss,
           [num_actions]() { return std::vector<double>(num_actions, 0); });
@@ -143,27 +342,32 @@ class MapPolicy : public Policy {
     }
   }
 
- private:
-  void Avg_r(InfoStateUvm<std::vector<double>>& their_seq_probs,
+  template <class DP>
+  void Avg_r(PlayerMap<std::vector<SeqProbs>>& their_seq_probs,
              std::vector<double>& their_reach_probs, const Policy& other,
-             DecisionPoint& decision_point, int player) const {
+             DP& decision_point, int player) const {
     if (decision_point.IsTerminal()) {
       return;
     }
     const auto player_to_act = decision_point.PlayerToAct();
     const double their_reach_prob = their_reach_probs[player_to_act];
-    const auto their_policy =
-        other.Response(*decision_point.OpenSpielStatePtr());
-
-    std::string iss = decision_point.InformationStateString();
-    if (PlayerInSet(player_to_act, player) && !their_seq_probs.contains(iss)) {
-      std::vector<double> seq_probs;
-      seq_probs.reserve(their_policy.size());
-      for (size_t action_idx = 0; action_idx < their_policy.size();
-           ++action_idx) {
-        seq_probs.push_back(their_reach_prob * their_policy[action_idx]);
+    const auto their_policy = other.Response(decision_point);
+
+    if (PlayerInSet(player_to_act, player)) {
+      auto& seq_probs_by_id = their_seq_probs[player_to_act];
+      const size_t id = decision_point.InfoSetId();
+      if (seq_probs_by_id.size() <= id) {
+        seq_probs_by_id.resize(decision_point.NumInfoSets(player_to_act));
+      }
+      auto& [iss, seq_probs] = seq_probs_by_id[id];
+      if (seq_probs.empty()) {
+        iss = decision_point.InformationStateStringRef();
+        seq_probs.reserve(their_policy.size());
+        for (size_t action_idx = 0; action_idx < their_policy.size();
+             ++action_idx) {
+          seq_probs.push_back(their_reach_prob * their_policy[action_idx]);
+        }
       }
-      their_seq_probs.emplace(std::move(iss), std::move(seq_probs));
     }
     for (size_t action_idx = 0; action_idx < their_policy.size();
          ++action_idx) {
@@ -187,6 +391,27 @@ class MapPolicy : public Policy {
 
 inline MapPolicy UniformRandomPolicy() { return MapPolicy(); }
 
+// Plays uniformly at random without looking up its information set, so that
+// it adds as little as possible to the cost of a traversal.
+class UniformPolicy : public Policy {
+ public:
+  std::vector<double> Response(
+      const open_spiel::State& state) const override final {
+    const size_t num_actions = state.LegalActions().size();
+    return std::vector<double>(num_actions, 1.0 / num_actions);
+  }
+  std::vector<double> Response(
+      const DecisionPoint& decision_point) const override final {
+    const size_t num_actions = decision_point.NumActions();
+    return std::vector<double>(num_actions, 1.0 / num_actions);
+  }
+  void ResponseInto(const DecisionPoint& decision_point,
+                    double* out) const override final {
+    const size_t num_actions = decision_point.NumActions();
+    std::fill_n(out, num_actions, 1.0 / num_actions);
+  }
+};
+
 class PolicyRefProfile;
 
 class PlayerMapProfile : public Policy {
@@ -201,6 +426,14 @@ class PlayerMapProfile : public Policy {
       const open_spiel::State& state) const override final {
     return (*this)[state.CurrentPlayer()]->Response(state);
   }
+  std::vector<double> Response(
+      const DecisionPoint& decision_point) const override final {
+    return (*this)[decision_point.PlayerToAct()]->Response(decision_point);
+  }
+  void ResponseInto(const DecisionPoint& decision_point,
+                    double* out) const override final {
+    (*this)[decision_point.PlayerToAct()]->ResponseInto(decision_point, out);
+  }
   virtual const Policy* operator[](size_t player) const = 0;
 
  protected:
@@ -1,12 +1,45 @@
 #include "hr_edl/policy_evaluation.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <thread>
+#include <type_traits>
+
+#include "hr_edl/spiel_extra.h"
 
 using namespace open_spiel;
 
 namespace hr_edl {
+namespace {
+// Stands in for the responses of players whose traversals are inactive.
+constexpr absl::Span<const double> kNoResponse;
+
+// Calls `run(i)` for each task `i` in `[0, num_tasks)` on up to
+// `num_threads` threads, each of which takes the next task when it finishes
+// one.
+template <class F>
+void RunTasks(size_t num_tasks, size_t num_threads, const F& run) {
+  std::atomic<size_t> next_task(0);
+  const auto run_tasks = [&run, &next_task, num_tasks] {
+    for (size_t i = next_task++; i < num_tasks; i = next_task++) {
+      run(i);
+    }
+  };
+  if (num_threads < 2 || num_tasks < 2) {
+    run_tasks();
+    return;
+  }
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < std::min(num_threads, num_tasks); ++i) {
+    threads.emplace_back(run_tasks);
+  }
+  Wait(threads);
+}
+}  // namespace
 
-Cfv PolicyRegretAndReachProbEvaluator::operator()(
+template <class Sampler>
+Cfv PolicyRegretAndReachProbEvaluator<Sampler>::operator()(
     const open_spiel::State& state, double chance_reach_iw,
     double player_sampling_prob) {
   if (state.IsTerminal()) {
@@ -54,7 +87,8 @@ Cfv PolicyRegretAndReachProbEvaluator::operator()(
   Cfv state_value = 0.0;
   if (SaveRegrets(current_player)) {
     double action_values[num_legal_actions];
-    sampler_.SampleTargetPlayerActions(
+    std::fill_n(action_values, num_legal_actions, 0.0);
+    sampler_.ForEachTargetPlayerAction(
         policy, [this, &action_values, &legal_actions, &state, chance_reach_iw,
                  player_sampling_prob, &state_value](
                     int action_idx, double action_prob, double sampling_prob) {
@@ -74,7 +108,7 @@ Cfv PolicyRegretAndReachProbEvaluator::operator()(
       regrets.v_[a] += action_values[a];
     }
   } else {
-    sampler_.SampleExternalPlayerActions(
+    sampler_.ForEachExternalPlayerAction(
         policy, [this, my_reach_prob, chance_reach_iw, player_sampling_prob,
                  &legal_actions, current_player, &state_value, &state](
                     int action_idx, double action_prob, double sampling_prob) {
@@ -94,45 +128,74 @@ Cfv PolicyRegretAndReachProbEvaluator::operator()(
   return state_value;
 }
 
-Cfv PolicyRegretAndReachProbEvaluator::CounterfactualValue(
+template <class Sampler>
+Cfv PolicyRegretAndReachProbEvaluator<Sampler>::CounterfactualValue(
     DecisionPoint& decision_point, double chance_reach_iw,
     double player_sampling_prob, int action_idx) {
+  return WithConcreteDecisionPoint(
+      decision_point, [this, chance_reach_iw, player_sampling_prob,
+                       action_idx](auto& concrete_decision_point) {
+        return ChanceOutcomesValue(concrete_decision_point, chance_reach_iw,
+                                   player_sampling_prob, action_idx);
+      });
+}
+
+template <class Sampler>
+Cfv PolicyRegretAndReachProbEvaluator<Sampler>::operator()(
+    DecisionPoint& decision_point, double chance_reach_iw,
+    double player_sampling_prob) {
+  return WithConcreteDecisionPoint(
+      decision_point, [this, chance_reach_iw,
+                       player_sampling_prob](auto& concrete_decision_point) {
+        return HistoryValue(concrete_decision_point, chance_reach_iw,
+                            player_sampling_prob);
+      });
+}
+
+template <class Sampler>
+template <class DP>
+Cfv PolicyRegretAndReachProbEvaluator<Sampler>::ChanceOutcomesValue(
+    DP& decision_point, double chance_reach_iw, double player_sampling_prob,
+    int action_idx) {
   Cfv v = 0;
-  sampler_.SampleChanceOutcomes(
-      decision_point.OutcomeProbabilities(action_idx),
+  sampler_.ForEachChanceOutcome(
+      decision_point, action_idx,
       [this, action_idx, &decision_point, chance_reach_iw, player_sampling_prob,
        &v](int outcome, double outcome_prob, double outcome_sampling_prob) {
         decision_point.Apply(action_idx, outcome);
-        v += (*this)(decision_point,
-                     chance_reach_iw * outcome_prob / outcome_sampling_prob,
-                     player_sampling_prob);
+        v += HistoryValue(decision_point,
+                          chance_reach_iw * outcome_prob / outcome_sampling_prob,
+                          player_sampling_prob);
         decision_point.Undo();
       });
   return v;
 }
 
-Cfv PolicyRegretAndReachProbEvaluator::CounterfactualValue(
-    DecisionPoint& decision_point, double chance_reach_iw,
-    double player_sampling_prob, int action_idx, double next_reach_prob) {
+template <class Sampler>
+template <class DP>
+Cfv PolicyRegretAndReachProbEvaluator<Sampler>::ChanceOutcomesValue(
+    DP& decision_point, double chance_reach_iw, double player_sampling_prob,
+    int action_idx, double next_reach_prob) {
   Cfv v = 0;
-  sampler_.SampleChanceOutcomes(
-      decision_point.OutcomeProbabilities(action_idx),
+  sampler_.ForEachChanceOutcome(
+      decision_point, action_idx,
       [this, action_idx, &decision_point, chance_reach_iw, player_sampling_prob,
        next_reach_prob,
        &v](int outcome, double outcome_prob, double outcome_sampling_prob) {
         reach_probabilities_[decision_point.PlayerToAct()] = next_reach_prob;
         decision_point.Apply(action_idx, outcome);
-        v += (*this)(decision_point,
-                     chance_reach_iw * outcome_prob / outcome_sampling_prob,
-                     player_sampling_prob);
+        v += HistoryValue(decision_point,
+                          chance_reach_iw * outcome_prob / outcome_sampling_prob,
+                          player_sampling_prob);
         decision_point.Undo();
       });
   return v;
 }
 
-Cfv PolicyRegretAndReachProbEvaluator::operator()(DecisionPoint& decision_point,
-                                                  double chance_reach_iw,
-                                                  double player_sampling_prob) {
+template <class Sampler>
+template <class DP>
+Cfv PolicyRegretAndReachProbEvaluator<Sampler>::HistoryValue(
+    DP& decision_point, double chance_reach_iw, double player_sampling_prob) {
   if (decision_point.IsTerminal()) {
     return Return(decision_point) * chance_reach_iw *
            CounterfactualReachProb() / player_sampling_prob;
@@ -140,10 +203,9 @@ Cfv PolicyRegretAndReachProbEvaluator::operator()(DecisionPoint& decision_point,
   ++num_decision_histories_;
 
   const int current_player = decision_point.PlayerToAct();
-  assert(decision_point.OpenSpielStatePtr());
-  const std::vector<double> policy =
-      profile_.Response(*decision_point.OpenSpielStatePtr());
-  const std::string info_state = decision_point.InformationStateString();
+  const absl::Span<const double> policy =
+      response_cache_.Response(decision_point);
+  const std::string info_state = decision_point.InformationStateStringRef();
   const int num_legal_actions = decision_point.NumActions();
   const double my_reach_prob = reach_probabilities_[current_player];
 
@@ -161,11 +223,12 @@ Cfv PolicyRegretAndReachProbEvaluator::operator()(DecisionPoint& decision_point,
   Cfv state_value = 0.0;
   if (SaveRegrets(current_player)) {
     double action_values[num_legal_actions];
-    sampler_.SampleTargetPlayerActions(
+    std::fill_n(action_values, num_legal_actions, 0.0);
+    sampler_.ForEachTargetPlayerAction(
         policy, [this, &decision_point, chance_reach_iw, player_sampling_prob,
                  &action_values, &state_value](
                     int action_idx, double action_prob, double sampling_prob) {
-          const Cfv cfv = this->CounterfactualValue(
+          const Cfv cfv = this->ChanceOutcomesValue(
               decision_point, chance_reach_iw,
               player_sampling_prob * sampling_prob, action_idx);
           action_values[action_idx] = cfv;
@@ -180,14 +243,14 @@ Cfv PolicyRegretAndReachProbEvaluator::operator()(DecisionPoint& decision_point,
       regrets.v_[a] += action_values[a];
     }
   } else {
-    sampler_.SampleExternalPlayerActions(
+    sampler_.ForEachExternalPlayerAction(
         policy, [this, my_reach_prob, chance_reach_iw, player_sampling_prob,
                  current_player, &state_value, &decision_point](
                     int action_idx, double action_prob, double sampling_prob) {
           const double next_reach_probability = my_reach_prob * action_prob;
           if (!SaveReachProbs(current_player) || next_reach_probability > 0) {
             state_value +=
-                CounterfactualValue(decision_point, chance_reach_iw,
+                ChanceOutcomesValue(decision_point, chance_reach_iw,
                                     player_sampling_prob * sampling_prob,
                                     action_idx, next_reach_probability);
           }
@@ -203,13 +266,18 @@ std::tuple<Cfv,
 PolicyRegretsAndReachProbs(const open_spiel::State& root, int regret_player,
                            const Policy& profile, MccfrSampler& sampler,
                            int reach_prob_player) {
-  PolicyRegretAndReachProbEvaluator evaluator(
-      regret_player, profile, sampler, root.NumPlayers(), reach_prob_player);
-  const Cfv ev = evaluator(root, 1, 1);
-  return {ev,
-          {std::move(evaluator.regret_table_),
-           std::move(evaluator.reach_probs_table_)},
-          evaluator.num_decision_histories_};
+  return WithConcreteSampler(sampler, [&](auto& concrete_sampler) {
+    PolicyRegretAndReachProbEvaluator evaluator(regret_player, profile,
+                                                concrete_sampler,
+                                                root.NumPlayers(),
+                                                reach_prob_player);
+    const Cfv ev = evaluator(root, 1, 1);
+    return std::make_tuple(ev,
+                           std::make_pair(
+                               std::move(evaluator.regret_table_),
+                               std::move(evaluator.reach_probs_table_)),
+                           evaluator.num_decision_histories_);
+  });
 }
 
 std::tuple<Cfv,
@@ -218,21 +286,60 @@ std::tuple<Cfv,
 PolicyRegretsAndReachProbs(DecisionPoint& root, int regret_player,
                            const Policy& profile, MccfrSampler& sampler,
                            int reach_prob_player) {
-  PolicyRegretAndReachProbEvaluator evaluator(
-      regret_player, profile, sampler, root.NumPlayers(), reach_prob_player);
-  const Cfv ev = evaluator.CounterfactualValue(root, 1.0, 1.0, 0);
-  return {ev,
-          {std::move(evaluator.regret_table_),
-           std::move(evaluator.reach_probs_table_)},
-          evaluator.num_decision_histories_};
+  return WithConcreteSampler(sampler, [&](auto& concrete_sampler) {
+    PolicyRegretAndReachProbEvaluator evaluator(regret_player, profile,
+                                                concrete_sampler,
+                                                root.NumPlayers(),
+                                                reach_prob_player);
+    const Cfv ev = evaluator.CounterfactualValue(root, 1.0, 1.0, 0);
+    return std::make_tuple(ev,
+                           std::make_pair(
+                               std::move(evaluator.regret_table_),
+                               std::move(evaluator.reach_probs_table_)),
+                           evaluator.num_decision_histories_);
+  });
 }
 
-Cfv PolicyRegretEvaluator::CounterfactualValue(
+template <class Sampler>
+Cfv PolicyRegretEvaluator<Sampler>::CounterfactualValue(
     DecisionPoint& decision_point, double importance_weight, int action_idx,
     const std::function<Cfv(DecisionPoint&, double)>& backup) {
+  return WithConcreteDecisionPoint(
+      decision_point, [this, importance_weight, action_idx,
+                       &backup](auto& concrete_decision_point) {
+        return ChanceOutcomesValue(concrete_decision_point, importance_weight,
+                                   action_idx, backup);
+      });
+}
+
+template <class Sampler>
+Cfv PolicyRegretEvaluator<Sampler>::ComputeCounterfactualRegrets(
+    DecisionPoint& decision_point, double importance_weight) {
+  return WithConcreteDecisionPoint(
+      decision_point, [this, importance_weight](auto& concrete_decision_point) {
+        return CounterfactualRegrets(concrete_decision_point,
+                                     importance_weight);
+      });
+}
+
+template <class Sampler>
+Cfv PolicyRegretEvaluator<Sampler>::ComputeReachWeightedRegrets(
+    DecisionPoint& decision_point, double importance_weight) {
+  return WithConcreteDecisionPoint(
+      decision_point, [this, importance_weight](auto& concrete_decision_point) {
+        return ReachWeightedRegrets(concrete_decision_point,
+                                    importance_weight);
+      });
+}
+
+template <class Sampler>
+template <class DP, class Backup>
+Cfv PolicyRegretEvaluator<Sampler>::ChanceOutcomesValue(
+    DP& decision_point, double importance_weight, int action_idx,
+    Backup&& backup) {
   Cfv v = 0;
-  sampler_.SampleChanceOutcomes(
-      decision_point.OutcomeProbabilities(action_idx),
+  sampler_.ForEachChanceOutcome(
+      decision_point, action_idx,
       [action_idx, &decision_point, importance_weight, &backup, &v](
           int outcome, double outcome_prob, double outcome_sampling_prob) {
         decision_point.Apply(action_idx, outcome);
@@ -243,13 +350,14 @@ Cfv PolicyRegretEvaluator::CounterfactualValue(
   return v;
 }
 
-Cfv PolicyRegretEvaluator::CounterfactualValue(
-    DecisionPoint& decision_point, double importance_weight, int action_idx,
-    double next_reach_prob,
-    const std::function<Cfv(DecisionPoint&, double)>& backup) {
+template <class Sampler>
+template <class DP, class Backup>
+Cfv PolicyRegretEvaluator<Sampler>::ChanceOutcomesValue(
+    DP& decision_point, double importance_weight, int action_idx,
+    double next_reach_prob, Backup&& backup) {
   Cfv v = 0;
-  sampler_.SampleChanceOutcomes(
-      decision_point.OutcomeProbabilities(action_idx),
+  sampler_.ForEachChanceOutcome(
+      decision_point, action_idx,
       [this, action_idx, &decision_point, importance_weight, next_reach_prob,
        &backup,
        &v](int outcome, double outcome_prob, double outcome_sampling_prob) {
@@ -262,34 +370,36 @@ Cfv PolicyRegretEvaluator::CounterfactualValue(
   return v;
 }
 
-Cfv PolicyRegretEvaluator::ComputeCounterfactualRegrets(
-    DecisionPoint& decision_point, double importance_weight) {
+template <class Sampler>
+template <class DP>
+Cfv PolicyRegretEvaluator<Sampler>::CounterfactualRegrets(
+    DP& decision_point, double importance_weight) {
   if (decision_point.IsTerminal()) {
     return Return(decision_point) * importance_weight *
            CounterfactualReachProb();
   }
   ++num_decision_histories_;
 
-  assert(decision_point.OpenSpielStatePtr());
-  const std::vector<double> policy =
-      profile_.Response(*decision_point.OpenSpielStatePtr());
+  const absl::Span<const double> policy =
+      response_cache_.Response(decision_point);
 
   Cfv state_value = 0.0;
   if (SaveRegrets(decision_point.PlayerToAct())) {
     double action_values[decision_point.NumActions()];
-    sampler_.SampleTargetPlayerActions(
+    std::fill_n(action_values, decision_point.NumActions(), 0.0);
+    sampler_.ForEachTargetPlayerAction(
         policy, [this, &decision_point, importance_weight, &action_values,
                  &state_value](int action_idx, double action_prob,
                                double sampling_prob) {
-          const Cfv cfv = this->CounterfactualValue(
+          const Cfv cfv = this->ChanceOutcomesValue(
               decision_point, importance_weight / sampling_prob, action_idx,
-              [this](DecisionPoint& next_dp, double next_iw) {
-                return this->ComputeCounterfactualRegrets(next_dp, next_iw);
+              [this](DP& next_dp, double next_iw) {
+                return this->CounterfactualRegrets(next_dp, next_iw);
               });
           action_values[action_idx] = cfv;
           state_value += action_prob * cfv;
         });
-    const std::string info_state = decision_point.InformationStateString();
+    const std::string info_state = decision_point.InformationStateStringRef();
     const int num_legal_actions = decision_point.NumActions();
     auto& regrets = GetOrCreate<std::string, CfValues>(
         regret_table_, info_state, [num_legal_actions]() -> CfValues {
@@ -302,17 +412,17 @@ Cfv PolicyRegretEvaluator::ComputeCounterfactualRegrets(
   } else {
     const double my_reach_prob =
         reach_probabilities_[decision_point.PlayerToAct()];
-    sampler_.SampleExternalPlayerActions(
+    sampler_.ForEachExternalPlayerAction(
         policy,
         [this, my_reach_prob, importance_weight, &state_value, &decision_point](
             int action_idx, double action_prob, double sampling_prob) {
           const double next_reach_probability = my_reach_prob * action_prob;
           if (next_reach_probability > 0) {
-            state_value += CounterfactualValue(
+            state_value += ChanceOutcomesValue(
                 decision_point, importance_weight / sampling_prob, action_idx,
                 next_reach_probability,
-                [this](DecisionPoint& next_dp, double next_iw) {
-                  return this->ComputeCounterfactualRegrets(next_dp, next_iw);
+                [this](DP& next_dp, double next_iw) {
+                  return this->CounterfactualRegrets(next_dp, next_iw);
                 });
           }
         });
@@ -321,8 +431,10 @@ Cfv PolicyRegretEvaluator::ComputeCounterfactualRegrets(
   return state_value;
 }
 
-Cfv PolicyRegretEvaluator::ComputeReachWeightedRegrets(
-    DecisionPoint& decision_point, double importance_weight) {
+template <class Sampler>
+template <class DP>
+Cfv PolicyRegretEvaluator<Sampler>::ReachWeightedRegrets(
+    DP& decision_point, double importance_weight) {
   if (decision_point.IsTerminal()) {
     return Return(decision_point) * importance_weight *
            CounterfactualReachProb();
@@ -330,28 +442,28 @@ Cfv PolicyRegretEvaluator::ComputeReachWeightedRegrets(
   ++num_decision_histories_;
 
   const int current_player = decision_point.PlayerToAct();
-  assert(decision_point.OpenSpielStatePtr());
-  const std::vector<double> policy =
-      profile_.Response(*decision_point.OpenSpielStatePtr());
+  const absl::Span<const double> policy =
+      response_cache_.Response(decision_point);
   const double my_reach_prob = reach_probabilities_[current_player];
 
   Cfv state_value = 0.0;
   if (SaveRegrets(current_player)) {
     double action_values[decision_point.NumActions()];
-    sampler_.SampleTargetPlayerActions(
+    std::fill_n(action_values, decision_point.NumActions(), 0.0);
+    sampler_.ForEachTargetPlayerAction(
         policy, [this, &decision_point, importance_weight, my_reach_prob,
                  &action_values, &state_value](
                     int action_idx, double action_prob, double sampling_prob) {
-          const Cfv cfv = this->CounterfactualValue(
+          const Cfv cfv = this->ChanceOutcomesValue(
               decision_point, importance_weight / sampling_prob, action_idx,
               my_reach_prob * action_prob,
-              [this](DecisionPoint& next_dp, double next_iw) {
-                return this->ComputeReachWeightedRegrets(next_dp, next_iw);
+              [this](DP& next_dp, double next_iw) {
+                return this->ReachWeightedRegrets(next_dp, next_iw);
               });
           action_values[action_idx] = my_reach_prob * cfv;
           state_value += action_prob * cfv;
         });
-    const std::string info_state = decision_point.InformationStateString();
+    const std::string info_state = decision_point.InformationStateStringRef();
     const size_t n = decision_point.NumActions();
     auto& regrets = GetOrCreate<std::string, CfValues>(
         regret_table_, info_state, [n]() -> CfValues {
@@ -362,17 +474,17 @@ Cfv PolicyRegretEvaluator::ComputeReachWeightedRegrets(
       regrets.v_[a] += action_values[a];
     }
   } else {
-    sampler_.SampleExternalPlayerActions(
+    sampler_.ForEachExternalPlayerAction(
         policy, [this, my_reach_prob, importance_weight, current_player,
                  &state_value, &decision_point](
                     int action_idx, double action_prob, double sampling_prob) {
           const double next_reach_probability = my_reach_prob * action_prob;
           if (next_reach_probability > 0) {
-            state_value += CounterfactualValue(
+            state_value += ChanceOutcomesValue(
                 decision_point, importance_weight / sampling_prob, action_idx,
                 next_reach_probability,
-                [this](DecisionPoint& next_dp, double next_iw) {
-                  return this->ComputeReachWeightedRegrets(next_dp, next_iw);
+                [this](DP& next_dp, double next_iw) {
+                  return this->ReachWeightedRegrets(next_dp, next_iw);
                 });
           }
         });
@@ -384,171 +496,865 @@ Cfv PolicyRegretEvaluator::ComputeReachWeightedRegrets(
 std::tuple<Cfv, InfoStateUvm<CfValues>, int> PolicyCounterfactualRegrets(
     DecisionPoint& root, int regret_player, const Policy& profile,
     MccfrSampler& sampler) {
-  PolicyRegretEvaluator evaluator(regret_player, profile, sampler,
-                                  root.NumPlayers());
-  const Cfv ev = evaluator.CounterfactualValue(
-      root, 1.0, 0, [&evaluator](DecisionPoint& next_dp, double next_iw) {
-        return evaluator.ComputeCounterfactualRegrets(next_dp, next_iw);
-      });
-  return {ev, std::move(evaluator.regret_table_),
-          evaluator.num_decision_histories_};
+  return WithConcreteSampler(sampler, [&](auto& concrete_sampler) {
+    PolicyRegretEvaluator evaluator(regret_player, profile, concrete_sampler,
+                                    root.NumPlayers());
+    const Cfv ev = evaluator.CounterfactualValue(
+        root, 1.0, 0, [&evaluator](DecisionPoint& next_dp, double next_iw) {
+          return evaluator.ComputeCounterfactualRegrets(next_dp, next_iw);
+        });
+    return std::make_tuple(ev, std::move(evaluator.regret_table_),
+                           evaluator.num_decision_histories_);
+  });
 }
 
 std::tuple<Cfv, InfoStateUvm<CfValues>, int> PolicyReachWeightedRegrets(
     DecisionPoint& root, int regret_player, const Policy& profile,
     MccfrSampler& sampler) {
-  PolicyRegretEvaluator evaluator(regret_player, profile, sampler,
-                                  root.NumPlayers());
-  const Cfv ev = evaluator.CounterfactualValue(
-      root, 1.0, 0, [&evaluator](DecisionPoint& next_dp, double next_iw) {
-        return evaluator.ComputeReachWeightedRegrets(next_dp, next_iw);
+  return WithConcreteSampler(sampler, [&](auto& concrete_sampler) {
+    PolicyRegretEvaluator evaluator(regret_player, profile, concrete_sampler,
+                                    root.NumPlayers());
+    const Cfv ev = evaluator.CounterfactualValue(
+        root, 1.0, 0, [&evaluator](DecisionPoint& next_dp, double next_iw) {
+          return evaluator.ComputeReachWeightedRegrets(next_dp, next_iw);
+        });
+    return std::make_tuple(ev, std::move(evaluator.regret_table_),
+                           evaluator.num_decision_histories_);
+  });
+}
+
+template <class Sampler>
+Cfv PolicyValueEvaluator<Sampler>::operator()(
+    DecisionPoint& decision_point, double importance_weighted_reach_prob,
+    int action_idx) {
+  return WithConcreteDecisionPoint(
+      decision_point, [this, importance_weighted_reach_prob,
+                       action_idx](auto& concrete_decision_point) {
+        return ChanceOutcomesValue(concrete_decision_point,
+                                   importance_weighted_reach_prob, action_idx);
       });
-  return {ev, std::move(evaluator.regret_table_),
-          evaluator.num_decision_histories_};
 }
 
-Cfv PolicyValueEvaluator::operator()(DecisionPoint& decision_point,
-                                     double importance_weighted_reach_prob,
-                                     int action_idx) {
+template <class Sampler>
+Cfv PolicyValueEvaluator<Sampler>::operator()(
+    DecisionPoint& decision_point, double importance_weighted_reach_prob) {
+  return WithConcreteDecisionPoint(
+      decision_point,
+      [this, importance_weighted_reach_prob](auto& concrete_decision_point) {
+        return HistoryValue(concrete_decision_point,
+                            importance_weighted_reach_prob);
+      });
+}
+
+template <class Sampler>
+template <class DP>
+Cfv PolicyValueEvaluator<Sampler>::ChanceOutcomesValue(
+    DP& decision_point, double importance_weighted_reach_prob,
+    int action_idx) {
   Cfv v = 0;
-  sampler_.SampleChanceOutcomes(
-      decision_point.OutcomeProbabilities(action_idx),
+  sampler_.ForEachChanceOutcome(
+      decision_point, action_idx,
       [this, action_idx, &decision_point, importance_weighted_reach_prob, &v](
           int outcome, double outcome_prob, double outcome_sampling_prob) {
         decision_point.Apply(action_idx, outcome);
-        v += (*this)(decision_point, importance_weighted_reach_prob *
-                                         outcome_prob / outcome_sampling_prob);
+        v += HistoryValue(decision_point, importance_weighted_reach_prob *
+                                              outcome_prob /
+                                              outcome_sampling_prob);
         decision_point.Undo();
       });
   return v;
 }
 
-Cfv PolicyValueEvaluator::operator()(DecisionPoint& decision_point,
-                                     double importance_weighted_reach_prob) {
+template <class Sampler>
+template <class DP>
+Cfv PolicyValueEvaluator<Sampler>::HistoryValue(
+    DP& decision_point, double importance_weighted_reach_prob) {
   if (decision_point.IsTerminal()) {
     return Return(decision_point) * importance_weighted_reach_prob;
   }
+  if (depth_ == task_depth_) {
+    return TaskValue(decision_point, importance_weighted_reach_prob);
+  }
+  if constexpr (std::is_same_v<DP, CompiledDecisionPoint>) {
+    // Tasks are found and merged in traversal order, which memoisation
+    // above them would change. Each task memoises the subtrees below it in
+    // its own evaluator.
+    if (decision_point.IsMerged() && sampler_.IsExhaustive() &&
+        task_depth_ == kNoTasks) {
+      return MemoisedHistoryValue(decision_point,
+                                  importance_weighted_reach_prob);
+    }
+  }
+  return DecisionHistoryValue(decision_point, importance_weighted_reach_prob);
+}
+
+template <class Sampler>
+Cfv PolicyValueEvaluator<Sampler>::MemoisedHistoryValue(
+    CompiledDecisionPoint& decision_point,
+    double importance_weighted_reach_prob) {
+  if (subtree_values_.empty()) {
+    subtree_values_.resize(decision_point.NumHistories());
+  }
+  // Not invalidated by the recursion, which never resizes `subtree_values_`.
+  SubtreeValue& subtree = subtree_values_[decision_point.HistoryIndex()];
+  if (subtree.known_) {
+    num_decision_histories_ += subtree.num_decision_histories_;
+    num_memoised_decision_histories_ += subtree.num_decision_histories_;
+  } else {
+    const int num_decision_histories = num_decision_histories_;
+    subtree.value_ = DecisionHistoryValue(decision_point, 1.0);
+    subtree.num_decision_histories_ =
+        num_decision_histories_ - num_decision_histories;
+    subtree.known_ = true;
+  }
+  return subtree.value_ * importance_weighted_reach_prob;
+}
+
+template <class Sampler>
+template <class DP>
+Cfv PolicyValueEvaluator<Sampler>::DecisionHistoryValue(
+    DP& decision_point, double importance_weighted_reach_prob) {
   ++num_decision_histories_;
+  ++depth_;
 
-  assert(decision_point.OpenSpielStatePtr());
-  const std::vector<double> policy =
-      profile_.Response(*decision_point.OpenSpielStatePtr());
+  const absl::Span<const double> policy =
+      response_cache_.Response(decision_point);
 
   Cfv state_value = 0;
   if (decision_point.PlayerToAct() == player_) {
-    sampler_.SampleTargetPlayerActions(
+    sampler_.ForEachTargetPlayerAction(
         policy,
         [this, &decision_point, importance_weighted_reach_prob, &state_value](
             int action_idx, double action_prob, double sampling_prob) {
           if (action_prob > 0) {
-            state_value += (*this)(
+            state_value += ChanceOutcomesValue(
                 decision_point,
                 action_prob * importance_weighted_reach_prob / sampling_prob,
                 action_idx);
           }
         });
   } else {
-    sampler_.SampleExternalPlayerActions(
+    sampler_.ForEachExternalPlayerAction(
         policy,
         [this, importance_weighted_reach_prob, &state_value, &decision_point](
             int action_idx, double action_prob, double sampling_prob) {
           if (action_prob > 0) {
-            state_value += (*this)(
+            state_value += ChanceOutcomesValue(
                 decision_point,
                 action_prob * importance_weighted_reach_prob / sampling_prob,
                 action_idx);
           }
         });
   }
+  --depth_;
   return state_value;
 }
 
+template <class Sampler>
+Cfv PolicyValueEvaluator<Sampler>::InParallel(DecisionPoint& root,
+                                              size_t num_threads,
+                                              size_t task_depth) {
+  SPIEL_CHECK_TRUE(sampler_.IsExhaustive());
+  tasks_.clear();
+  task_depth_ = task_depth;
+  merging_ = false;
+  (*this)(root, 1.0, 0);
+
+  RunTasks(tasks_.size(), num_threads, [this](size_t i) {
+    if (tasks_[i].root_) {
+      RunTask(tasks_[i], *tasks_[i].root_);
+    }
+  });
+
+  num_decision_histories_ = 0;
+  num_memoised_decision_histories_ = 0;
+  merging_ = true;
+  next_task_ = 0;
+  const Cfv ev = (*this)(root, 1.0, 0);
+  SPIEL_CHECK_EQ(next_task_, tasks_.size());
+  task_depth_ = kNoTasks;
+  merging_ = false;
+  return ev;
+}
+
+template <class Sampler>
+template <class DP>
+Cfv PolicyValueEvaluator<Sampler>::TaskValue(
+    DP& decision_point, double importance_weighted_reach_prob) {
+  if (merging_) {
+    const TraversalTask& task = tasks_[next_task_++];
+    num_decision_histories_ += task.num_decision_histories_;
+    num_memoised_decision_histories_ += task.num_memoised_decision_histories_;
+    return task.value_;
+  }
+  TraversalTask& task = tasks_.emplace_back();
+  task.importance_weighted_reach_prob_ = importance_weighted_reach_prob;
+  if constexpr (std::is_same_v<DP, CompiledDecisionPoint>) {
+    task.root_.emplace(decision_point);
+  } else {
+    RunTask(task, decision_point);
+  }
+  return 0;
+}
+
+template <class Sampler>
+template <class DP>
+void PolicyValueEvaluator<Sampler>::RunTask(TraversalTask& task,
+                                            DP& decision_point) const {
+  NullSampler sampler;
+  PolicyValueEvaluator<NullSampler> evaluator(
+      player_, response_cache_.CachedPolicy(), sampler,
+      decision_point.NumPlayers());
+  task.value_ =
+      evaluator(decision_point, task.importance_weighted_reach_prob_);
+  task.num_decision_histories_ = evaluator.num_decision_histories_;
+  task.num_memoised_decision_histories_ =
+      evaluator.num_memoised_decision_histories_;
+}
+
 std::pair<Cfv, int> PolicyValue(DecisionPoint& root, int player,
                                 const Policy& profile, MccfrSampler& sampler) {
+  return WithConcreteSampler(sampler, [&](auto& concrete_sampler) {
+    PolicyValueEvaluator evaluator(player, profile, concrete_sampler,
+                                   root.NumPlayers());
+    const Cfv ev = evaluator(root, 1.0, 0);
+    return std::make_pair(ev, evaluator.num_decision_histories_);
+  });
+}
+
+std::pair<Cfv, int> PolicyValueInParallel(DecisionPoint& root, int player,
+                                          const Policy& profile,
+                                          size_t num_threads,
+                                          size_t task_depth) {
+  NullSampler sampler;
   PolicyValueEvaluator evaluator(player, profile, sampler, root.NumPlayers());
-  const Cfv ev = evaluator(root, 1.0, 0);
+  const Cfv ev = evaluator.InParallel(root, num_threads, task_depth);
   return {ev, evaluator.num_decision_histories_};
 }
 
+std::vector<Cfv> PolicyValuesEvaluator::operator()(DecisionPoint& root) {
+  const size_t num_players = root.NumPlayers();
+  SPIEL_CHECK_EQ(substitutes_.size(), num_players);
+  compatriot_responses_.Reset();
+  for (auto& responses : substitute_responses_) {
+    responses.Reset();
+  }
+  subtree_values_.clear();
+  double importance_weighted_reach_probs[num_players];
+  bool active[num_players];
+  double values[num_players];
+  for (size_t player = 0; player < num_players; ++player) {
+    importance_weighted_reach_probs[player] = 1.0;
+    active[player] = true;
+    values[player] = 0;
+  }
+  // Variable length arrays can only be captured through pointers.
+  WithConcreteDecisionPoint(
+      root, [this, iwrps = &importance_weighted_reach_probs[0],
+             active = &active[0], values = &values[0]](auto& concrete_root) {
+        Values(concrete_root, iwrps, active, 0, values);
+      });
+  return std::vector<Cfv>(values, values + num_players);
+}
+
+ResponseCacheStats PolicyValuesEvaluator::ResponseStats() const {
+  ResponseCacheStats stats = compatriot_responses_.Stats();
+  for (const auto& responses : substitute_responses_) {
+    stats += responses.Stats();
+  }
+  return stats;
+}
+
+template <class DP>
+void PolicyValuesEvaluator::Values(
+    DP& decision_point, const double* importance_weighted_reach_probs,
+    const bool* active, int action_idx, double* values) {
+  const size_t num_players = decision_point.NumPlayers();
+  double next_iwrps[num_players];
+  double state_values[num_players];
+  for (size_t outcome = 0; outcome < decision_point.NumOutcomes(action_idx);
+       ++outcome) {
+    const double outcome_prob =
+        decision_point.OutcomeProbabilitiesRef(action_idx)[outcome];
+    decision_point.Apply(action_idx, outcome);
+    if (decision_point.IsTerminal()) {
+      const auto returns = decision_point.ReturnsRef();
+      for (size_t player = 0; player < num_players; ++player) {
+        if (active[player]) {
+          values[player] += returns[player] *
+                            (importance_weighted_reach_probs[player] *
+                             outcome_prob);
+        }
+      }
+    } else {
+      for (size_t player = 0; player < num_players; ++player) {
+        next_iwrps[player] =
+            importance_weighted_reach_probs[player] * outcome_prob;
+        state_values[player] = 0;
+      }
+      if constexpr (std::is_same_v<DP, CompiledDecisionPoint>) {
+        if (decision_point.IsMerged()) {
+          MemoisedStateValues(decision_point, next_iwrps, active,
+                              state_values);
+        } else {
+          StateValues(decision_point, next_iwrps, active, state_values);
+        }
+      } else {
+        StateValues(decision_point, next_iwrps, active, state_values);
+      }
+      for (size_t player = 0; player < num_players; ++player) {
+        if (active[player]) {
+          values[player] += state_values[player];
+        }
+      }
+    }
+    decision_point.Undo();
+  }
+}
+
+template <class DP>
+void PolicyValuesEvaluator::StateValues(
+    DP& decision_point, const double* importance_weighted_reach_probs,
+    const bool* active, double* state_values) {
+  const size_t num_players = decision_point.NumPlayers();
+  const open_spiel::Player current_player = decision_point.PlayerToAct();
+  bool others_active = false;
+  for (size_t player = 0; player < num_players; ++player) {
+    if (active[player]) {
+      ++num_decision_histories_[player];
+      others_active = others_active || player != current_player;
+    }
+  }
+  const absl::Span<const double> policy =
+      active[current_player]
+          ? substitute_responses_[current_player].Response(decision_point)
+          : kNoResponse;
+  const absl::Span<const double> compatriot_policy =
+      others_active ? compatriot_responses_.Response(decision_point)
+                    : kNoResponse;
+
+  double child_iwrps[num_players];
+  bool child_active[num_players];
+  double action_values[num_players];
+  for (size_t a = 0; a < decision_point.NumActions(); ++a) {
+    bool any_active = false;
+    for (size_t player = 0; player < num_players; ++player) {
+      double action_prob = 0;
+      if (active[player]) {
+        action_prob =
+            player == current_player ? policy[a] : compatriot_policy[a];
+      }
+      child_active[player] = action_prob > 0;
+      child_iwrps[player] =
+          child_active[player]
+              ? action_prob * importance_weighted_reach_probs[player]
+              : 0;
+      action_values[player] = 0;
+      any_active = any_active || child_active[player];
+    }
+    if (!any_active) {
+      continue;
+    }
+    Values(decision_point, child_iwrps, child_active, a, action_values);
+    for (size_t player = 0; player < num_players; ++player) {
+      if (child_active[player]) {
+        state_values[player] += action_values[player];
+      }
+    }
+  }
+}
+
+// A player's value of a subtree depends only on whether the player is
+// active when it is reached, so only active players' values are memoised and
+// the subtree is only traversed for the active players whose values are not
+// yet known.
+void PolicyValuesEvaluator::MemoisedStateValues(
+    CompiledDecisionPoint& decision_point,
+    const double* importance_weighted_reach_probs, const bool* active,
+    double* state_values) {
+  const size_t num_players = decision_point.NumPlayers();
+  if (subtree_values_.empty()) {
+    subtree_values_.resize(decision_point.NumHistories() * num_players);
+  }
+  SubtreeValue* subtree =
+      &subtree_values_[decision_point.HistoryIndex() * num_players];
+  bool unknown[num_players];
+  bool any_unknown = false;
+  for (size_t player = 0; player < num_players; ++player) {
+    unknown[player] = active[player] && !subtree[player].known_;
+    any_unknown = any_unknown || unknown[player];
+  }
+  if (any_unknown) {
+    double unit_iwrps[num_players];
+    double values[num_players];
+    int num_decision_histories[num_players];
+    for (size_t player = 0; player < num_players; ++player) {
+      unit_iwrps[player] = 1.0;
+      values[player] = 0;
+      num_decision_histories[player] = num_decision_histories_[player];
+    }
+    StateValues(decision_point, unit_iwrps, unknown, values);
+    for (size_t player = 0; player < num_players; ++player) {
+      if (unknown[player]) {
+        subtree[player].value_ = values[player];
+        subtree[player].num_decision_histories_ =
+            num_decision_histories_[player] - num_decision_histories[player];
+        subtree[player].known_ = true;
+      }
+    }
+  }
+  for (size_t player = 0; player < num_players; ++player) {
+    if (!active[player]) {
+      continue;
+    }
+    if (!unknown[player]) {
+      num_decision_histories_[player] +=
+          subtree[player].num_decision_histories_;
+      num_memoised_decision_histories_[player] +=
+          subtree[player].num_decision_histories_;
+    }
+    state_values[player] +=
+        subtree[player].value_ * importance_weighted_reach_probs[player];
+  }
+}
+
+std::pair<std::vector<Cfv>, std::vector<int>> PolicyValues(
+    DecisionPoint& root, const Policy& compatriots,
+    const std::vector<const Policy*>& substitutes) {
+  PolicyValuesEvaluator evaluator(compatriots, substitutes);
+  std::vector<Cfv> values = evaluator(root);
+  return {std::move(values), std::move(evaluator.num_decision_histories_)};
+}
+
+template <class DP, class Sampler>
 Cfv PolicyCfValueTreeEvaluator::ComputeCfValueTree(
-    std::vector<std::string>& siblings, DecisionPoint& decision_point,
-    const Policy& profile, MccfrSampler& sampler,
+    Parent parent, DP& decision_point, Sampler& sampler,
     double importance_weighted_reach_prob) {
+  if (depth_ == task_depth_) {
+    return merging_ ? MergeTask(parent)
+                    : TaskValue(parent, decision_point,
+                                importance_weighted_reach_prob);
+  }
   ++num_decision_histories_;
+  ++depth_;
 
-  assert(decision_point.OpenSpielStatePtr());
-  const std::vector<double> policy =
-      profile.Response(*decision_point.OpenSpielStatePtr());
+  const absl::Span<const double> policy =
+      response_cache_.Response(decision_point);
 
   Cfv state_value = 0.0;
   if (SaveRegrets(decision_point.PlayerToAct())) {
-    if (!cf_value_tree_.contains(decision_point.InformationStateStringRef())) {
-      cf_value_tree_.emplace(decision_point.InformationStateStringRef(),
-                             decision_point.NumActions());
-      siblings.push_back(decision_point.InformationStateStringRef());
-    }
+    const size_t slot = NodeSlot(parent, decision_point);
 
     double action_values[decision_point.NumActions()];
-    sampler.SampleTargetPlayerActions(
-        policy, [this, &decision_point, importance_weighted_reach_prob,
-                 &action_values, &state_value, &sampler, &profile](
+    std::fill_n(action_values, decision_point.NumActions(), 0.0);
+    sampler.ForEachTargetPlayerAction(
+        policy, [this, slot, &decision_point, importance_weighted_reach_prob,
+                 &action_values, &state_value, &sampler](
                     int action_idx, double action_prob, double sampling_prob) {
-          std::vector<std::string> child_keys;
           const Cfv cfv = CounterfactualValue(
-              child_keys, decision_point, profile, sampler,
-              importance_weighted_reach_prob / sampling_prob, action_idx);
+              {slot, static_cast<size_t>(action_idx)}, decision_point,
+              sampler, importance_weighted_reach_prob / sampling_prob,
+              action_idx);
           action_values[action_idx] = cfv;
           state_value += action_prob * cfv;
-          if (child_keys.size() > 0) {
-            Concat(cf_value_tree_.at(decision_point.InformationStateStringRef())
-                       .child_keys_[action_idx],
-                   child_keys);
-          }
         });
-    auto& cf_values =
-        cf_value_tree_.at(decision_point.InformationStateStringRef())
-            .cf_values_;
+    auto& cf_values = node_values_[slot];
     cf_values.ev_ += state_value;
     assert(decision_point.NumActions() == cf_values.Size());
     for (size_t a = 0; a < decision_point.NumActions(); ++a) {
       cf_values.v_[a] += action_values[a];
     }
   } else {
-    sampler.SampleExternalPlayerActions(
+    sampler.ForEachExternalPlayerAction(
         policy, [this, importance_weighted_reach_prob, &state_value,
-                 &decision_point, &siblings, &sampler, &profile](
+                 &decision_point, parent, &sampler](
                     int action_idx, double action_prob, double sampling_prob) {
           if (action_prob > 0) {
             state_value += CounterfactualValue(
-                siblings, decision_point, profile, sampler,
+                parent, decision_point, sampler,
                 action_prob * importance_weighted_reach_prob / sampling_prob,
                 action_idx);
           }
         });
   }
+  --depth_;
   return state_value;
 }
 
+template <class DP>
+size_t PolicyCfValueTreeEvaluator::NodeSlot(Parent parent,
+                                            const DP& decision_point) {
+  const size_t id = decision_point.InfoSetId();
+  if (node_by_id_.size() <= id) {
+    node_by_id_.resize(decision_point.NumInfoSets(regret_player_), kNoNode);
+  }
+  return NodeSlot(parent, id, decision_point.InformationStateStringRef(),
+                  decision_point.NumActions());
+}
+
+size_t PolicyCfValueTreeEvaluator::NodeSlot(Parent parent, size_t id,
+                                            const std::string& info_state,
+                                            size_t num_actions) {
+  if (node_by_id_.size() <= id) {
+    node_by_id_.resize(id + 1, kNoNode);
+  }
+  size_t& slot = node_by_id_[id];
+  if (slot == kNoNode) {
+    slot = node_keys_.size();
+    node_keys_.push_back(info_state);
+    node_values_.emplace_back(num_actions);
+    node_info_set_ids_.push_back(id);
+    node_traversals_.push_back(traversal_);
+    visits_.push_back({slot, parent});
+  } else if (node_traversals_[slot] != traversal_) {
+    node_traversals_[slot] = traversal_;
+    node_values_[slot].Reset();
+    visits_.push_back({slot, parent});
+  }
+  return slot;
+}
+
+void PolicyCfValueTreeEvaluator::BeginTraversal(const Policy& profile,
+                                                size_t info_set_id_space) {
+  if (info_set_id_space != info_set_id_space_) {
+    // The nodes' IDs may refer to other info sets in this tree.
+    Reset();
+    info_set_id_space_ = info_set_id_space;
+  }
+  ++traversal_;
+  num_decision_histories_ = 0;
+  std::swap(visits_, previous_visits_);
+  visits_.clear();
+  response_cache_.Reset(profile);
+}
+
+CfValueTreeEvaluation PolicyCfValueTreeEvaluator::FinishTraversal(Cfv ev) {
+  if (visits_ != previous_visits_ || cf_value_tree_.Size() != visits_.size()) {
+    RebuildTree();
+  } else {
+    for (size_t i = 0; i < visits_.size(); ++i) {
+      cf_value_tree_.nodes_[i].cf_values_ = node_values_[visits_[i].slot_];
+    }
+  }
+  return {ev, &cf_value_tree_, num_decision_histories_};
+}
+
+void PolicyCfValueTreeEvaluator::RebuildTree() {
+  cf_value_tree_.Clear();
+  cf_value_tree_.info_set_id_space_ = info_set_id_space_;
+  cf_value_tree_.player_ = regret_player_;
+  cf_value_tree_.nodes_.reserve(visits_.size());
+  tree_index_by_slot_.resize(node_keys_.size());
+  for (const Visit& visit : visits_) {
+    const size_t slot = visit.slot_;
+    const size_t idx = cf_value_tree_.AddNode(
+        node_keys_[slot], node_values_[slot].Size(), node_info_set_ids_[slot]);
+    cf_value_tree_.nodes_[idx].cf_values_ = node_values_[slot];
+    tree_index_by_slot_[slot] = idx;
+    if (visit.parent_.slot_ == kNoNode) {
+      cf_value_tree_.roots_.push_back(idx);
+    } else {
+      cf_value_tree_.nodes_[tree_index_by_slot_[visit.parent_.slot_]]
+          .children_[visit.parent_.action_]
+          .push_back(idx);
+    }
+  }
+}
+
+CfValueTreeEvaluation PolicyCfValueTreeEvaluator::ComputeCfValueTreeEvaluation(
+    DecisionPoint& root, const Policy& profile, MccfrSampler& sampler) {
+  BeginTraversal(profile, root.InfoSetIdSpace());
+  const Cfv root_val = WithConcreteSampler(sampler, [&](auto& concrete_sampler) {
+    return WithConcreteDecisionPoint(root, [&](auto& concrete_root) {
+      return CounterfactualValue(Parent(), concrete_root, concrete_sampler, 1.0,
+                                 0);
+    });
+  });
+  return FinishTraversal(root_val);
+}
+
+CfValueTreeEvaluation
+PolicyCfValueTreeEvaluator::ComputeCfValueTreeEvaluationInParallel(
+    DecisionPoint& root, const Policy& profile, size_t num_threads,
+    size_t task_depth) {
+  NullSampler sampler;
+  const auto traverse = [this, &root, &sampler] {
+    return WithConcreteDecisionPoint(root, [&](auto& concrete_root) {
+      return CounterfactualValue(Parent(), concrete_root, sampler, 1.0, 0);
+    });
+  };
+  BeginTraversal(profile, root.InfoSetIdSpace());
+  tasks_.clear();
+  task_depth_ = task_depth;
+  merging_ = false;
+  traverse();
+
+  RunTasks(tasks_.size(), num_threads, [this](size_t i) {
+    if (tasks_[i].root_) {
+      RunTask(i, *tasks_[i].root_);
+    }
+  });
+
+  // The first traversal's nodes are rebuilt with the tasks merged in.
+  ++traversal_;
+  num_decision_histories_ = 0;
+  visits_.clear();
+  merging_ = true;
+  next_task_ = 0;
+  const Cfv root_val = traverse();
+  SPIEL_CHECK_EQ(next_task_, tasks_.size());
+  task_depth_ = kNoTasks;
+  merging_ = false;
+  return FinishTraversal(root_val);
+}
+
+template <class DP>
+Cfv PolicyCfValueTreeEvaluator::TaskValue(
+    Parent parent, DP& decision_point, double importance_weighted_reach_prob) {
+  const size_t task_idx = tasks_.size();
+  tasks_.emplace_back().importance_weighted_reach_prob_ =
+      importance_weighted_reach_prob;
+  if (task_evaluators_.size() == task_idx) {
+    task_evaluators_.emplace_back(regret_player_);
+  }
+  if constexpr (std::is_same_v<DP, CompiledDecisionPoint>) {
+    tasks_[task_idx].root_.emplace(decision_point);
+  } else {
+    RunTask(task_idx, decision_point);
+  }
+  return 0;
+}
+
+template <class DP>
+void PolicyCfValueTreeEvaluator::RunTask(size_t task_idx, DP& decision_point) {
+  TraversalTask& task = tasks_[task_idx];
+  PolicyCfValueTreeEvaluator& evaluator = task_evaluators_[task_idx];
+  evaluator.BeginTraversal(response_cache_.CachedPolicy(),
+                           decision_point.InfoSetIdSpace());
+  NullSampler sampler;
+  task.value_ = evaluator.ComputeCfValueTree(
+      Parent(), decision_point, sampler, task.importance_weighted_reach_prob_);
+  task.num_decision_histories_ = evaluator.num_decision_histories_;
+}
+
+Cfv PolicyCfValueTreeEvaluator::MergeTask(Parent parent) {
+  const size_t task_idx = next_task_++;
+  const PolicyCfValueTreeEvaluator& evaluator = task_evaluators_[task_idx];
+  num_decision_histories_ += tasks_[task_idx].num_decision_histories_;
+  task_slots_.resize(evaluator.node_keys_.size());
+  for (const Visit& visit : evaluator.visits_) {
+    // Nodes that the task reached first are below `parent`.
+    const Parent merged_parent =
+        visit.parent_.slot_ == kNoNode
+            ? parent
+            : Parent{task_slots_[visit.parent_.slot_], visit.parent_.action_};
+    const CfValues& task_values = evaluator.node_values_[visit.slot_];
+    const size_t slot =
+        NodeSlot(merged_parent, evaluator.node_info_set_ids_[visit.slot_],
+                 evaluator.node_keys_[visit.slot_], task_values.Size());
+    task_slots_[visit.slot_] = slot;
+    CfValues& values = node_values_[slot];
+    values.ev_ += task_values.ev_;
+    for (size_t a = 0; a < values.Size(); ++a) {
+      values.v_[a] += task_values.v_[a];
+    }
+  }
+  return tasks_[task_idx].value_;
+}
+
+template <class DP, class Sampler>
 Cfv PolicyCfValueTreeEvaluator::CounterfactualValue(
-    std::vector<std::string>& siblings, DecisionPoint& decision_point,
-    const Policy& profile, MccfrSampler& sampler,
+    Parent parent, DP& decision_point, Sampler& sampler,
     double importance_weighted_reach_prob, int action_idx) {
   Cfv v = 0;
-  sampler.SampleChanceOutcomes(
-      decision_point.OutcomeProbabilities(action_idx),
+  sampler.ForEachChanceOutcome(
+      decision_point, action_idx,
       [this, action_idx, &decision_point, importance_weighted_reach_prob, &v,
-       &siblings, &profile, &sampler](int outcome, double outcome_prob,
-                                      double outcome_sampling_prob) {
+       parent, &sampler](int outcome, double outcome_prob,
+                         double outcome_sampling_prob) {
         decision_point.Apply(action_idx, outcome);
         const double next_iwrp = importance_weighted_reach_prob * outcome_prob /
                                  outcome_sampling_prob;
         v += decision_point.IsTerminal()
                  ? Return(decision_point) * next_iwrp
-                 : ComputeCfValueTree(siblings, decision_point, profile,
-                                      sampler, next_iwrp);
+                 : ComputeCfValueTree(parent, decision_point, sampler,
+                                      next_iwrp);
         decision_point.Undo();
       });
   return v;
 }
 
+std::vector<CfValueTreeEvaluation>
+FusedCfValueTreeEvaluator::ComputeCfValueTreeEvaluations(DecisionPoint& root) {
+  const size_t num_players = root.NumPlayers();
+  SPIEL_CHECK_EQ(evaluators_.size(), num_players);
+  SPIEL_CHECK_EQ(substitutes_.size(), num_players);
+  compatriot_responses_.Reset();
+  double importance_weighted_reach_probs[num_players];
+  bool active[num_players];
+  PolicyCfValueTreeEvaluator::Parent parents[num_players];
+  double values[num_players];
+  for (size_t player = 0; player < num_players; ++player) {
+    SPIEL_CHECK_EQ(evaluators_[player].regret_player_, player);
+    evaluators_[player].BeginTraversal(*substitutes_[player],
+                                       root.InfoSetIdSpace());
+    importance_weighted_reach_probs[player] = 1.0;
+    active[player] = true;
+    values[player] = 0;
+  }
+  // Variable length arrays can only be captured through pointers.
+  WithConcreteDecisionPoint(
+      root, [this, iwrps = &importance_weighted_reach_probs[0],
+             active = &active[0], parents = &parents[0],
+             values = &values[0]](auto& concrete_root) {
+        CounterfactualValues(concrete_root, iwrps, active, parents, 0, values);
+      });
+
+  std::vector<CfValueTreeEvaluation> evaluations;
+  evaluations.reserve(num_players);
+  for (size_t player = 0; player < num_players; ++player) {
+    evaluations.push_back(evaluators_[player].FinishTraversal(values[player]));
+  }
+  return evaluations;
+}
+
+ResponseCacheStats FusedCfValueTreeEvaluator::ResponseStats() const {
+  ResponseCacheStats stats = compatriot_responses_.Stats();
+  for (const auto& evaluator : evaluators_) {
+    stats += evaluator.ResponseStats();
+  }
+  return stats;
+}
+
+template <class DP>
+void FusedCfValueTreeEvaluator::CounterfactualValues(
+    DP& decision_point, const double* importance_weighted_reach_probs,
+    const bool* active, const PolicyCfValueTreeEvaluator::Parent* parents,
+    int action_idx, double* values) {
+  const size_t num_players = decision_point.NumPlayers();
+  double next_iwrps[num_players];
+  double state_values[num_players];
+  for (size_t outcome = 0; outcome < decision_point.NumOutcomes(action_idx);
+       ++outcome) {
+    const double outcome_prob =
+        decision_point.OutcomeProbabilitiesRef(action_idx)[outcome];
+    decision_point.Apply(action_idx, outcome);
+    if (decision_point.IsTerminal()) {
+      const auto returns = decision_point.ReturnsRef();
+      for (size_t player = 0; player < num_players; ++player) {
+        if (active[player]) {
+          values[player] += returns[player] *
+                            (importance_weighted_reach_probs[player] *
+                             outcome_prob);
+        }
+      }
+    } else {
+      for (size_t player = 0; player < num_players; ++player) {
+        next_iwrps[player] =
+            importance_weighted_reach_probs[player] * outcome_prob;
+        state_values[player] = 0;
+      }
+      ComputeCfValueTrees(decision_point, next_iwrps, active, parents,
+                          state_values);
+      for (size_t player = 0; player < num_players; ++player) {
+        if (active[player]) {
+          values[player] += state_values[player];
+        }
+      }
+    }
+    decision_point.Undo();
+  }
+}
+
+template <class DP>
+void FusedCfValueTreeEvaluator::ComputeCfValueTrees(
+    DP& decision_point, const double* importance_weighted_reach_probs,
+    const bool* active, const PolicyCfValueTreeEvaluator::Parent* parents,
+    double* state_values) {
+  const size_t num_players = decision_point.NumPlayers();
+  const open_spiel::Player current_player = decision_point.PlayerToAct();
+  bool others_active = false;
+  for (size_t player = 0; player < num_players; ++player) {
+    if (active[player]) {
+      ++evaluators_[player].num_decision_histories_;
+      others_active = others_active || player != current_player;
+    }
+  }
+  auto& evaluator = evaluators_[current_player];
+  const absl::Span<const double> policy =
+      active[current_player]
+          ? evaluator.response_cache_.Response(decision_point)
+          : kNoResponse;
+  const absl::Span<const double> compatriot_policy =
+      others_active ? compatriot_responses_.Response(decision_point)
+                    : kNoResponse;
+
+  const size_t slot =
+      active[current_player]
+          ? evaluator.NodeSlot(parents[current_player], decision_point)
+          : 0;
+  const size_t num_actions = decision_point.NumActions();
+  double action_values[num_actions];
+  double child_iwrps[num_players];
+  bool child_active[num_players];
+  PolicyCfValueTreeEvaluator::Parent child_parents[num_players];
+  double cfvs[num_players];
+  for (size_t a = 0; a < num_actions; ++a) {
+    bool any_active = false;
+    for (size_t player = 0; player < num_players; ++player) {
+      if (player == current_player) {
+        child_active[player] = active[player];
+        child_iwrps[player] = importance_weighted_reach_probs[player];
+      } else {
+        child_active[player] = active[player] && compatriot_policy[a] > 0;
+        child_iwrps[player] =
+            child_active[player]
+                ? compatriot_policy[a] * importance_weighted_reach_probs[player]
+                : 0;
+      }
+      child_parents[player] = parents[player];
+      cfvs[player] = 0;
+      any_active = any_active || child_active[player];
+    }
+    if (!any_active) {
+      continue;
+    }
+    child_parents[current_player] = {slot, a};
+    CounterfactualValues(decision_point, child_iwrps, child_active,
+                         child_parents, a, cfvs);
+    for (size_t player = 0; player < num_players; ++player) {
+      if (!child_active[player]) {
+        continue;
+      } else if (player == current_player) {
+        action_values[a] = cfvs[player];
+        state_values[player] += policy[a] * cfvs[player];
+      } else {
+        state_values[player] += cfvs[player];
+      }
+    }
+  }
+  if (active[current_player]) {
+    auto& cf_values = evaluator.node_values_[slot];
+    cf_values.ev_ += state_values[current_player];
+    for (size_t a = 0; a < num_actions; ++a) {
+      cf_values.v_[a] += action_values[a];
+    }
+  }
+}
+
+template class PolicyRegretAndReachProbEvaluator<MccfrSampler>;
+template class PolicyRegretAndReachProbEvaluator<NullSampler>;
+template class PolicyRegretAndReachProbEvaluator<ChanceSampler>;
+template class PolicyRegretAndReachProbEvaluator<ExternalSampler>;
+template class PolicyRegretAndReachProbEvaluator<OutcomeSampler>;
+template class PolicyRegretEvaluator<MccfrSampler>;
+template class PolicyRegretEvaluator<NullSampler>;
+template class PolicyRegretEvaluator<ChanceSampler>;
+template class PolicyRegretEvaluator<ExternalSampler>;
+template class PolicyRegretEvaluator<OutcomeSampler>;
+template class PolicyValueEvaluator<MccfrSampler>;
+template class PolicyValueEvaluator<NullSampler>;
+template class PolicyValueEvaluator<ChanceSampler>;
+template class PolicyValueEvaluator<ExternalSampler>;
+template class PolicyValueEvaluator<OutcomeSampler>;
 }  // namespace hr_edl
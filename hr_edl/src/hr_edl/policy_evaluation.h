@@ -3,6 +3,7 @@
 
 #include <limits>
 #include <memory>
+#include <optional>
 #include <random>
 #include <vector>
 
@@ -16,10 +17,48 @@
 
 namespace hr_edl {
 
+// Parallel traversals split into tasks at the decision histories this many
+// decision histories below the root.
+constexpr size_t kDefaultTaskDepth = 2;
+
+// A subtree that a parallel traversal evaluates separately.
+//
+// A parallel traversal walks the histories above its tasks twice: first to
+// find the tasks and then, once they have run, to combine their results in
+// the order that a serial traversal would reach them. Tasks are the same
+// whatever the number of threads, so neither is the result.
+struct TraversalTask {
+  // A cursor at the task's root if the task can run on another thread.
+  std::optional<CompiledDecisionPoint> root_;
+  double importance_weighted_reach_prob_;
+  Cfv value_;
+  int num_decision_histories_;
+  // Only counted by `PolicyValueEvaluator`.
+  int num_memoised_decision_histories_;
+};
+
+// The value of a subtree of a merged tree to one player, and the number of
+// decision histories in it that a traversal visits, when the subtree is
+// reached with probability one. Neither depends on the path by which the
+// subtree is reached, so an exhaustive traversal computes them once and
+// scales the value by each path's reach probability.
+struct SubtreeValue {
+  bool known_ = false;
+  Cfv value_ = 0;
+  int num_decision_histories_ = 0;
+};
+
+// The evaluators below are instantiated on `MccfrSampler` and on each
+// concrete sampler. The functions that construct them from an `MccfrSampler`
+// use the instantiation for its concrete type so that sampling callbacks are
+// inlined, and fall back to virtual calls for other samplers. Likewise, each
+// traversal that starts from a `DecisionPoint` recurses through a template
+// instantiated on its concrete type, if it has one.
+template <class Sampler = MccfrSampler>
 class PolicyRegretAndReachProbEvaluator {
  public:
   PolicyRegretAndReachProbEvaluator(int regret_player, const Policy& profile,
-                                    MccfrSampler& sampler, size_t num_players,
+                                    Sampler& sampler, size_t num_players,
                                     int reach_prob_player = -1)
       : regret_table_(),
         reach_probs_table_(),
@@ -28,7 +67,8 @@ class PolicyRegretAndReachProbEvaluator {
         profile_(profile),
         sampler_(sampler),
         reach_prob_player_(reach_prob_player),
-        reach_probabilities_(num_players, 1.0) {}
+        reach_probabilities_(num_players, 1.0),
+        response_cache_(profile) {}
   virtual ~PolicyRegretAndReachProbEvaluator() = default;
 
   inline bool SaveRegrets(int current_player) const {
@@ -47,6 +87,9 @@ class PolicyRegretAndReachProbEvaluator {
   Cfv CounterfactualValue(DecisionPoint& decision_point,
                           double chance_reach_importance_weight,
                           double player_sampling_prob, int action_idx);
+  const ResponseCacheStats& ResponseStats() const {
+    return response_cache_.Stats();
+  }
 
  public:
   InfoStateUvm<CfValues> regret_table_;
@@ -54,14 +97,23 @@ class PolicyRegretAndReachProbEvaluator {
   int num_decision_histories_;
 
  private:
-  double Return(DecisionPoint& decision_point) const {
+  template <class DP>
+  double Return(DP& decision_point) const {
     return decision_point.ReturnsRef()[regret_player_];
   }
   double CounterfactualReachProb() const {
     return ::hr_edl::CounterfactualReachProb(reach_probabilities_,
                                                          regret_player_);
   }
-  Cfv CounterfactualValue(DecisionPoint& decision_point,
+  template <class DP>
+  Cfv HistoryValue(DP& decision_point, double chance_reach_importance_weight,
+                   double player_sampling_prob);
+  template <class DP>
+  Cfv ChanceOutcomesValue(DP& decision_point,
+                          double chance_reach_importance_weight,
+                          double player_sampling_prob, int action_idx);
+  template <class DP>
+  Cfv ChanceOutcomesValue(DP& decision_point,
                           double chance_reach_importance_weight,
                           double player_sampling_prob, int action_idx,
                           double next_reach_prob);
@@ -69,9 +121,10 @@ class PolicyRegretAndReachProbEvaluator {
  private:
   const int regret_player_;
   const Policy& profile_;
-  MccfrSampler& sampler_;
+  Sampler& sampler_;
   int reach_prob_player_;
   std::vector<double> reach_probabilities_;
+  ResponseCache response_cache_;
 };
 
 std::tuple<Cfv,
@@ -88,16 +141,17 @@ PolicyRegretsAndReachProbs(DecisionPoint& root, int regret_player,
                            const Policy& profile, MccfrSampler& sampler,
                            int reach_prob_player = -1);
 
+template <class Sampler = MccfrSampler>
 class PolicyRegretEvaluator {
  public:
   PolicyRegretEvaluator(int regret_player, const Policy& profile,
-                        MccfrSampler& sampler, size_t num_players)
+                        Sampler& sampler, size_t num_players)
       : regret_table_(),
         num_decision_histories_(0),
         regret_player_(regret_player),
-        profile_(profile),
         sampler_(sampler),
-        reach_probabilities_(num_players, 1.0) {}
+        reach_probabilities_(num_players, 1.0),
+        response_cache_(profile) {}
   virtual ~PolicyRegretEvaluator() = default;
 
   inline bool SaveRegrets(int current_player) const {
@@ -111,29 +165,40 @@ class PolicyRegretEvaluator {
   Cfv CounterfactualValue(
       DecisionPoint& decision_point, double importance_weight, int action_idx,
       const std::function<Cfv(DecisionPoint&, double)>& backup);
+  const ResponseCacheStats& ResponseStats() const {
+    return response_cache_.Stats();
+  }
 
  public:
   InfoStateUvm<CfValues> regret_table_;
   int num_decision_histories_;
 
  private:
-  double Return(DecisionPoint& decision_point) const {
+  template <class DP>
+  double Return(DP& decision_point) const {
     return decision_point.ReturnsRef()[regret_player_];
   }
   double CounterfactualReachProb() const {
     return ::hr_edl::CounterfactualReachProb(reach_probabilities_,
                                                          regret_player_);
   }
-  Cfv CounterfactualValue(
-      DecisionPoint& decision_point, double importance_weight, int action_idx,
-      double next_reach_prob,
-      const std::function<Cfv(DecisionPoint&, double)>& backup);
+  template <class DP>
+  Cfv CounterfactualRegrets(DP& decision_point, double importance_weight);
+  template <class DP>
+  Cfv ReachWeightedRegrets(DP& decision_point, double importance_weight);
+  template <class DP, class Backup>
+  Cfv ChanceOutcomesValue(DP& decision_point, double importance_weight,
+                          int action_idx, Backup&& backup);
+  template <class DP, class Backup>
+  Cfv ChanceOutcomesValue(DP& decision_point, double importance_weight,
+                          int action_idx, double next_reach_prob,
+                          Backup&& backup);
 
  private:
   const int regret_player_;
-  const Policy& profile_;
-  MccfrSampler& sampler_;
+  Sampler& sampler_;
   std::vector<double> reach_probabilities_;
+  ResponseCache response_cache_;
 };
 
 std::tuple<Cfv, InfoStateUvm<CfValues>, int> PolicyCounterfactualRegrets(
@@ -143,99 +208,357 @@ std::tuple<Cfv, InfoStateUvm<CfValues>, int> PolicyReachWeightedRegrets(
     DecisionPoint& root, int regret_player, const Policy& profile,
     MccfrSampler& sampler);
 
+template <class Sampler = MccfrSampler>
 class PolicyValueEvaluator {
  public:
-  PolicyValueEvaluator(int player, const Policy& profile, MccfrSampler& sampler,
+  PolicyValueEvaluator(int player, const Policy& profile, Sampler& sampler,
                        size_t num_players)
       : num_decision_histories_(0),
+        num_memoised_decision_histories_(0),
         player_(player),
-        profile_(profile),
-        sampler_(sampler) {}
+        sampler_(sampler),
+        response_cache_(profile),
+        depth_(0),
+        task_depth_(kNoTasks),
+        merging_(false),
+        next_task_(0),
+        tasks_(),
+        subtree_values_() {}
 
   Cfv operator()(DecisionPoint& decision_point,
                  double importance_weighted_reach_prob, int action_idx);
   Cfv operator()(DecisionPoint& decision_point,
                  double importance_weighted_reach_prob);
+  // The value of `root` with the subtrees `task_depth` decision histories
+  // below it evaluated as tasks on up to `num_threads` threads. Requires an
+  // exhaustive sampler. Tasks only run concurrently if `root` is a
+  // `CompiledDecisionPoint`.
+  Cfv InParallel(DecisionPoint& root, size_t num_threads, size_t task_depth);
+  const ResponseCacheStats& ResponseStats() const {
+    return response_cache_.Stats();
+  }
 
  public:
   int num_decision_histories_;
+  // The number of decision histories counted in `num_decision_histories_`
+  // that were not visited because their subtree's value was memoised,
+  // including those that tasks skipped.
+  int num_memoised_decision_histories_;
 
  private:
-  double Return(DecisionPoint& decision_point) const {
+  template <class DP>
+  double Return(DP& decision_point) const {
     return decision_point.ReturnsRef()[player_];
   }
+  template <class DP>
+  Cfv ChanceOutcomesValue(DP& decision_point,
+                          double importance_weighted_reach_prob,
+                          int action_idx);
+  template <class DP>
+  Cfv HistoryValue(DP& decision_point, double importance_weighted_reach_prob);
+  template <class DP>
+  Cfv DecisionHistoryValue(DP& decision_point,
+                           double importance_weighted_reach_prob);
+  Cfv MemoisedHistoryValue(CompiledDecisionPoint& decision_point,
+                           double importance_weighted_reach_prob);
+  template <class DP>
+  Cfv TaskValue(DP& decision_point, double importance_weighted_reach_prob);
+  template <class DP>
+  void RunTask(TraversalTask& task, DP& decision_point) const;
 
  private:
+  static constexpr size_t kNoTasks = std::numeric_limits<size_t>::max();
+
   const int player_;
-  const Policy& profile_;
-  MccfrSampler& sampler_;
+  Sampler& sampler_;
+  ResponseCache response_cache_;
+  // The number of decision histories above the current one.
+  size_t depth_;
+  size_t task_depth_;
+  // Whether tasks have run and their values are being combined.
+  bool merging_;
+  size_t next_task_;
+  std::vector<TraversalTask> tasks_;
+  // By history index when traversing a merged tree exhaustively, except
+  // above the task depth. Kept between traversals, so an evaluator must only
+  // traverse one tree.
+  std::vector<SubtreeValue> subtree_values_;
 };
 
+// On a merged tree with an exhaustive sampler, each subtree's value is
+// computed once and scaled by the reach probability of every path to it, so
+// the result may differ from the unmerged tree's in the last bits.
 std::pair<Cfv, int> PolicyValue(DecisionPoint& root, int player,
                                 const Policy& profile, MccfrSampler& sampler);
+// Computes the same value as `PolicyValue` with a `NullSampler` on up to
+// `num_threads` threads. The result is identical for any number of threads
+// but may differ from `PolicyValue`'s in the last bits, since the values of
+// tasks are summed separately. On a merged tree, each task memoises the values
+// of the subtrees below it, and the histories above the tasks are all
+// visited.
+std::pair<Cfv, int> PolicyValueInParallel(
+    DecisionPoint& root, int player, const Policy& profile,
+    size_t num_threads, size_t task_depth = kDefaultTaskDepth);
+
+// Computes every player's expected value in one traversal without sampling.
+//
+// Player `i`'s value is the one `PolicyValue` would compute under
+// `compatriots` with `i`'s policy replaced by `substitutes[i]` and a
+// `NullSampler`, and `num_decision_histories_[i]` counts the decision
+// histories that `PolicyValue` would visit. On a merged tree, subtree values
+// are memoised as in `PolicyValue`.
+class PolicyValuesEvaluator {
+ public:
+  PolicyValuesEvaluator(const Policy& compatriots,
+                        const std::vector<const Policy*>& substitutes)
+      : num_decision_histories_(substitutes.size(), 0),
+        num_memoised_decision_histories_(substitutes.size(), 0),
+        substitutes_(substitutes),
+        compatriot_responses_(compatriots),
+        substitute_responses_(),
+        subtree_values_() {
+    substitute_responses_.reserve(substitutes.size());
+    for (const Policy* substitute : substitutes) {
+      substitute_responses_.emplace_back(*substitute);
+    }
+  }
+
+  std::vector<Cfv> operator()(DecisionPoint& root);
+  ResponseCacheStats ResponseStats() const;
+
+ public:
+  std::vector<int> num_decision_histories_;
+  // As in `PolicyValueEvaluator`, for each player.
+  std::vector<int> num_memoised_decision_histories_;
+
+ private:
+  // Each player's arguments are only read if the player is active, i.e., if
+  // its own traversal would reach the current history.
+  template <class DP>
+  void Values(DP& decision_point, const double* importance_weighted_reach_probs,
+              const bool* active, int action_idx, double* values);
+  template <class DP>
+  void StateValues(DP& decision_point,
+                   const double* importance_weighted_reach_probs,
+                   const bool* active, double* state_values);
+  void MemoisedStateValues(CompiledDecisionPoint& decision_point,
+                           const double* importance_weighted_reach_probs,
+                           const bool* active, double* state_values);
+
+ private:
+  const std::vector<const Policy*>& substitutes_;
+  ResponseCache compatriot_responses_;
+  PlayerMap<ResponseCache> substitute_responses_;
+  // By history index and then player when traversing a merged tree.
+  std::vector<SubtreeValue> subtree_values_;
+};
+
+std::pair<std::vector<Cfv>, std::vector<int>> PolicyValues(
+    DecisionPoint& root, const Policy& compatriots,
+    const std::vector<const Policy*>& substitutes);
 
 struct CfValueTreeEvaluation {
   const Cfv ev_;
-  const std::vector<std::string> initial_info_states_;
-  const InfoStateUvm<CfValueTreeNode>* cfv_nodes_;
+  const CfValueTree* cf_value_tree_;
   const size_t num_histories_;
 };
 
+// Evaluates a profile's counterfactual value tree for `regret_player`.
+//
+// The tree's topology is kept between evaluations. If an evaluation visits
+// the same info sets in the same order as the previous one, as it does under
+// a `NullSampler` unless the profile newly prunes or unprunes a subtree, the
+// tree's nodes and links are reused and only its values are rewritten.
 class PolicyCfValueTreeEvaluator {
  public:
   PolicyCfValueTreeEvaluator(int regret_player)
       : cf_value_tree_(),
         num_decision_histories_(0),
-        regret_player_(regret_player) {}
+        regret_player_(regret_player),
+        info_set_id_space_(0),
+        traversal_(0),
+        node_keys_(),
+        node_values_(),
+        node_info_set_ids_(),
+        node_traversals_(),
+        node_by_id_(),
+        visits_(),
+        previous_visits_(),
+        tree_index_by_slot_(),
+        response_cache_(),
+        depth_(0),
+        task_depth_(kNoTasks),
+        merging_(false),
+        next_task_(0),
+        tasks_(),
+        task_evaluators_(),
+        task_slots_() {}
+  PolicyCfValueTreeEvaluator(const PolicyCfValueTreeEvaluator&) = default;
+  PolicyCfValueTreeEvaluator(PolicyCfValueTreeEvaluator&&) = default;
   virtual ~PolicyCfValueTreeEvaluator() = default;
 
   bool SaveRegrets(int current_player) const {
     return current_player == regret_player_;
   }
 
+  // Forgets the tree's topology.
   void Reset() {
-    cf_value_tree_.clear();
+    cf_value_tree_.Clear();
     num_decision_histories_ = 0;
+    node_keys_.clear();
+    node_values_.clear();
+    node_info_set_ids_.clear();
+    node_traversals_.clear();
+    node_by_id_.clear();
+    visits_.clear();
+    previous_visits_.clear();
+    tree_index_by_slot_.clear();
+    tasks_.clear();
+    task_evaluators_.clear();
   }
 
+  // Traverses with the instantiations for `root`'s and `sampler`'s concrete
+  // types if there are any.
   CfValueTreeEvaluation ComputeCfValueTreeEvaluation(DecisionPoint& root,
                                                      const Policy& profile,
-                                                     MccfrSampler& sampler) {
-    Reset();
-    std::vector<std::string> initial_keys;
-    const Cfv root_val =
-        CounterfactualValue(initial_keys, root, profile, sampler, 1.0);
-    return {root_val, std::move(initial_keys), &cf_value_tree_,
-            num_decision_histories_};
-  }
-  Cfv CounterfactualValue(std::vector<std::string>& siblings,
-                          DecisionPoint& decision_point, const Policy& profile,
-                          MccfrSampler& sampler,
-                          double importance_weighted_reach_prob) {
-    return CounterfactualValue(siblings, decision_point, profile, sampler,
-                               importance_weighted_reach_prob, 0);
+                                                     MccfrSampler& sampler);
+  // Traverses without sampling, evaluating the subtrees `task_depth`
+  // decision histories below `root` as tasks on up to `num_threads` threads.
+  // Each task accumulates into its own evaluator, and tasks are merged in
+  // the order that a serial traversal would reach them, so the tree,
+  // including its topology, is identical for any number of threads. Values
+  // may differ from a serial evaluation's in the last bits. Tasks only run
+  // concurrently if `root` is a `CompiledDecisionPoint`.
+  CfValueTreeEvaluation ComputeCfValueTreeEvaluationInParallel(
+      DecisionPoint& root, const Policy& profile, size_t num_threads,
+      size_t task_depth = kDefaultTaskDepth);
+  const ResponseCacheStats& ResponseStats() const {
+    return response_cache_.Stats();
   }
 
  public:
-  InfoStateUvm<CfValueTreeNode> cf_value_tree_;
+  CfValueTree cf_value_tree_;
   size_t num_decision_histories_;
 
  private:
-  double Return(DecisionPoint& decision_point) const {
+  static constexpr size_t kNoNode = std::numeric_limits<size_t>::max();
+  static constexpr size_t kNoTasks = std::numeric_limits<size_t>::max();
+
+  // The node and action that a node was first reached below during a
+  // traversal. Nodes that were reached before any other have no parent.
+  struct Parent {
+    size_t slot_ = kNoNode;
+    size_t action_ = 0;
+  };
+  struct Visit {
+    size_t slot_;
+    Parent parent_;
+    bool operator==(const Visit& other) const {
+      return slot_ == other.slot_ && parent_.slot_ == other.parent_.slot_ &&
+             parent_.action_ == other.parent_.action_;
+    }
+  };
+
+  template <class DP>
+  double Return(DP& decision_point) const {
     return decision_point.ReturnsRef()[regret_player_];
   }
-  Cfv CounterfactualValue(std::vector<std::string>& siblings,
-                          DecisionPoint& decision_point, const Policy& profile,
-                          MccfrSampler& sampler,
+  void BeginTraversal(const Policy& profile, size_t info_set_id_space);
+  CfValueTreeEvaluation FinishTraversal(Cfv ev);
+  void RebuildTree();
+  template <class DP, class Sampler>
+  Cfv CounterfactualValue(Parent parent, DP& decision_point, Sampler& sampler,
                           double importance_weighted_reach_prob,
                           int action_idx);
-  Cfv ComputeCfValueTree(std::vector<std::string>& siblings,
-                         DecisionPoint& decision_point, const Policy& profile,
-                         MccfrSampler& sampler,
+  template <class DP, class Sampler>
+  Cfv ComputeCfValueTree(Parent parent, DP& decision_point, Sampler& sampler,
                          double importance_weighted_reach_prob);
+  template <class DP>
+  size_t NodeSlot(Parent parent, const DP& decision_point);
+  size_t NodeSlot(Parent parent, size_t info_set_id,
+                  const std::string& info_state, size_t num_actions);
+  template <class DP>
+  Cfv TaskValue(Parent parent, DP& decision_point,
+                double importance_weighted_reach_prob);
+  template <class DP>
+  void RunTask(size_t task_idx, DP& decision_point);
+  Cfv MergeTask(Parent parent);
+
+  friend class FusedCfValueTreeEvaluator;
 
  private:
   const int regret_player_;
+  // The ID space of the trees that the nodes were found in.
+  size_t info_set_id_space_;
+  size_t traversal_;
+  // Nodes are indexed by slot and looked up by the regret player's info set
+  // ID, and persist across traversals of trees with the same ID space.
+  std::vector<std::string> node_keys_;
+  std::vector<CfValues> node_values_;
+  std::vector<size_t> node_info_set_ids_;
+  // The last traversal that visited each node.
+  std::vector<size_t> node_traversals_;
+  std::vector<size_t> node_by_id_;
+  // Nodes in the order that the current and previous traversals first
+  // visited them, which determines the tree's topology. The previous
+  // traversal's `i`th visit is node `i` of `cf_value_tree_`.
+  std::vector<Visit> visits_;
+  std::vector<Visit> previous_visits_;
+  std::vector<size_t> tree_index_by_slot_;
+  // The profile's responses during the current traversal.
+  ResponseCache response_cache_;
+  // The number of decision histories above the current one.
+  size_t depth_;
+  size_t task_depth_;
+  // Whether tasks have run and are being merged into this evaluator.
+  bool merging_;
+  size_t next_task_;
+  std::vector<TraversalTask> tasks_;
+  // Kept between evaluations so that a task's storage is reused.
+  std::vector<PolicyCfValueTreeEvaluator> task_evaluators_;
+  // The slot that each of a task's slots is merged into.
+  std::vector<size_t> task_slots_;
+};
+// Computes every player's counterfactual value tree in one traversal.
+//
+// Player `i`'s tree is left in `evaluators[i]` exactly as
+// `evaluators[i].ComputeCfValueTreeEvaluation` would compute it under
+// `compatriots` with `i`'s policy replaced by `substitutes[i]` and a
+// `NullSampler`. Each history is visited once for all players and each
+// policy responds once per history instead of once per player.
+class FusedCfValueTreeEvaluator {
+ public:
+  FusedCfValueTreeEvaluator(
+      std::vector<PolicyCfValueTreeEvaluator>& evaluators,
+      const Policy& compatriots, const std::vector<const Policy*>& substitutes)
+      : evaluators_(evaluators),
+        substitutes_(substitutes),
+        compatriot_responses_(compatriots) {}
+
+  std::vector<CfValueTreeEvaluation> ComputeCfValueTreeEvaluations(
+      DecisionPoint& root);
+  // Substitutes' responses are cached by their players' evaluators, so
+  // these include the evaluators' earlier traversals.
+  ResponseCacheStats ResponseStats() const;
+
+ private:
+  // Each player's arguments are only read if the player is active, i.e., if
+  // its own traversal would reach the current history.
+  template <class DP>
+  void CounterfactualValues(
+      DP& decision_point, const double* importance_weighted_reach_probs,
+      const bool* active, const PolicyCfValueTreeEvaluator::Parent* parents,
+      int action_idx, double* values);
+  template <class DP>
+  void ComputeCfValueTrees(
+      DP& decision_point, const double* importance_weighted_reach_probs,
+      const bool* active, const PolicyCfValueTreeEvaluator::Parent* parents,
+      double* state_values);
+
+ private:
+  std::vector<PolicyCfValueTreeEvaluator>& evaluators_;
+  const std::vector<const Policy*>& substitutes_;
+  ResponseCache compatriot_responses_;
 };
 }  // namespace hr_edl
 
@@ -21,7 +21,7 @@ void AlwaysFoldInLeduc() {
     const auto [v2, regrets, num_decision_histories2] =
         PolicyCounterfactualRegrets(decision_point, 0, policy, full_walk);
     PolicyCfValueTreeEvaluator evaluator(0);
-    const auto [v3, initial_info_states, cf_value_tree_ptr,
+    const auto [v3, cf_value_tree_ptr,
                 num_decision_histories3] =
         evaluator.ComputeCfValueTreeEvaluation(decision_point, policy,
                                                full_walk);
@@ -33,43 +33,44 @@ void AlwaysFoldInLeduc() {
     SPIEL_CHECK_EQ(num_decision_histories1, num_decision_histories2);
     SPIEL_CHECK_EQ(num_decision_histories1, num_decision_histories3);
     SPIEL_CHECK_EQ(regrets_and_reach_probs.first.size(), regrets.size());
-    SPIEL_CHECK_EQ(cf_value_tree_ptr->size(), regrets.size());
+    SPIEL_CHECK_EQ(cf_value_tree_ptr->Size(), regrets.size());
     for (const auto& [iss, regrets2] : regrets_and_reach_probs.first) {
       SPIEL_CHECK_FLOAT_EQ(regrets2.ev_, regrets.at(iss).ev_);
       SPIEL_CHECK_FLOAT_EQ(regrets2.ev_,
-                           cf_value_tree_ptr->at(iss).cf_values_.ev_);
+                           cf_value_tree_ptr->At(iss).cf_values_.ev_);
       SPIEL_CHECK_EQ(regrets2.Size(), regrets.at(iss).Size());
       SPIEL_CHECK_EQ(regrets2.Size(),
-                     cf_value_tree_ptr->at(iss).cf_values_.Size());
+                     cf_value_tree_ptr->At(iss).cf_values_.Size());
       for (size_t i = 0; i < regrets2.Size(); ++i) {
         SPIEL_CHECK_FLOAT_EQ(regrets2[i], regrets.at(iss)[i]);
         SPIEL_CHECK_FLOAT_EQ(regrets2[i],
-                             cf_value_tree_ptr->at(iss).cf_values_[i]);
+                             cf_value_tree_ptr->At(iss).cf_values_[i]);
       }
     }
     // Check that cf_value_tree is actually a complete tree.
-    SPIEL_CHECK_GT(initial_info_states.size(), 0);
+    SPIEL_CHECK_GT(cf_value_tree_ptr->roots_.size(), 0);
     {
       size_t num_info_states = 0;
-      std::vector<std::string> state_stack = initial_info_states;
-      state_stack.reserve(cf_value_tree_ptr->size());
-      while (state_stack.size() > 0) {
-        const std::string iss = state_stack.back();
-        state_stack.pop_back();
+      std::vector<size_t> node_stack = cf_value_tree_ptr->roots_;
+      node_stack.reserve(cf_value_tree_ptr->Size());
+      while (node_stack.size() > 0) {
+        const size_t node_idx = node_stack.back();
+        node_stack.pop_back();
         ++num_info_states;
 
-        const auto& _ = cf_value_tree_ptr->at(iss);
+        const auto& _ = cf_value_tree_ptr->nodes_[node_idx];
         const auto& cf_values = _.cf_values_;
-        const auto& child_keys = _.child_keys_;
-        const auto& x_cf_values = regrets.at(iss);
+        const auto& children = _.children_;
+        const auto& x_cf_values =
+            regrets.at(cf_value_tree_ptr->keys_[node_idx]);
 
         SPIEL_CHECK_FLOAT_EQ(x_cf_values.ev_, cf_values.ev_);
         SPIEL_CHECK_EQ(x_cf_values.v_.size(), cf_values.v_.size());
         for (size_t i = 0; i < x_cf_values.v_.size(); ++i) {
           SPIEL_CHECK_FLOAT_EQ(x_cf_values.v_[i], cf_values.v_[i]);
 
-          for (const auto& k : child_keys[i]) {
-            state_stack.push_back(k);
+          for (const size_t child : children[i]) {
+            node_stack.push_back(child);
           }
         }
       }
@@ -93,7 +94,7 @@ void AlwaysFoldInLeduc() {
     const auto [v2, regrets, num_decision_histories2] =
         PolicyCounterfactualRegrets(decision_point, 1, policy, full_walk);
     PolicyCfValueTreeEvaluator evaluator(1);
-    const auto [v3, initial_info_states, cf_value_tree_ptr,
+    const auto [v3, cf_value_tree_ptr,
                 num_decision_histories3] =
         evaluator.ComputeCfValueTreeEvaluation(decision_point, policy,
                                                full_walk);
@@ -105,43 +106,44 @@ void AlwaysFoldInLeduc() {
     SPIEL_CHECK_EQ(num_decision_histories1, num_decision_histories2);
     SPIEL_CHECK_EQ(num_decision_histories1, num_decision_histories3);
     SPIEL_CHECK_EQ(regrets_and_reach_probs.first.size(), regrets.size());
-    SPIEL_CHECK_EQ(cf_value_tree_ptr->size(), regrets.size());
+    SPIEL_CHECK_EQ(cf_value_tree_ptr->Size(), regrets.size());
     for (const auto& [iss, regrets2] : regrets_and_reach_probs.first) {
       SPIEL_CHECK_FLOAT_EQ(regrets2.ev_, regrets.at(iss).ev_);
       SPIEL_CHECK_FLOAT_EQ(regrets2.ev_,
-                           cf_value_tree_ptr->at(iss).cf_values_.ev_);
+                           cf_value_tree_ptr->At(iss).cf_values_.ev_);
       SPIEL_CHECK_EQ(regrets2.Size(), regrets.at(iss).Size());
       SPIEL_CHECK_EQ(regrets2.Size(),
-                     cf_value_tree_ptr->at(iss).cf_values_.Size());
+                     cf_value_tree_ptr->At(iss).cf_values_.Size());
       for (size_t i = 0; i < regrets2.Size(); ++i) {
         SPIEL_CHECK_FLOAT_EQ(regrets2[i], regrets.at(iss)[i]);
         SPIEL_CHECK_FLOAT_EQ(regrets2[i],
-                             cf_value_tree_ptr->at(iss).cf_values_[i]);
+                             cf_value_tree_ptr->At(iss).cf_values_[i]);
       }
     }
     // Check that cf_value_tree is actually a complete tree.
-    SPIEL_CHECK_GT(initial_info_states.size(), 0);
+    SPIEL_CHECK_GT(cf_value_tree_ptr->roots_.size(), 0);
     {
       size_t num_info_states = 0;
-      std::vector<std::string> state_stack = initial_info_states;
-      state_stack.reserve(cf_value_tree_ptr->size());
-      while (state_stack.size() > 0) {
-        const std::string iss = state_stack.back();
-        state_stack.pop_back();
+      std::vector<size_t> node_stack = cf_value_tree_ptr->roots_;
+      node_stack.reserve(cf_value_tree_ptr->Size());
+      while (node_stack.size() > 0) {
+        const size_t node_idx = node_stack.back();
+        node_stack.pop_back();
         ++num_info_states;
 
-        const auto& _ = cf_value_tree_ptr->at(iss);
+        const auto& _ = cf_value_tree_ptr->nodes_[node_idx];
         const auto& cf_values = _.cf_values_;
-        const auto& child_keys = _.child_keys_;
-        const auto& x_cf_values = regrets.at(iss);
+        const auto& children = _.children_;
+        const auto& x_cf_values =
+            regrets.at(cf_value_tree_ptr->keys_[node_idx]);
 
         SPIEL_CHECK_FLOAT_EQ(x_cf_values.ev_, cf_values.ev_);
         SPIEL_CHECK_EQ(x_cf_values.v_.size(), cf_values.v_.size());
         for (size_t i = 0; i < x_cf_values.v_.size(); ++i) {
           SPIEL_CHECK_FLOAT_EQ(x_cf_values.v_[i], cf_values.v_[i]);
 
-          for (const auto& k : child_keys[i]) {
-            state_stack.push_back(k);
+          for (const size_t child : children[i]) {
+            node_stack.push_back(child);
           }
         }
       }
@@ -174,7 +176,7 @@ void AlwaysRaiseInLeduc() {
     const auto [v2, regrets, num_decision_histories2] =
         PolicyCounterfactualRegrets(decision_point, 0, policy, full_walk);
     PolicyCfValueTreeEvaluator evaluator(0);
-    const auto [v3, initial_info_states, cf_value_tree_ptr,
+    const auto [v3, cf_value_tree_ptr,
                 num_decision_histories3] =
         evaluator.ComputeCfValueTreeEvaluation(decision_point, policy,
                                                full_walk);
@@ -186,43 +188,44 @@ void AlwaysRaiseInLeduc() {
     SPIEL_CHECK_EQ(num_decision_histories1, num_decision_histories2);
     SPIEL_CHECK_EQ(num_decision_histories1, num_decision_histories3);
     SPIEL_CHECK_EQ(regrets_and_reach_probs.first.size(), regrets.size());
-    SPIEL_CHECK_EQ(cf_value_tree_ptr->size(), regrets.size());
+    SPIEL_CHECK_EQ(cf_value_tree_ptr->Size(), regrets.size());
     for (const auto& [iss, regrets2] : regrets_and_reach_probs.first) {
       SPIEL_CHECK_FLOAT_EQ(regrets2.ev_, regrets.at(iss).ev_);
       SPIEL_CHECK_FLOAT_EQ(regrets2.ev_,
-                           cf_value_tree_ptr->at(iss).cf_values_.ev_);
+                           cf_value_tree_ptr->At(iss).cf_values_.ev_);
       SPIEL_CHECK_EQ(regrets2.Size(), regrets.at(iss).Size());
       SPIEL_CHECK_EQ(regrets2.Size(),
-                     cf_value_tree_ptr->at(iss).cf_values_.Size());
+                     cf_value_tree_ptr->At(iss).cf_values_.Size());
       for (size_t i = 0; i < regrets2.Size(); ++i) {
         SPIEL_CHECK_FLOAT_EQ(regrets2[i], regrets.at(iss)[i]);
         SPIEL_CHECK_FLOAT_EQ(regrets2[i],
-                             cf_value_tree_ptr->at(iss).cf_values_[i]);
+                             cf_value_tree_ptr->At(iss).cf_values_[i]);
       }
     }
     // Check that cf_value_tree is actually a complete tree.
-    SPIEL_CHECK_GT(initial_info_states.size(), 0);
+    SPIEL_CHECK_GT(cf_value_tree_ptr->roots_.size(), 0);
     {
       size_t num_info_states = 0;
-      std::vector<std::string> state_stack = initial_info_states;
-      state_stack.reserve(cf_value_tree_ptr->size());
-      while (state_stack.size() > 0) {
-        const std::string iss = state_stack.back();
-        state_stack.pop_back();
+      std::vector<size_t> node_stack = cf_value_tree_ptr->roots_;
+      node_stack.reserve(cf_value_tree_ptr->Size());
+      while (node_stack.size() > 0) {
+        const size_t node_idx = node_stack.back();
+        node_stack.pop_back();
         ++num_info_states;
 
-        const auto& _ = cf_value_tree_ptr->at(iss);
+        const auto& _ = cf_value_tree_ptr->nodes_[node_idx];
         const auto& cf_values = _.cf_values_;
-        const auto& child_keys = _.child_keys_;
-        const auto& x_cf_values = regrets.at(iss);
+        const auto& children = _.children_;
+        const auto& x_cf_values =
+            regrets.at(cf_value_tree_ptr->keys_[node_idx]);
 
         SPIEL_CHECK_FLOAT_EQ(x_cf_values.ev_, cf_values.ev_);
         SPIEL_CHECK_EQ(x_cf_values.v_.size(), cf_values.v_.size());
         for (size_t i = 0; i < x_cf_values.v_.size(); ++i) {
           SPIEL_CHECK_FLOAT_EQ(x_cf_values.v_[i], cf_values.v_[i]);
 
-          for (const auto& k : child_keys[i]) {
-            state_stack.push_back(k);
+          for (const size_t child : children[i]) {
+            node_stack.push_back(child);
           }
         }
       }
@@ -246,7 +249,7 @@ void AlwaysRaiseInLeduc() {
     const auto [v2, regrets, num_decision_histories2] =
         PolicyCounterfactualRegrets(decision_point, 1, policy, full_walk);
     PolicyCfValueTreeEvaluator evaluator(1);
-    const auto [v3, initial_info_states, cf_value_tree_ptr,
+    const auto [v3, cf_value_tree_ptr,
                 num_decision_histories3] =
         evaluator.ComputeCfValueTreeEvaluation(decision_point, policy,
                                                full_walk);
@@ -258,43 +261,44 @@ void AlwaysRaiseInLeduc() {
     SPIEL_CHECK_EQ(num_decision_histories1, num_decision_histories2);
     SPIEL_CHECK_EQ(num_decision_histories1, num_decision_histories3);
     SPIEL_CHECK_EQ(regrets_and_reach_probs.first.size(), regrets.size());
-    SPIEL_CHECK_EQ(cf_value_tree_ptr->size(), regrets.size());
+    SPIEL_CHECK_EQ(cf_value_tree_ptr->Size(), regrets.size());
     for (const auto& [iss, regrets2] : regrets_and_reach_probs.first) {
       SPIEL_CHECK_FLOAT_EQ(regrets2.ev_, regrets.at(iss).ev_);
       SPIEL_CHECK_FLOAT_EQ(regrets2.ev_,
-                           cf_value_tree_ptr->at(iss).cf_values_.ev_);
+                           cf_value_tree_ptr->At(iss).cf_values_.ev_);
       SPIEL_CHECK_EQ(regrets2.Size(), regrets.at(iss).Size());
       SPIEL_CHECK_EQ(regrets2.Size(),
-                     cf_value_tree_ptr->at(iss).cf_values_.Size());
+                     cf_value_tree_ptr->At(iss).cf_values_.Size());
       for (size_t i = 0; i < regrets2.Size(); ++i) {
         SPIEL_CHECK_FLOAT_EQ(regrets2[i], regrets.at(iss)[i]);
         SPIEL_CHECK_FLOAT_EQ(regrets2[i],
-                             cf_value_tree_ptr->at(iss).cf_values_[i]);
+                             cf_value_tree_ptr->At(iss).cf_values_[i]);
       }
     }
     // Check that cf_value_tree is actually a complete tree.
-    SPIEL_CHECK_GT(initial_info_states.size(), 0);
+    SPIEL_CHECK_GT(cf_value_tree_ptr->roots_.size(), 0);
     {
       size_t num_info_states = 0;
-      std::vector<std::string> state_stack = initial_info_states;
-      state_stack.reserve(cf_value_tree_ptr->size());
-      while (state_stack.size() > 0) {
-        const std::string iss = state_stack.back();
-        state_stack.pop_back();
+      std::vector<size_t> node_stack = cf_value_tree_ptr->roots_;
+      node_stack.reserve(cf_value_tree_ptr->Size());
+      while (node_stack.size() > 0) {
+        const size_t node_idx = node_stack.back();
+        node_stack.pop_back();
         ++num_info_states;
 
-        const auto& _ = cf_value_tree_ptr->at(iss);
+        const auto& _ = cf_value_tree_ptr->nodes_[node_idx];
         const auto& cf_values = _.cf_values_;
-        const auto& child_keys = _.child_keys_;
-        const auto& x_cf_values = regrets.at(iss);
+        const auto& children = _.children_;
+        const auto& x_cf_values =
+            regrets.at(cf_value_tree_ptr->keys_[node_idx]);
 
         SPIEL_CHECK_FLOAT_EQ(x_cf_values.ev_, cf_values.ev_);
         SPIEL_CHECK_EQ(x_cf_values.v_.size(), cf_values.v_.size());
         for (size_t i = 0; i < x_cf_values.v_.size(); ++i) {
           SPIEL_CHECK_FLOAT_EQ(x_cf_values.v_[i], cf_values.v_[i]);
 
-          for (const auto& k : child_keys[i]) {
-            state_stack.push_back(k);
+          for (const size_t child : children[i]) {
+            node_stack.push_back(child);
           }
         }
       }
@@ -327,7 +331,7 @@ void UniformRandomInLeduc() {
     const auto [v2, regrets, num_decision_histories2] =
         PolicyCounterfactualRegrets(decision_point, 0, policy, full_walk);
     PolicyCfValueTreeEvaluator evaluator(0);
-    const auto [v3, initial_info_states, cf_value_tree_ptr,
+    const auto [v3, cf_value_tree_ptr,
                 num_decision_histories3] =
         evaluator.ComputeCfValueTreeEvaluation(decision_point, policy,
                                                full_walk);
@@ -339,43 +343,44 @@ void UniformRandomInLeduc() {
     SPIEL_CHECK_EQ(num_decision_histories1, num_decision_histories2);
     SPIEL_CHECK_EQ(num_decision_histories1, num_decision_histories3);
     SPIEL_CHECK_EQ(regrets_and_reach_probs.first.size(), regrets.size());
-    SPIEL_CHECK_EQ(cf_value_tree_ptr->size(), regrets.size());
+    SPIEL_CHECK_EQ(cf_value_tree_ptr->Size(), regrets.size());
     for (const auto& [iss, regrets2] : regrets_and_reach_probs.first) {
       SPIEL_CHECK_FLOAT_EQ(regrets2.ev_, regrets.at(iss).ev_);
       SPIEL_CHECK_FLOAT_EQ(regrets2.ev_,
-                           cf_value_tree_ptr->at(iss).cf_values_.ev_);
+                           cf_value_tree_ptr->At(iss).cf_values_.ev_);
       SPIEL_CHECK_EQ(regrets2.Size(), regrets.at(iss).Size());
       SPIEL_CHECK_EQ(regrets2.Size(),
-                     cf_value_tree_ptr->at(iss).cf_values_.Size());
+                     cf_value_tree_ptr->At(iss).cf_values_.Size());
       for (size_t i = 0; i < regrets2.Size(); ++i) {
         SPIEL_CHECK_FLOAT_EQ(regrets2[i], regrets.at(iss)[i]);
         SPIEL_CHECK_FLOAT_EQ(regrets2[i],
-                             cf_value_tree_ptr->at(iss).cf_values_[i]);
+                             cf_value_tree_ptr->At(iss).cf_values_[i]);
       }
     }
     // Check that cf_value_tree is actually a complete tree.
-    SPIEL_CHECK_GT(initial_info_states.size(), 0);
+    SPIEL_CHECK_GT(cf_value_tree_ptr->roots_.size(), 0);
     {
       size_t num_info_states = 0;
-      std::vector<std::string> state_stack = initial_info_states;
-      state_stack.reserve(cf_value_tree_ptr->size());
-      while (state_stack.size() > 0) {
-        const std::string iss = state_stack.back();
-        state_stack.pop_back();
+      std::vector<size_t> node_stack = cf_value_tree_ptr->roots_;
+      node_stack.reserve(cf_value_tree_ptr->Size());
+      while (node_stack.size() > 0) {
+        const size_t node_idx = node_stack.back();
+        node_stack.pop_back();
         ++num_info_states;
 
-        const auto& _ = cf_value_tree_ptr->at(iss);
+        const auto& _ = cf_value_tree_ptr->nodes_[node_idx];
         const auto& cf_values = _.cf_values_;
-        const auto& child_keys = _.child_keys_;
-        const auto& x_cf_values = regrets.at(iss);
+        const auto& children = _.children_;
+        const auto& x_cf_values =
+            regrets.at(cf_value_tree_ptr->keys_[node_idx]);
 
         SPIEL_CHECK_FLOAT_EQ(x_cf_values.ev_, cf_values.ev_);
         SPIEL_CHECK_EQ(x_cf_values.v_.size(), cf_values.v_.size());
         for (size_t i = 0; i < x_cf_values.v_.size(); ++i) {
           SPIEL_CHECK_FLOAT_EQ(x_cf_values.v_[i], cf_values.v_[i]);
 
-          for (const auto& k : child_keys[i]) {
-            state_stack.push_back(k);
+          for (const size_t child : children[i]) {
+            node_stack.push_back(child);
           }
         }
       }
@@ -399,7 +404,7 @@ void UniformRandomInLeduc() {
     const auto [v2, regrets, num_decision_histories2] =
         PolicyCounterfactualRegrets(decision_point, 1, policy, full_walk);
     PolicyCfValueTreeEvaluator evaluator(1);
-    const auto [v3, initial_info_states, cf_value_tree_ptr,
+    const auto [v3, cf_value_tree_ptr,
                 num_decision_histories3] =
         evaluator.ComputeCfValueTreeEvaluation(decision_point, policy,
                                                full_walk);
@@ -411,43 +416,44 @@ void UniformRandomInLeduc() {
     SPIEL_CHECK_EQ(num_decision_histories1, num_decision_histories2);
     SPIEL_CHECK_EQ(num_decision_histories1, num_decision_histories3);
     SPIEL_CHECK_EQ(regrets_and_reach_probs.first.size(), regrets.size());
-    SPIEL_CHECK_EQ(cf_value_tree_ptr->size(), regrets.size());
+    SPIEL_CHECK_EQ(cf_value_tree_ptr->Size(), regrets.size());
     for (const auto& [iss, regrets2] : regrets_and_reach_probs.first) {
       SPIEL_CHECK_FLOAT_EQ(regrets2.ev_, regrets.at(iss).ev_);
       SPIEL_CHECK_FLOAT_EQ(regrets2.ev_,
-                           cf_value_tree_ptr->at(iss).cf_values_.ev_);
+                           cf_value_tree_ptr->At(iss).cf_values_.ev_);
       SPIEL_CHECK_EQ(regrets2.Size(), regrets.at(iss).Size());
       SPIEL_CHECK_EQ(regrets2.Size(),
-                     cf_value_tree_ptr->at(iss).cf_values_.Size());
+                     cf_value_tree_ptr->At(iss).cf_values_.Size());
       for (size_t i = 0; i < regrets2.Size(); ++i) {
         SPIEL_CHECK_FLOAT_EQ(regrets2[i], regrets.at(iss)[i]);
         SPIEL_CHECK_FLOAT_EQ(regrets2[i],
-                             cf_value_tree_ptr->at(iss).cf_values_[i]);
+                             cf_value_tree_ptr->At(iss).cf_values_[i]);
       }
     }
     // Check that cf_value_tree is actually a complete tree.
-    SPIEL_CHECK_GT(initial_info_states.size(), 0);
+    SPIEL_CHECK_GT(cf_value_tree_ptr->roots_.size(), 0);
     {
       size_t num_info_states = 0;
-      std::vector<std::string> state_stack = initial_info_states;
-      state_stack.reserve(cf_value_tree_ptr->size());
-      while (state_stack.size() > 0) {
-        const std::string iss = state_stack.back();
-        state_stack.pop_back();
+      std::vector<size_t> node_stack = cf_value_tree_ptr->roots_;
+      node_stack.reserve(cf_value_tree_ptr->Size());
+      while (node_stack.size() > 0) {
+        const size_t node_idx = node_stack.back();
+        node_stack.pop_back();
         ++num_info_states;
 
-        const auto& _ = cf_value_tree_ptr->at(iss);
+        const auto& _ = cf_value_tree_ptr->nodes_[node_idx];
         const auto& cf_values = _.cf_values_;
-        const auto& child_keys = _.child_keys_;
-        const auto& x_cf_values = regrets.at(iss);
+        const auto& children = _.children_;
+        const auto& x_cf_values =
+            regrets.at(cf_value_tree_ptr->keys_[node_idx]);
 
         SPIEL_CHECK_FLOAT_EQ(x_cf_values.ev_, cf_values.ev_);
         SPIEL_CHECK_EQ(x_cf_values.v_.size(), cf_values.v_.size());
         for (size_t i = 0; i < x_cf_values.v_.size(); ++i) {
           SPIEL_CHECK_FLOAT_EQ(x_cf_values.v_[i], cf_values.v_[i]);
 
-          for (const auto& k : child_keys[i]) {
-            state_stack.push_back(k);
+          for (const size_t child : children[i]) {
+            node_stack.push_back(child);
           }
         }
       }
@@ -466,6 +472,442 @@ void UniformRandomInLeduc() {
     }
   }
 }
+
+void StateFreeTreeInLeduc() {
+  std::shared_ptr<const open_spiel::Game> game =
+      open_spiel::LoadGame("leduc_poker");
+  CachedDecisionPoint cached(game->NewInitialState());
+  CompiledDecisionPoint state_free(game->NewInitialState(), false, true,
+                                   false);
+  SPIEL_CHECK_FALSE(state_free.StatesAreSaved());
+  SPIEL_CHECK_FALSE(state_free.TerminalsAreSaved());
+  SPIEL_CHECK_TRUE(state_free.OpenSpielStatePtr() == nullptr);
+  NullSampler full_walk;
+
+  const MapPolicy policy(AlwaysMaxActionPolicy(), cached);
+  for (int player = 0; player < 2; ++player) {
+    const auto [v1, num_decision_histories1] =
+        PolicyValue(cached, player, policy, full_walk);
+    const auto [v2, num_decision_histories2] =
+        PolicyValue(state_free, player, policy, full_walk);
+    SPIEL_CHECK_FLOAT_EQ(v2, v1);
+    SPIEL_CHECK_EQ(num_decision_histories2, num_decision_histories1);
+
+    PolicyCfValueTreeEvaluator evaluator(player);
+    const auto [v3, cf_value_tree_ptr,
+                num_decision_histories3] =
+        evaluator.ComputeCfValueTreeEvaluation(state_free, policy, full_walk);
+    SPIEL_CHECK_FLOAT_EQ(v3, v1);
+  }
+}
+
+void ResponsePolicyAdapterOnStateFreeTree() {
+  std::shared_ptr<const open_spiel::Game> game =
+      open_spiel::LoadGame("leduc_poker");
+  CachedDecisionPoint cached(game->NewInitialState());
+  CompiledDecisionPoint state_free(game->NewInitialState(), false, true,
+                                   false);
+  NullSampler full_walk;
+
+  const ResponsePolicyAdapter policy(
+      std::make_unique<open_spiel::TabularPolicy>(
+          open_spiel::GetUniformPolicy(*game)));
+  const MapPolicy uniform = UniformRandomPolicy();
+  for (int player = 0; player < 2; ++player) {
+    const auto [v1, num_decision_histories1] =
+        PolicyValue(cached, player, uniform, full_walk);
+    const auto [v2, num_decision_histories2] =
+        PolicyValue(state_free, player, policy, full_walk);
+    SPIEL_CHECK_FLOAT_EQ(v2, v1);
+    SPIEL_CHECK_EQ(num_decision_histories2, num_decision_histories1);
+  }
+
+  // `open_spiel::UniformPolicy` only responds to states, so it must be given
+  // them wherever they are saved.
+  CompiledDecisionPoint state_saving(game->NewInitialState());
+  SPIEL_CHECK_TRUE(state_saving.StatesAreSaved());
+  const ResponsePolicyAdapter state_only_policy(
+      std::make_unique<open_spiel::UniformPolicy>());
+  for (int player = 0; player < 2; ++player) {
+    const auto [v1, num_decision_histories1] =
+        PolicyValue(cached, player, uniform, full_walk);
+    for (DecisionPoint* root : {static_cast<DecisionPoint*>(&cached),
+                                static_cast<DecisionPoint*>(&state_saving)}) {
+      const auto [v2, num_decision_histories2] =
+          PolicyValue(*root, player, state_only_policy, full_walk);
+      SPIEL_CHECK_FLOAT_EQ(v2, v1);
+      SPIEL_CHECK_EQ(num_decision_histories2, num_decision_histories1);
+    }
+  }
+}
+
+void FusedCfValueTreesMatchPerPlayer() {
+  std::shared_ptr<const open_spiel::Game> game =
+      open_spiel::LoadGame("leduc_poker");
+  CachedDecisionPoint root(game->NewInitialState());
+  NullSampler full_walk;
+
+  // Deterministic compatriots prune the fused traversal differently for
+  // each player.
+  const MapPolicy compatriot(AlwaysMaxActionPolicy(), root);
+  const PolicyRefProfile compatriots({&compatriot, &compatriot});
+  const MapPolicy substitute = UniformRandomPolicy();
+  const std::vector<const Policy*> substitutes = {&substitute, &substitute};
+
+  std::vector<PolicyCfValueTreeEvaluator> fused_evaluators = {
+      PolicyCfValueTreeEvaluator(0), PolicyCfValueTreeEvaluator(1)};
+  FusedCfValueTreeEvaluator fused(fused_evaluators, compatriots, substitutes);
+  const auto evaluations = fused.ComputeCfValueTreeEvaluations(root);
+  SPIEL_CHECK_EQ(evaluations.size(), 2);
+
+  for (int player = 0; player < 2; ++player) {
+    PolicyCfValueTreeEvaluator evaluator(player);
+    const auto [v, cf_value_tree_ptr,
+                num_decision_histories] =
+        evaluator.ComputeCfValueTreeEvaluation(
+            root, compatriots.WithSubstitute(&substitute, player), full_walk);
+    const CfValueTreeEvaluation& evaluation = evaluations[player];
+    SPIEL_CHECK_EQ(evaluation.ev_, v);
+    SPIEL_CHECK_EQ(evaluation.num_histories_, num_decision_histories);
+    const CfValueTree& fused_tree = *evaluation.cf_value_tree_;
+    SPIEL_CHECK_TRUE(fused_tree.roots_ == cf_value_tree_ptr->roots_);
+    SPIEL_CHECK_TRUE(fused_tree.keys_ == cf_value_tree_ptr->keys_);
+    SPIEL_CHECK_EQ(fused_tree.Size(), cf_value_tree_ptr->Size());
+    for (size_t i = 0; i < fused_tree.Size(); ++i) {
+      const CfValueTreeNode& fused_node = fused_tree.nodes_[i];
+      const CfValueTreeNode& node = cf_value_tree_ptr->nodes_[i];
+      SPIEL_CHECK_EQ(fused_node.cf_values_.ev_, node.cf_values_.ev_);
+      SPIEL_CHECK_TRUE(fused_node.cf_values_.v_ == node.cf_values_.v_);
+      SPIEL_CHECK_TRUE(fused_node.children_ == node.children_);
+    }
+  }
+}
+
+void PolicyValuesMatchPolicyValue() {
+  std::shared_ptr<const open_spiel::Game> game =
+      open_spiel::LoadGame("kuhn_poker(players=3)");
+  CachedDecisionPoint root(game->NewInitialState());
+  NullSampler full_walk;
+
+  const MapPolicy compatriot(AlwaysMaxActionPolicy(), root);
+  const PolicyRefProfile compatriots({&compatriot, &compatriot, &compatriot});
+  const MapPolicy uniform = UniformRandomPolicy();
+  const MapPolicy always_zero(AlwaysZeroPolicy(), root);
+  const std::vector<const Policy*> substitutes = {&uniform, &always_zero,
+                                                  &uniform};
+
+  const auto [values, num_decision_histories] =
+      PolicyValues(root, compatriots, substitutes);
+  SPIEL_CHECK_EQ(values.size(), 3);
+  SPIEL_CHECK_EQ(num_decision_histories.size(), 3);
+  for (int player = 0; player < 3; ++player) {
+    const auto [v, num_decision_histories_v] = PolicyValue(
+        root, player, compatriots.WithSubstitute(substitutes[player], player),
+        full_walk);
+    SPIEL_CHECK_EQ(values[player], v);
+    SPIEL_CHECK_EQ(num_decision_histories[player], num_decision_histories_v);
+  }
+}
+
+void MergedTreeValuesMatchCompiled() {
+  std::shared_ptr<const open_spiel::Game> game =
+      open_spiel::LoadGame("kuhn_poker");
+  CachedDecisionPoint cached(game->NewInitialState());
+  CompiledDecisionPoint compiled(game->NewInitialState(), false, false,
+                                 false);
+  CompiledDecisionPoint merged = compiled.Merged();
+  SPIEL_CHECK_TRUE(merged.IsMerged());
+  NullSampler full_walk;
+
+  const MapPolicy compatriot(AlwaysMaxActionPolicy(), cached);
+  const PolicyRefProfile compatriots({&compatriot, &compatriot});
+  const UniformPolicy uniform;
+  const MapPolicy always_zero(AlwaysZeroPolicy(), cached);
+  const std::vector<const Policy*> substitutes = {&uniform, &always_zero};
+
+  const auto [values, num_decision_histories] =
+      PolicyValues(compiled, compatriots, substitutes);
+  PolicyValuesEvaluator merged_evaluator(compatriots, substitutes);
+  const std::vector<Cfv> merged_values = merged_evaluator(merged);
+  int num_memoised = 0;
+  for (int player = 0; player < 2; ++player) {
+    SPIEL_CHECK_FLOAT_NEAR(merged_values[player], values[player], 1e-12);
+    SPIEL_CHECK_EQ(merged_evaluator.num_decision_histories_[player],
+                   num_decision_histories[player]);
+
+    const PolicyRefProfile profile =
+        compatriots.WithSubstitute(substitutes[player], player);
+    PolicyValueEvaluator evaluator(player, profile, full_walk, 2);
+    SPIEL_CHECK_FLOAT_NEAR(evaluator(merged, 1.0, 0), values[player], 1e-12);
+    SPIEL_CHECK_EQ(evaluator.num_decision_histories_,
+                   num_decision_histories[player]);
+    SPIEL_CHECK_EQ(evaluator.num_memoised_decision_histories_,
+                   merged_evaluator.num_memoised_decision_histories_[player]);
+    num_memoised += evaluator.num_memoised_decision_histories_;
+
+    // Tasks memoise the subtrees below them.
+    for (const size_t num_threads : {1, 2}) {
+      const auto [parallel_v, parallel_num_decision_histories] =
+          PolicyValueInParallel(merged, player, profile, num_threads,
+                                /*task_depth=*/1);
+      SPIEL_CHECK_FLOAT_NEAR(parallel_v, values[player], 1e-12);
+      SPIEL_CHECK_EQ(parallel_num_decision_histories,
+                     num_decision_histories[player]);
+    }
+  }
+  // Player 0's decisions after passing and facing a bet are reached once for
+  // each of the opponent's cards, and their subtrees are merged.
+  SPIEL_CHECK_GT(num_memoised, 0);
+}
+
+void SpecializedEvaluatorsMatchVirtual() {
+  std::shared_ptr<const open_spiel::Game> game =
+      open_spiel::LoadGame("leduc_poker");
+  CachedDecisionPoint root(game->NewInitialState());
+  const MapPolicy policy = UniformRandomPolicy();
+
+  for (const std::string sampler_name : {"null", "external", "outcome"}) {
+    // Both samplers draw the same random numbers, but `virtual_sampler`
+    // hides its concrete type from the evaluators.
+    MccfrSamplerPtr sampler = NewSampler(sampler_name, 23);
+    MccfrSamplerPtr forwarded_sampler = NewSampler(sampler_name, 23);
+    VirtualSampler virtual_sampler(*forwarded_sampler);
+    for (int player = 0; player < 2; ++player) {
+      const auto [v1, num_decision_histories1] =
+          PolicyValue(root, player, policy, *sampler);
+      const auto [v2, num_decision_histories2] =
+          PolicyValue(root, player, policy, virtual_sampler);
+      SPIEL_CHECK_EQ(v1, v2);
+      SPIEL_CHECK_EQ(num_decision_histories1, num_decision_histories2);
+
+      const auto [v3, regrets1, num_decision_histories3] =
+          PolicyCounterfactualRegrets(root, player, policy, *sampler);
+      const auto [v4, regrets2, num_decision_histories4] =
+          PolicyCounterfactualRegrets(root, player, policy, virtual_sampler);
+      SPIEL_CHECK_EQ(v3, v4);
+      SPIEL_CHECK_EQ(num_decision_histories3, num_decision_histories4);
+      SPIEL_CHECK_EQ(regrets1.size(), regrets2.size());
+      for (const auto& [iss, regrets] : regrets1) {
+        SPIEL_CHECK_TRUE(regrets.v_ == regrets2.at(iss).v_);
+      }
+
+      PolicyCfValueTreeEvaluator evaluator1(player);
+      PolicyCfValueTreeEvaluator evaluator2(player);
+      const auto [v5, cf_value_tree_ptr1,
+                  num_decision_histories5] =
+          evaluator1.ComputeCfValueTreeEvaluation(root, policy, *sampler);
+      const auto [v6, cf_value_tree_ptr2,
+                  num_decision_histories6] =
+          evaluator2.ComputeCfValueTreeEvaluation(root, policy,
+                                                  virtual_sampler);
+      SPIEL_CHECK_EQ(v5, v6);
+      SPIEL_CHECK_EQ(num_decision_histories5, num_decision_histories6);
+      SPIEL_CHECK_TRUE(cf_value_tree_ptr1->roots_ ==
+                       cf_value_tree_ptr2->roots_);
+      SPIEL_CHECK_TRUE(cf_value_tree_ptr1->keys_ == cf_value_tree_ptr2->keys_);
+    }
+  }
+}
+
+void ResponsesAreComputedOncePerInfoSet() {
+  std::shared_ptr<const open_spiel::Game> game =
+      open_spiel::LoadGame("leduc_poker");
+  CachedDecisionPoint root(game->NewInitialState());
+  NullSampler full_walk;
+  const MapPolicy policy = UniformRandomPolicy();
+
+  PolicyCfValueTreeEvaluator evaluator(0);
+  const auto [v1, cf_value_tree_ptr1,
+              num_decision_histories1] =
+      evaluator.ComputeCfValueTreeEvaluation(root, policy, full_walk);
+  const size_t num_info_sets = root.NumInfoSets(0) + root.NumInfoSets(1);
+  const ResponseCacheStats stats1 = evaluator.ResponseStats();
+  SPIEL_CHECK_EQ(stats1.misses, num_info_sets);
+  SPIEL_CHECK_EQ(stats1.hits + stats1.misses, num_decision_histories1);
+  SPIEL_CHECK_GT(stats1.HitRate(), 0);
+
+  // Responses are recomputed on the next traversal.
+  const auto [v2, cf_value_tree_ptr2,
+              num_decision_histories2] =
+      evaluator.ComputeCfValueTreeEvaluation(root, policy, full_walk);
+  SPIEL_CHECK_EQ(v1, v2);
+  SPIEL_CHECK_EQ(evaluator.ResponseStats().misses, 2 * num_info_sets);
+
+  const auto [v3, num_decision_histories3] =
+      PolicyValue(root, 0, policy, full_walk);
+  SPIEL_CHECK_FLOAT_NEAR(v1, v3, 1e-12);
+}
+
+void ResponseIntoMatchesResponse() {
+  std::shared_ptr<const open_spiel::Game> game =
+      open_spiel::LoadGame("leduc_poker");
+  CachedDecisionPoint root(game->NewInitialState());
+  // Averaging leaves unnormalized sequence weights in the map.
+  const MapPolicy policy(UniformRandomPolicy(), root);
+  const MapPolicy uniform = UniformRandomPolicy();
+  const PolicyRefProfile profile({&policy, &uniform});
+  ForEachState(
+      root,
+      [&profile](const DecisionPoint& decision_point) {
+        const std::vector<double> response = profile.Response(decision_point);
+        std::vector<double> written(decision_point.NumActions(), -1);
+        profile.ResponseInto(decision_point, written.data());
+        SPIEL_CHECK_TRUE(response == written);
+      },
+      ALL_PLAYERS);
+}
+
+void CfValueTreeTopologyIsReused() {
+  std::shared_ptr<const open_spiel::Game> game =
+      open_spiel::LoadGame("leduc_poker");
+  CachedDecisionPoint root(game->NewInitialState());
+  NullSampler full_walk;
+  const MapPolicy uniform = UniformRandomPolicy();
+  const AlwaysZeroPolicy always_fold;
+
+  PolicyCfValueTreeEvaluator reused_evaluator(1);
+  const CfValueTreeNode* node = nullptr;
+  // Folding prunes most of the tree, so the topology changes between the
+  // first two evaluations and between the last two.
+  for (const Policy* policy : {static_cast<const Policy*>(&uniform),
+                               static_cast<const Policy*>(&uniform),
+                               static_cast<const Policy*>(&always_fold),
+                               static_cast<const Policy*>(&uniform)}) {
+    PolicyCfValueTreeEvaluator fresh_evaluator(1);
+    const auto [v1, cf_value_tree_ptr1,
+                num_decision_histories1] =
+        reused_evaluator.ComputeCfValueTreeEvaluation(root, *policy,
+                                                      full_walk);
+    const auto [v2, cf_value_tree_ptr2,
+                num_decision_histories2] =
+        fresh_evaluator.ComputeCfValueTreeEvaluation(root, *policy, full_walk);
+    SPIEL_CHECK_EQ(v1, v2);
+    SPIEL_CHECK_EQ(num_decision_histories1, num_decision_histories2);
+    SPIEL_CHECK_TRUE(cf_value_tree_ptr1->roots_ == cf_value_tree_ptr2->roots_);
+    SPIEL_CHECK_TRUE(cf_value_tree_ptr1->keys_ == cf_value_tree_ptr2->keys_);
+    SPIEL_CHECK_EQ(cf_value_tree_ptr1->Size(), cf_value_tree_ptr2->Size());
+    for (size_t i = 0; i < cf_value_tree_ptr2->Size(); ++i) {
+      const auto& node1 = cf_value_tree_ptr1->nodes_[i];
+      const auto& node2 = cf_value_tree_ptr2->nodes_[i];
+      SPIEL_CHECK_TRUE(node1.cf_values_.v_ == node2.cf_values_.v_);
+      SPIEL_CHECK_EQ(node1.cf_values_.ev_, node2.cf_values_.ev_);
+      SPIEL_CHECK_TRUE(node1.children_ == node2.children_);
+      SPIEL_CHECK_EQ(node1.info_set_id_, node2.info_set_id_);
+      SPIEL_CHECK_EQ(&cf_value_tree_ptr1->At(cf_value_tree_ptr1->keys_[i]),
+                     &node1);
+    }
+    if (policy == &uniform && node != nullptr) {
+      // Only values were rewritten, so nodes did not move.
+      SPIEL_CHECK_EQ(&cf_value_tree_ptr1->nodes_[0], node);
+    }
+    node = policy == &uniform ? &cf_value_tree_ptr1->nodes_[0] : nullptr;
+  }
+}
+
+void CfValueTreesFollowInfoSetIdSpaces() {
+  CachedDecisionPoint leduc(
+      open_spiel::LoadGame("leduc_poker")->NewInitialState());
+  CachedDecisionPoint kuhn(
+      open_spiel::LoadGame("kuhn_poker")->NewInitialState());
+  CompiledDecisionPoint compiled(
+      open_spiel::LoadGame("kuhn_poker")->NewInitialState(),
+      /*save_root=*/false, /*save_terminals=*/false, /*save_states=*/false);
+  SPIEL_CHECK_NE(leduc.InfoSetIdSpace(), kuhn.InfoSetIdSpace());
+  SPIEL_CHECK_NE(CachedDecisionPoint(leduc).InfoSetIdSpace(),
+                 leduc.InfoSetIdSpace());
+  SPIEL_CHECK_EQ(CompiledDecisionPoint(compiled).InfoSetIdSpace(),
+                 compiled.InfoSetIdSpace());
+  SPIEL_CHECK_EQ(compiled.Merged().InfoSetIdSpace(),
+                 compiled.InfoSetIdSpace());
+
+  NullSampler full_walk;
+  const MapPolicy uniform = UniformRandomPolicy();
+  PolicyCfValueTreeEvaluator reused_evaluator(0);
+  // IDs are reused between the trees for different info sets.
+  for (DecisionPoint* root : {static_cast<DecisionPoint*>(&leduc),
+                              static_cast<DecisionPoint*>(&kuhn),
+                              static_cast<DecisionPoint*>(&leduc),
+                              static_cast<DecisionPoint*>(&compiled)}) {
+    PolicyCfValueTreeEvaluator fresh_evaluator(0);
+    const CfValueTree& reused_tree =
+        *reused_evaluator.ComputeCfValueTreeEvaluation(*root, uniform,
+                                                       full_walk)
+             .cf_value_tree_;
+    const CfValueTree& fresh_tree =
+        *fresh_evaluator.ComputeCfValueTreeEvaluation(*root, uniform,
+                                                      full_walk)
+             .cf_value_tree_;
+    SPIEL_CHECK_EQ(reused_tree.info_set_id_space_, root->InfoSetIdSpace());
+    SPIEL_CHECK_TRUE(reused_tree.keys_ == fresh_tree.keys_);
+    SPIEL_CHECK_TRUE(reused_tree.roots_ == fresh_tree.roots_);
+    for (size_t i = 0; i < fresh_tree.Size(); ++i) {
+      SPIEL_CHECK_TRUE(reused_tree.nodes_[i].cf_values_.v_ ==
+                       fresh_tree.nodes_[i].cf_values_.v_);
+      SPIEL_CHECK_TRUE(reused_tree.nodes_[i].children_ ==
+                       fresh_tree.nodes_[i].children_);
+    }
+  }
+}
+
+void ParallelEvaluationsDoNotDependOnThreads() {
+  std::shared_ptr<const open_spiel::Game> game =
+      open_spiel::LoadGame("leduc_poker");
+  CompiledDecisionPoint root(game->NewInitialState(), false, false, false);
+  CachedDecisionPoint cached(game->NewInitialState());
+  NullSampler full_walk;
+  // Policies are looked up by info state, since the tree saves no states.
+  const MapPolicy policy(AlwaysMaxActionPolicy(), cached);
+  const MapPolicy uniform = UniformRandomPolicy();
+  const PolicyRefProfile profile({&policy, &uniform});
+
+  for (int player = 0; player < 2; ++player) {
+    const auto [v1, num_decision_histories1] =
+        PolicyValue(root, player, profile, full_walk);
+    PolicyCfValueTreeEvaluator serial_evaluator(player);
+    const auto [v2, serial_tree, num_decision_histories2] =
+        serial_evaluator.ComputeCfValueTreeEvaluation(root, profile,
+                                                      full_walk);
+
+    PolicyCfValueTreeEvaluator cached_evaluator(player);
+    const auto [v3, cached_tree, num_decision_histories3] =
+        cached_evaluator.ComputeCfValueTreeEvaluationInParallel(cached, profile,
+                                                                1);
+    SPIEL_CHECK_FLOAT_NEAR(v3, v2, 1e-12);
+    SPIEL_CHECK_EQ(num_decision_histories3, num_decision_histories2);
+    SPIEL_CHECK_TRUE(cached_tree->keys_ == serial_tree->keys_);
+    SPIEL_CHECK_TRUE(cached_tree->roots_ == serial_tree->roots_);
+
+    PolicyCfValueTreeEvaluator evaluator(player);
+    for (const size_t num_threads : {1, 2, 4, 1}) {
+      const auto [v4, num_decision_histories4] =
+          PolicyValueInParallel(root, player, profile, num_threads);
+      SPIEL_CHECK_FLOAT_NEAR(v4, v1, 1e-12);
+      SPIEL_CHECK_EQ(num_decision_histories4, num_decision_histories1);
+
+      const auto [v5, tree, num_decision_histories5] =
+          evaluator.ComputeCfValueTreeEvaluationInParallel(root, profile,
+                                                           num_threads);
+      SPIEL_CHECK_EQ(v5, v3);
+      SPIEL_CHECK_EQ(num_decision_histories5, num_decision_histories2);
+      SPIEL_CHECK_TRUE(tree->keys_ == serial_tree->keys_);
+      SPIEL_CHECK_TRUE(tree->roots_ == serial_tree->roots_);
+      for (size_t i = 0; i < tree->Size(); ++i) {
+        const auto& node = tree->nodes_[i];
+        // Tasks are the same whatever the number of threads, so values are
+        // summed in the same order.
+        SPIEL_CHECK_TRUE(node.cf_values_.v_ ==
+                         cached_tree->nodes_[i].cf_values_.v_);
+        SPIEL_CHECK_EQ(node.cf_values_.ev_,
+                       cached_tree->nodes_[i].cf_values_.ev_);
+        SPIEL_CHECK_TRUE(node.children_ == serial_tree->nodes_[i].children_);
+        for (size_t a = 0; a < node.cf_values_.Size(); ++a) {
+          SPIEL_CHECK_FLOAT_NEAR(node.cf_values_[a],
+                                 serial_tree->nodes_[i].cf_values_[a], 1e-12);
+        }
+      }
+    }
+  }
+}
 }  // namespace
 
 }  // namespace test
@@ -477,4 +919,15 @@ int main(int argc, char** argv) {
   RUN_TEST(AlwaysFoldInLeduc);
   RUN_TEST(AlwaysRaiseInLeduc);
   RUN_TEST(UniformRandomInLeduc);
+  RUN_TEST(StateFreeTreeInLeduc);
+  RUN_TEST(ResponsePolicyAdapterOnStateFreeTree);
+  RUN_TEST(FusedCfValueTreesMatchPerPlayer);
+  RUN_TEST(PolicyValuesMatchPolicyValue);
+  RUN_TEST(MergedTreeValuesMatchCompiled);
+  RUN_TEST(SpecializedEvaluatorsMatchVirtual);
+  RUN_TEST(ResponsesAreComputedOncePerInfoSet);
+  RUN_TEST(ResponseIntoMatchesResponse);
+  RUN_TEST(CfValueTreeTopologyIsReused);
+  RUN_TEST(CfValueTreesFollowInfoSetIdSpaces);
+  RUN_TEST(ParallelEvaluationsDoNotDependOnThreads);
 }
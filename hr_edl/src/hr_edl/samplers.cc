@@ -4,7 +4,7 @@
 
 namespace hr_edl {
 
-int SampleActionIndex(const std::vector<double>& policy, double random_number,
+int SampleActionIndex(absl::Span<const double> policy, double random_number,
                       double epsilon) {
   double cumulative_prob = 0;
   int aidx = 0;
@@ -47,41 +47,4 @@ void SampleOneChanceOutcome(
   f(outcomes[SampleActionIndex(outcomes, random_number)], 1.0);
 }
 
-void SampleAllTargetPlayerActions(
-    const std::vector<double>& policy,
-    const std::function<void(int action_idx, double policy_prob,
-                             double sampling_prob)>& f) {
-  for (int action_idx = 0; action_idx < policy.size(); ++action_idx) {
-    f(action_idx, policy[action_idx], 1.0);
-  }
-}
-
-void SampleOneTargetPlayerAction(
-    double random_number, const std::vector<double>& policy,
-    const std::function<void(int action_idx, double policy_prob,
-                             double sampling_prob)>& f,
-    double epsilon) {
-  const int action_idx = SampleActionIndex(policy, random_number, epsilon);
-  const double p = policy[action_idx];
-  f(action_idx, p, (1 - epsilon) * p + epsilon / policy.size());
-}
-
-void SampleAllExternalPlayerActions(
-    const std::vector<double>& policy,
-    const std::function<void(int action_idx, double policy_prob,
-                             double sampling_prob)>& f) {
-  for (int action_idx = 0; action_idx < policy.size(); ++action_idx) {
-    f(action_idx, policy[action_idx], 1.0);
-  }
-}
-
-void SampleOneExternalPlayerAction(
-    double random_number, const std::vector<double>& policy,
-    const std::function<void(int action_idx, double policy_prob,
-                             double sampling_prob)>& f) {
-  const int action_idx = SampleActionIndex(policy, random_number);
-  const double p = policy[action_idx];
-  f(action_idx, p, p);
-}
-
 }  // namespace hr_edl
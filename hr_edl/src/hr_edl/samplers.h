@@ -7,12 +7,14 @@
 #include <vector>
 
 #include "absl/strings/match.h"
+#include "absl/types/span.h"
 #include "open_spiel/spiel.h"
+#include "hr_edl/decision_point.h"
 #include "hr_edl/types.h"
 
 namespace hr_edl {
 
-int SampleActionIndex(const std::vector<double>& policy, double random_number,
+int SampleActionIndex(absl::Span<const double> policy, double random_number,
                       double epsilon = 0);
 int SampleActionIndex(const open_spiel::ActionsAndProbs& actions_and_probs,
                       double random_number);
@@ -22,49 +24,98 @@ void SampleAllChanceOutcomes(
 void SampleOneChanceOutcome(
     double random_number, const open_spiel::State& state,
     const std::function<void(const ActionAndProb&, double)>& f);
-void SampleAllTargetPlayerActions(
-    const std::vector<double>& policy,
-    const std::function<void(int action_idx, double policy_prob,
-                             double sampling_prob)>& f);
-void SampleOneTargetPlayerAction(
-    double random_number, const std::vector<double>& policy,
-    const std::function<void(int action_idx, double policy_prob,
-                             double sampling_prob)>& f,
-    double epsilon = 0);
-void SampleAllExternalPlayerActions(
-    const std::vector<double>& policy,
-    const std::function<void(int action_idx, double policy_prob,
-                             double sampling_prob)>& f);
-void SampleOneExternalPlayerAction(
-    double random_number, const std::vector<double>& policy,
-    const std::function<void(int action_idx, double policy_prob,
-                             double sampling_prob)>& f);
+template <class DP, class F>
+void SampleAllChanceOutcomes(const DP& decision_point, size_t action, F&& f) {
+  // `f` may expand the tree, so probabilities are looked up again for each
+  // outcome.
+  for (int outcome = 0; outcome < decision_point.NumOutcomes(action);
+       ++outcome) {
+    f(outcome, decision_point.OutcomeProbabilitiesRef(action)[outcome], 1.0);
+  }
+}
+template <class DP, class F>
+void SampleOneChanceOutcome(double random_number, const DP& decision_point,
+                            size_t action, F&& f) {
+  const size_t outcome = decision_point.SampleOutcome(action, random_number);
+  const double p = decision_point.OutcomeProbabilitiesRef(action)[outcome];
+  f(outcome, p, p);
+}
+template <class F>
+void SampleAllTargetPlayerActions(absl::Span<const double> policy, F&& f) {
+  for (int action_idx = 0; action_idx < policy.size(); ++action_idx) {
+    f(action_idx, policy[action_idx], 1.0);
+  }
+}
+template <class F>
+void SampleOneTargetPlayerAction(double random_number,
+                                 absl::Span<const double> policy, F&& f,
+                                 double epsilon = 0) {
+  const int action_idx = SampleActionIndex(policy, random_number, epsilon);
+  const double p = policy[action_idx];
+  f(action_idx, p, (1 - epsilon) * p + epsilon / policy.size());
+}
+template <class F>
+void SampleAllExternalPlayerActions(absl::Span<const double> policy, F&& f) {
+  for (int action_idx = 0; action_idx < policy.size(); ++action_idx) {
+    f(action_idx, policy[action_idx], 1.0);
+  }
+}
+template <class F>
+void SampleOneExternalPlayerAction(double random_number,
+                                   absl::Span<const double> policy, F&& f) {
+  const int action_idx = SampleActionIndex(policy, random_number);
+  const double p = policy[action_idx];
+  f(action_idx, p, p);
+}
 
 class /* interface */ MccfrSampler {
  public:
   virtual ~MccfrSampler() = default;
 
+  // Whether every outcome and action is always enumerated with sampling
+  // probability one, so that traversals for different players can share
+  // samples.
+  virtual bool IsExhaustive() const { return false; }
+
   virtual void SampleChanceOutcomes(
       const open_spiel::State& state,
       const std::function<void(const ActionAndProb&, double)>& f) = 0;
+  // Samples outcomes of `action` at `decision_point`.
   virtual void SampleChanceOutcomes(
-      const std::vector<double>& outcome_probs,
-      const std::function<void(int action_idx, double policy_prob,
+      const DecisionPoint& decision_point, size_t action,
+      const std::function<void(int outcome, double outcome_prob,
                                double sampling_prob)>& f) = 0;
   virtual void SampleTargetPlayerActions(
-      const std::vector<double>& policy,
+      absl::Span<const double> policy,
       const std::function<void(int action_idx, double policy_prob,
                                double sampling_prob)>& f) = 0;
   virtual void SampleExternalPlayerActions(
-      const std::vector<double>& policy,
+      absl::Span<const double> policy,
       const std::function<void(int action_idx, double policy_prob,
                                double sampling_prob)>& f) = 0;
+
+  // Statically dispatched counterparts of the sampling methods above. The
+  // concrete samplers hide these with versions that call `f` directly, so
+  // traversals instantiated on a concrete sampler can inline `f`.
+  template <class DP, class F>
+  void ForEachChanceOutcome(const DP& decision_point, size_t action, F&& f) {
+    SampleChanceOutcomes(decision_point, action, f);
+  }
+  template <class F>
+  void ForEachTargetPlayerAction(absl::Span<const double> policy, F&& f) {
+    SampleTargetPlayerActions(policy, f);
+  }
+  template <class F>
+  void ForEachExternalPlayerAction(absl::Span<const double> policy, F&& f) {
+    SampleExternalPlayerActions(policy, f);
+  }
 };
 using MccfrSamplerPtr = std::unique_ptr<MccfrSampler>;
 
-class NullSampler : public MccfrSampler {
+class NullSampler final : public MccfrSampler {
  public:
   NullSampler() {}
+  bool IsExhaustive() const override final { return true; }
   void SampleChanceOutcomes(
       const open_spiel::State& state,
       const std::function<void(const ActionAndProb&, double)>& f)
@@ -72,27 +123,40 @@ class NullSampler : public MccfrSampler {
     SampleAllChanceOutcomes(state, f);
   }
   void SampleChanceOutcomes(
-      const std::vector<double>& outcome_probs,
-      const std::function<void(int action_idx, double policy_prob,
+      const DecisionPoint& decision_point, size_t action,
+      const std::function<void(int outcome, double outcome_prob,
                                double sampling_prob)>& f) override final {
-    SampleAllExternalPlayerActions(outcome_probs, f);
+    ForEachChanceOutcome(decision_point, action, f);
   }
   void SampleTargetPlayerActions(
-      const std::vector<double>& policy,
+      absl::Span<const double> policy,
       const std::function<void(int action_idx, double policy_prob,
                                double sampling_prob)>& f) override final {
-    SampleAllTargetPlayerActions(policy, f);
+    ForEachTargetPlayerAction(policy, f);
   }
 
   void SampleExternalPlayerActions(
-      const std::vector<double>& policy,
+      absl::Span<const double> policy,
       const std::function<void(int action_idx, double policy_prob,
                                double sampling_prob)>& f) override final {
+    ForEachExternalPlayerAction(policy, f);
+  }
+
+  template <class DP, class F>
+  void ForEachChanceOutcome(const DP& decision_point, size_t action, F&& f) {
+    SampleAllChanceOutcomes(decision_point, action, f);
+  }
+  template <class F>
+  void ForEachTargetPlayerAction(absl::Span<const double> policy, F&& f) {
+    SampleAllTargetPlayerActions(policy, f);
+  }
+  template <class F>
+  void ForEachExternalPlayerAction(absl::Span<const double> policy, F&& f) {
     SampleAllExternalPlayerActions(policy, f);
   }
 };
 
-class ChanceSampler : public MccfrSampler {
+class ChanceSampler final : public MccfrSampler {
  public:
   ChanceSampler(std::shared_ptr<std::mt19937_64> random_engine)
       : random_engine_(std::move(random_engine)), uniform_dist_(0, 1) {}
@@ -104,24 +168,37 @@ class ChanceSampler : public MccfrSampler {
     SampleOneChanceOutcome(uniform_dist_(*random_engine_), state, f);
   }
   void SampleChanceOutcomes(
-      const std::vector<double>& outcome_probs,
-      const std::function<void(int action_idx, double policy_prob,
+      const DecisionPoint& decision_point, size_t action,
+      const std::function<void(int outcome, double outcome_prob,
                                double sampling_prob)>& f) override final {
-    SampleOneExternalPlayerAction(uniform_dist_(*random_engine_), outcome_probs,
-                                  f);
+    ForEachChanceOutcome(decision_point, action, f);
   }
 
   void SampleTargetPlayerActions(
-      const std::vector<double>& policy,
+      absl::Span<const double> policy,
       const std::function<void(int action_idx, double policy_prob,
                                double sampling_prob)>& f) override final {
-    SampleAllTargetPlayerActions(policy, f);
+    ForEachTargetPlayerAction(policy, f);
   }
 
   void SampleExternalPlayerActions(
-      const std::vector<double>& policy,
+      absl::Span<const double> policy,
       const std::function<void(int action_idx, double policy_prob,
                                double sampling_prob)>& f) override final {
+    ForEachExternalPlayerAction(policy, f);
+  }
+
+  template <class DP, class F>
+  void ForEachChanceOutcome(const DP& decision_point, size_t action, F&& f) {
+    SampleOneChanceOutcome(uniform_dist_(*random_engine_), decision_point,
+                           action, f);
+  }
+  template <class F>
+  void ForEachTargetPlayerAction(absl::Span<const double> policy, F&& f) {
+    SampleAllTargetPlayerActions(policy, f);
+  }
+  template <class F>
+  void ForEachExternalPlayerAction(absl::Span<const double> policy, F&& f) {
     SampleAllExternalPlayerActions(policy, f);
   }
 
@@ -130,7 +207,7 @@ class ChanceSampler : public MccfrSampler {
   std::uniform_real_distribution<double> uniform_dist_;
 };
 
-class ExternalSampler : public MccfrSampler {
+class ExternalSampler final : public MccfrSampler {
  public:
   ExternalSampler(std::shared_ptr<std::mt19937_64> random_engine)
       : random_engine_(std::move(random_engine)), uniform_dist_(0, 1) {}
@@ -142,24 +219,37 @@ class ExternalSampler : public MccfrSampler {
     SampleOneChanceOutcome(uniform_dist_(*random_engine_), state, f);
   }
   void SampleChanceOutcomes(
-      const std::vector<double>& outcome_probs,
-      const std::function<void(int action_idx, double policy_prob,
+      const DecisionPoint& decision_point, size_t action,
+      const std::function<void(int outcome, double outcome_prob,
                                double sampling_prob)>& f) override final {
-    SampleOneExternalPlayerAction(uniform_dist_(*random_engine_), outcome_probs,
-                                  f);
+    ForEachChanceOutcome(decision_point, action, f);
   }
 
   void SampleTargetPlayerActions(
-      const std::vector<double>& policy,
+      absl::Span<const double> policy,
       const std::function<void(int action_idx, double policy_prob,
                                double sampling_prob)>& f) override final {
-    SampleAllTargetPlayerActions(policy, f);
+    ForEachTargetPlayerAction(policy, f);
   }
 
   void SampleExternalPlayerActions(
-      const std::vector<double>& policy,
+      absl::Span<const double> policy,
       const std::function<void(int action_idx, double policy_prob,
                                double sampling_prob)>& f) override final {
+    ForEachExternalPlayerAction(policy, f);
+  }
+
+  template <class DP, class F>
+  void ForEachChanceOutcome(const DP& decision_point, size_t action, F&& f) {
+    SampleOneChanceOutcome(uniform_dist_(*random_engine_), decision_point,
+                           action, f);
+  }
+  template <class F>
+  void ForEachTargetPlayerAction(absl::Span<const double> policy, F&& f) {
+    SampleAllTargetPlayerActions(policy, f);
+  }
+  template <class F>
+  void ForEachExternalPlayerAction(absl::Span<const double> policy, F&& f) {
     SampleOneExternalPlayerAction(uniform_dist_(*random_engine_), policy, f);
   }
 
@@ -168,7 +258,7 @@ class ExternalSampler : public MccfrSampler {
   std::uniform_real_distribution<double> uniform_dist_;
 };
 
-class OutcomeSampler : public MccfrSampler {
+class OutcomeSampler final : public MccfrSampler {
  public:
   OutcomeSampler(std::shared_ptr<std::mt19937_64> random_engine,
                  double epsilon = 0)
@@ -183,25 +273,38 @@ class OutcomeSampler : public MccfrSampler {
     SampleOneChanceOutcome(uniform_dist_(*random_engine_), state, f);
   }
   void SampleChanceOutcomes(
-      const std::vector<double>& outcome_probs,
-      const std::function<void(int action_idx, double policy_prob,
+      const DecisionPoint& decision_point, size_t action,
+      const std::function<void(int outcome, double outcome_prob,
                                double sampling_prob)>& f) override final {
-    SampleOneExternalPlayerAction(uniform_dist_(*random_engine_), outcome_probs,
-                                  f);
+    ForEachChanceOutcome(decision_point, action, f);
   }
 
   void SampleTargetPlayerActions(
-      const std::vector<double>& policy,
+      absl::Span<const double> policy,
       const std::function<void(int action_idx, double policy_prob,
                                double sampling_prob)>& f) override final {
-    SampleOneTargetPlayerAction(uniform_dist_(*random_engine_), policy, f,
-                                epsilon_);
+    ForEachTargetPlayerAction(policy, f);
   }
 
   void SampleExternalPlayerActions(
-      const std::vector<double>& policy,
+      absl::Span<const double> policy,
       const std::function<void(int action_idx, double policy_prob,
                                double sampling_prob)>& f) override final {
+    ForEachExternalPlayerAction(policy, f);
+  }
+
+  template <class DP, class F>
+  void ForEachChanceOutcome(const DP& decision_point, size_t action, F&& f) {
+    SampleOneChanceOutcome(uniform_dist_(*random_engine_), decision_point,
+                           action, f);
+  }
+  template <class F>
+  void ForEachTargetPlayerAction(absl::Span<const double> policy, F&& f) {
+    SampleOneTargetPlayerAction(uniform_dist_(*random_engine_), policy, f,
+                                epsilon_);
+  }
+  template <class F>
+  void ForEachExternalPlayerAction(absl::Span<const double> policy, F&& f) {
     SampleOneExternalPlayerAction(uniform_dist_(*random_engine_), policy, f);
   }
 
@@ -211,6 +314,60 @@ class OutcomeSampler : public MccfrSampler {
   std::uniform_real_distribution<double> uniform_dist_;
 };
 
+// Forwards to another sampler only through the virtual interface, so
+// traversals never specialise on it.
+class VirtualSampler final : public MccfrSampler {
+ public:
+  VirtualSampler(MccfrSampler& sampler) : sampler_(sampler) {}
+
+  bool IsExhaustive() const override final { return sampler_.IsExhaustive(); }
+  void SampleChanceOutcomes(
+      const open_spiel::State& state,
+      const std::function<void(const ActionAndProb&, double)>& f)
+      override final {
+    sampler_.SampleChanceOutcomes(state, f);
+  }
+  void SampleChanceOutcomes(
+      const DecisionPoint& decision_point, size_t action,
+      const std::function<void(int outcome, double outcome_prob,
+                               double sampling_prob)>& f) override final {
+    sampler_.SampleChanceOutcomes(decision_point, action, f);
+  }
+  void SampleTargetPlayerActions(
+      absl::Span<const double> policy,
+      const std::function<void(int action_idx, double policy_prob,
+                               double sampling_prob)>& f) override final {
+    sampler_.SampleTargetPlayerActions(policy, f);
+  }
+  void SampleExternalPlayerActions(
+      absl::Span<const double> policy,
+      const std::function<void(int action_idx, double policy_prob,
+                               double sampling_prob)>& f) override final {
+    sampler_.SampleExternalPlayerActions(policy, f);
+  }
+
+ private:
+  MccfrSampler& sampler_;
+};
+
+// Calls `f` with `sampler` as its concrete type if it is one of the samplers
+// above, so that `f` can be instantiated on that type, and with `sampler`
+// itself otherwise.
+template <class F>
+decltype(auto) WithConcreteSampler(MccfrSampler& sampler, F&& f) {
+  if (auto* null_sampler = dynamic_cast<NullSampler*>(&sampler)) {
+    return f(*null_sampler);
+  } else if (auto* chance_sampler = dynamic_cast<ChanceSampler*>(&sampler)) {
+    return f(*chance_sampler);
+  } else if (auto* external_sampler =
+                 dynamic_cast<ExternalSampler*>(&sampler)) {
+    return f(*external_sampler);
+  } else if (auto* outcome_sampler = dynamic_cast<OutcomeSampler*>(&sampler)) {
+    return f(*outcome_sampler);
+  }
+  return f(sampler);
+}
+
 inline MccfrSamplerPtr NewSampler(const std::string& sampler, int random_seed) {
   if (absl::StrContains("null", sampler)) {
     return MccfrSamplerPtr(new NullSampler());
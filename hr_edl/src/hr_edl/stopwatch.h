@@ -30,6 +30,14 @@ class Stopwatch {
   double milliseconds() const {
     return duration<double, std::chrono::milliseconds>();
   }
+  // Unlike `milliseconds`, keeps fractions of a millisecond.
+  double fractional_milliseconds() const {
+    return duration<double, std::chrono::microseconds>() / 1000;
+  }
+  // Likewise, keeps fractions of a microsecond.
+  double fractional_microseconds() const {
+    return duration<double, std::chrono::nanoseconds>() / 1000;
+  }
 
  private:
   typename Clock::time_point start_time_;
@@ -1,115 +1,162 @@
 #ifndef HR_EDL_TABULAR_LEARNER_H_
 #define HR_EDL_TABULAR_LEARNER_H_
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include <memory>
 
 #include "hr_edl/action_transformation.h"
+#include "hr_edl/enumeration.h"
+#include "hr_edl/policy.h"
 
 namespace hr_edl {
 
 namespace _tl {
-class ImmediatePolicy {
- public:
-  virtual ~ImmediatePolicy() = default;
-  virtual std::vector<double> Response() const = 0;
-  virtual void Response(double* out) const = 0;
-  virtual size_t NumActions() const = 0;
-};
-
-class CachedImmediatePolicy : public ImmediatePolicy {
- public:
-  CachedImmediatePolicy(size_t num_actions)
-      : policy_(num_actions, 1.0 / num_actions) {}
-  CachedImmediatePolicy(std::vector<double>&& policy)
-      : policy_(std::move(policy)) {}
-  virtual ~CachedImmediatePolicy() = default;
-
-  std::vector<double> Response() const override final { return policy_; }
-  void Response(double* out) const override final {
-    assert(out);
-    std::memcpy(out, policy_.data(), policy_.size() * sizeof(*out));
-  }
-  size_t NumActions() const override final { return policy_.size(); }
-
- protected:
-  std::vector<double> policy_;
-};
-
 using RegretTransformation = std::function<double(
     double prev_regret, double regret, size_t round_number)>;
 using LinkFn = std::function<void(const std::vector<double>&,
                                   const EnumerationConsumer<double>&)>;
 
+// The `size_` reach probabilities of a node's predecessor sequences under
+// its policy before (`prev_`) and after (`next_`) an update, which live in
+// arrays owned by the learner.
 struct ReachProbLists {
-  const std::vector<double> prev_;
-  const std::vector<double> next_;
-  size_t Size() const { return prev_.size(); }
+  const double* prev_;
+  const double* next_;
+  size_t size_;
+  size_t Size() const { return size_; }
+  absl::Span<const double> Prev() const {
+    return absl::MakeConstSpan(prev_, size_);
+  }
+  absl::Span<const double> Next() const {
+    return absl::MakeConstSpan(next_, size_);
+  }
 };
 
-class ImmediateDecisionInfo : public CachedImmediatePolicy {
+// The policies and regrets of all of a learner's info sets, in a few
+// contiguous arrays. Info sets are referred to by their slot, which is the
+// order in which they were added.
+class DecisionInfoStore {
  public:
-  ImmediateDecisionInfo(size_t num_actions, size_t ex_num_pred_reach_probs,
-                        size_t in_num_pred_reach_probs)
-      : CachedImmediatePolicy(num_actions),
-        round_number_(1),
-        ex_phi_list_(ex_num_pred_reach_probs > 0
-                         ? SwapActionTranformation::External(num_actions)
-                         : std::vector<SwapActionTranformation>()),
-        in_phi_list_(in_num_pred_reach_probs > 0
-                         ? SwapActionTranformation::Internal(num_actions)
-                         : std::vector<SwapActionTranformation>()),
-        ex_regrets_(ex_phi_list_.size() * ex_num_pred_reach_probs, 0),
-        in_regrets_(in_phi_list_.size() * in_num_pred_reach_probs, 0),
-        phi_sum_(num_actions) {}
-  virtual ~ImmediateDecisionInfo() = default;
-
-  void Update(const CfValues& cfvs, const RegretTransformation& update_target,
-              const LinkFn& f, const ReachProbLists& ex_pred_reach_prob_lists,
-              const ReachProbLists& in_pred_reach_prob_lists) {
+  DecisionInfoStore()
+      : entries_(), policies_(), regrets_(), link_input_() {}
+
+  size_t Size() const { return entries_.size(); }
+
+  // Adds an info set with a uniform policy and no regret and returns its
+  // slot.
+  size_t Add(size_t num_actions, size_t ex_num_pred_reach_probs,
+             size_t in_num_pred_reach_probs) {
+    Entry entry;
+    entry.num_actions_ = num_actions;
+    entry.round_number_ = 1;
+    entry.policy_ = policies_.size();
+    entry.ex_regrets_ = regrets_.size();
+    entry.num_ex_regrets_ = num_actions * ex_num_pred_reach_probs;
+    entry.in_regrets_ = entry.ex_regrets_ + entry.num_ex_regrets_;
+    entry.num_in_regrets_ =
+        num_actions * (num_actions - 1) * in_num_pred_reach_probs;
+    policies_.resize(policies_.size() + num_actions, 1.0 / num_actions);
+    regrets_.resize(entry.in_regrets_ + entry.num_in_regrets_, 0);
+    entries_.push_back(entry);
+    return entries_.size() - 1;
+  }
+
+  size_t NumActions(size_t slot) const { return entries_[slot].num_actions_; }
+  std::vector<double> Response(size_t slot) const {
+    const double* policy = Policy(slot);
+    return std::vector<double>(policy, policy + NumActions(slot));
+  }
+  void Response(size_t slot, double* out) const {
+    assert(out);
+    std::memcpy(out, Policy(slot), NumActions(slot) * sizeof(*out));
+  }
+  const double* Policy(size_t slot) const {
+    return policies_.data() + entries_[slot].policy_;
+  }
+  double* Policy(size_t slot) {
+    return policies_.data() + entries_[slot].policy_;
+  }
+
+  // Updates the regrets of the info set in `slot` and adds each deviation,
+  // weighted by its linked regret, to `phi_sum`. The fixed point of
+  // `phi_sum` is the new policy, which must be written to `Policy(slot)`
+  // before `FinishUpdate(slot)`.
+  void UpdateRegrets(size_t slot, const CfValues& cfvs,
+                     const RegretTransformation& update_target,
+                     const LinkFn& f,
+                     const ReachProbLists& ex_pred_reach_prob_lists,
+                     const ReachProbLists& in_pred_reach_prob_lists,
+                     WeightedActionTransformation& phi_sum) {
+    const Entry& entry = entries_[slot];
+    const size_t num_actions = entry.num_actions_;
+    const double* policy = Policy(slot);
     if (ex_pred_reach_prob_lists.Size() > 0) {
-      UpdatePhiSetRegrets(ex_regrets_, ex_phi_list_, cfvs, update_target, f,
-                          ex_pred_reach_prob_lists);
+      double phi_regrets[num_actions];
+      ExternalRegrets(cfvs, policy, phi_regrets);
+      UpdatePhiSetRegrets(entry.ex_regrets_, entry.num_ex_regrets_,
+                          entry.round_number_, phi_regrets, num_actions,
+                          update_target, f, ex_pred_reach_prob_lists,
+                          [&phi_sum](size_t phi_idx, double weight) {
+                            phi_sum.AddExternal(phi_idx, weight);
+                          });
     }
     if (in_pred_reach_prob_lists.Size() > 0) {
-      UpdatePhiSetRegrets(in_regrets_, in_phi_list_, cfvs, update_target, f,
-                          in_pred_reach_prob_lists);
+      const size_t num_phis = num_actions * (num_actions - 1);
+      double phi_regrets[num_phis];
+      InternalRegrets(cfvs, policy, phi_regrets);
+      UpdatePhiSetRegrets(
+          entry.in_regrets_, entry.num_in_regrets_, entry.round_number_,
+          phi_regrets, num_phis, update_target, f, in_pred_reach_prob_lists,
+          [&phi_sum, num_actions](size_t phi_idx, double weight) {
+            const size_t from = phi_idx / (num_actions - 1);
+            const size_t to = phi_idx % (num_actions - 1);
+            phi_sum.AddInternal(from, to < from ? to : to + 1, weight);
+          });
     }
-    phi_sum_.FixedPoint(policy_);
-    phi_sum_.Reset();
-    ++round_number_;
   }
+  void FinishUpdate(size_t slot) { ++entries_[slot].round_number_; }
 
  private:
-  void UpdatePhiSetRegrets(std::vector<double>& regrets,
-                           const std::vector<SwapActionTranformation>& phi_list,
-                           const CfValues& cfvs,
+  // `phi_regrets` holds the regret of each of the `num_phis` transformations
+  // in the order of `SwapActionTranformation::External` or `Internal`, and
+  // `add_phi(i, weight)` adds the `i`th to the info set's sum.
+  template <class AddPhi>
+  void UpdatePhiSetRegrets(size_t first_regret, size_t num_regrets,
+                           size_t round_number, const double* phi_regrets,
+                           size_t num_phis,
                            const RegretTransformation& update_target,
                            const LinkFn& f,
-                           const ReachProbLists& pred_reach_prob_lists) {
-    const size_t num_reach_probs = pred_reach_prob_lists.prev_.size();
-    assert(num_reach_probs == pred_reach_prob_lists.next_.size());
+                           const ReachProbLists& pred_reach_prob_lists,
+                           const AddPhi& add_phi) {
+    const size_t num_reach_probs = pred_reach_prob_lists.Size();
+    assert(num_regrets == num_phis * num_reach_probs);
+    double* regrets = regrets_.data() + first_regret;
     size_t idx = 0;
-    for (size_t i = 0; i < phi_list.size(); ++i) {
-      const double regret = phi_list[i].Regret(cfvs, policy_);
+    for (size_t i = 0; i < num_phis; ++i) {
+      const double regret = phi_regrets[i];
       for (size_t j = 0; j < num_reach_probs; ++j) {
-        assert(idx < regrets.size());
         regrets[idx] +=
             update_target(regrets[idx], pred_reach_prob_lists.prev_[j] * regret,
-                          round_number_);
+                          round_number);
         ++idx;
       }
     }
+    // `LinkFn` takes a vector.
+    link_input_.assign(regrets, regrets + num_regrets);
     size_t reach_prob_idx = 0;
     size_t phi_idx = 0;
     double sum = 0;
-    f(regrets, [this, num_reach_probs, &reach_prob_idx,
-                p_next = pred_reach_prob_lists.next_.data(), &sum, &phi_idx,
-                &phi_list](size_t regret_idx, double link_output) {
+    f(link_input_, [num_reach_probs, &reach_prob_idx,
+                    p_next = pred_reach_prob_lists.next_, &sum,
+                    &phi_idx, num_phis,
+                    &add_phi](size_t regret_idx, double link_output) {
       sum += p_next[reach_prob_idx] * link_output;
       ++reach_prob_idx;
       if (reach_prob_idx == num_reach_probs) {
-        assert(phi_idx < phi_list.size());
-        phi_sum_.Add(phi_list[phi_idx], sum);
+        assert(phi_idx < num_phis);
+        add_phi(phi_idx, sum);
         ++phi_idx;
         sum = 0;
         reach_prob_idx = 0;
@@ -118,44 +165,66 @@ class ImmediateDecisionInfo : public CachedImmediatePolicy {
   }
 
  private:
-  size_t round_number_;
-  const std::vector<SwapActionTranformation> ex_phi_list_;
-  const std::vector<SwapActionTranformation> in_phi_list_;
-  std::vector<double> ex_regrets_;
-  std::vector<double> in_regrets_;
-  WeightedActionTransformation phi_sum_;
+  // Where an info set's data is in the arrays.
+  struct Entry {
+    size_t num_actions_;
+    size_t round_number_;
+    size_t policy_;
+    size_t ex_regrets_;
+    size_t num_ex_regrets_;
+    size_t in_regrets_;
+    size_t num_in_regrets_;
+  };
+
+  std::vector<Entry> entries_;
+  std::vector<double> policies_;
+  // External then internal regrets, info set by info set.
+  std::vector<double> regrets_;
+  std::vector<double> link_input_;
 };
 }  // namespace _tl
 
 struct NoExternal {
-  std::vector<double> ExternalPredecessorReachProbs(
-      const std::vector<double>& pred_reach_probs) const {
-    return {};
+  size_t NumExternalPredecessorReachProbs(size_t num_pred_reach_probs) const {
+    return 0;
   }
+  void ExternalPredecessorReachProbs(absl::Span<const double> pred_reach_probs,
+                                     double* out) const {}
 };
 struct AllExternal {
-  std::vector<double> ExternalPredecessorReachProbs(
-      const std::vector<double>& pred_reach_probs) const {
-    return pred_reach_probs;
+  size_t NumExternalPredecessorReachProbs(size_t num_pred_reach_probs) const {
+    return num_pred_reach_probs;
+  }
+  void ExternalPredecessorReachProbs(absl::Span<const double> pred_reach_probs,
+                                     double* out) const {
+    std::copy(pred_reach_probs.begin(), pred_reach_probs.end(), out);
   }
 };
 struct NoInternal {
-  std::vector<double> InternalPredecessorReachProbs(
-      const std::vector<double>& pred_reach_probs) const {
-    return {};
+  size_t NumInternalPredecessorReachProbs(size_t num_pred_reach_probs) const {
+    return 0;
   }
+  void InternalPredecessorReachProbs(absl::Span<const double> pred_reach_probs,
+                                     double* out) const {}
 };
 struct AllInternal {
-  std::vector<double> InternalPredecessorReachProbs(
-      const std::vector<double>& pred_reach_probs) const {
-    return pred_reach_probs;
+  size_t NumInternalPredecessorReachProbs(size_t num_pred_reach_probs) const {
+    return num_pred_reach_probs;
+  }
+  void InternalPredecessorReachProbs(absl::Span<const double> pred_reach_probs,
+                                     double* out) const {
+    std::copy(pred_reach_probs.begin(), pred_reach_probs.end(), out);
   }
 };
 struct CounterfactualSuccessors {
-  std::vector<double> SuccessorReachProbs(
-      const std::vector<double>& pred_reach_probs, const double* strat,
-      size_t num_actions, size_t action) const {
-    return {1.0};
+  size_t NumSuccessorReachProbs(size_t num_pred_reach_probs,
+                                size_t num_actions) const {
+    return 1;
+  }
+  void SuccessorReachProbs(absl::Span<const double> pred_reach_probs,
+                           const double* strat, size_t num_actions,
+                           size_t action, double* out) const {
+    out[0] = 1.0;
   }
 };
 
@@ -174,10 +243,14 @@ struct ImmediateExInSequencePredecessors : public AllExternal,
                                            public CounterfactualSuccessors {};
 
 struct IdentitySuccessors {
-  std::vector<double> SuccessorReachProbs(
-      const std::vector<double>& pred_reach_probs, const double* strat,
-      size_t num_actions, size_t action) const {
-    return {pred_reach_probs[0] * strat[action]};
+  size_t NumSuccessorReachProbs(size_t num_pred_reach_probs,
+                                size_t num_actions) const {
+    return 1;
+  }
+  void SuccessorReachProbs(absl::Span<const double> pred_reach_probs,
+                           const double* strat, size_t num_actions,
+                           size_t action, double* out) const {
+    out[0] = pred_reach_probs[0] * strat[action];
   }
 };
 
@@ -190,13 +263,16 @@ struct BlindActionSequencePredecessors : public AllExternal,
                                          public IdentitySuccessors {};
 
 struct BlindPartialSequenceSuccessors {
-  std::vector<double> SuccessorReachProbs(
-      const std::vector<double>& pred_reach_probs, const double* strat,
-      size_t num_actions, size_t action) const {
-    std::vector<double> succ_reach_probs = pred_reach_probs;  // External
-    succ_reach_probs.push_back(pred_reach_probs[pred_reach_probs.size() - 1] *
-                               strat[action]);  // Identity
-    return succ_reach_probs;
+  size_t NumSuccessorReachProbs(size_t num_pred_reach_probs,
+                                size_t num_actions) const {
+    return num_pred_reach_probs + 1;
+  }
+  void SuccessorReachProbs(absl::Span<const double> pred_reach_probs,
+                           const double* strat, size_t num_actions,
+                           size_t action, double* out) const {
+    out = std::copy(pred_reach_probs.begin(), pred_reach_probs.end(),
+                    out);                            // External
+    *out = pred_reach_probs.back() * strat[action];  // Identity
   }
 };
 
@@ -216,32 +292,39 @@ struct CounterfactualPartialSequenceExInPredecessors
       public BlindPartialSequenceSuccessors {};
 
 struct CausalSuccessors {
-  std::vector<double> SuccessorReachProbs(
-      const std::vector<double>& pred_reach_probs, const double* strat,
-      size_t num_actions, size_t action) const {
-    std::vector<double> succ_reach_probs = pred_reach_probs;  // External
-    succ_reach_probs.reserve(pred_reach_probs.size() + num_actions);
-    const double identity_seq = pred_reach_probs[pred_reach_probs.size() - 1];
+  size_t NumSuccessorReachProbs(size_t num_pred_reach_probs,
+                                size_t num_actions) const {
+    return num_pred_reach_probs + num_actions;
+  }
+  void SuccessorReachProbs(absl::Span<const double> pred_reach_probs,
+                           const double* strat, size_t num_actions,
+                           size_t action, double* out) const {
+    out = std::copy(pred_reach_probs.begin(), pred_reach_probs.end(),
+                    out);  // External
+    const double identity_seq = pred_reach_probs.back();
     for (size_t a = 0; a < num_actions; ++a) {  // Internal
       if (a != action) {
-        succ_reach_probs.push_back(identity_seq * strat[a]);
+        *out++ = identity_seq * strat[a];
       }
     }
-    succ_reach_probs.push_back(identity_seq * strat[action]);  // Identity
-    return succ_reach_probs;
+    *out = identity_seq * strat[action];  // Identity
   }
 };
 
 struct CausalPartialSequencePredecessors : public CausalSuccessors {
-  std::vector<double> ExternalPredecessorReachProbs(
-      const std::vector<double>& pred_reach_probs) const {
-    std::vector<double> p(pred_reach_probs.size() - 1);
-    std::copy(pred_reach_probs.begin(), pred_reach_probs.end() - 1, p.begin());
-    return p;
+  size_t NumExternalPredecessorReachProbs(size_t num_pred_reach_probs) const {
+    return num_pred_reach_probs - 1;
+  }
+  void ExternalPredecessorReachProbs(absl::Span<const double> pred_reach_probs,
+                                     double* out) const {
+    std::copy(pred_reach_probs.begin(), pred_reach_probs.end() - 1, out);
+  }
+  size_t NumInternalPredecessorReachProbs(size_t num_pred_reach_probs) const {
+    return 1;
   }
-  std::vector<double> InternalPredecessorReachProbs(
-      const std::vector<double>& pred_reach_probs) const {
-    return {pred_reach_probs[pred_reach_probs.size() - 1]};
+  void InternalPredecessorReachProbs(absl::Span<const double> pred_reach_probs,
+                                     double* out) const {
+    out[0] = pred_reach_probs.back();
   }
 };
 
@@ -255,17 +338,18 @@ struct TwiceInformedPartialSequenceExInPredecessors : public AllExternal,
 };
 
 struct BehavioralPredecessors : public NoExternal, public AllInternal {
-  std::vector<double> SuccessorReachProbs(
-      const std::vector<double>& pred_reach_probs, const double* strat,
-      size_t num_actions, size_t action) const {
-    std::vector<double> succ_reach_probs;
-    succ_reach_probs.reserve(pred_reach_probs.size() * num_actions);
-    for (auto p : pred_reach_probs) {
+  size_t NumSuccessorReachProbs(size_t num_pred_reach_probs,
+                                size_t num_actions) const {
+    return num_pred_reach_probs * num_actions;
+  }
+  void SuccessorReachProbs(absl::Span<const double> pred_reach_probs,
+                           const double* strat, size_t num_actions,
+                           size_t action, double* out) const {
+    for (const double p : pred_reach_probs) {
       for (size_t a = 0; a < num_actions; ++a) {
-        succ_reach_probs.push_back(p * strat[a]);
+        *out++ = p * strat[a];
       }
     }
-    return succ_reach_probs;
   }
 };
 
@@ -286,44 +370,142 @@ class CfValueTreeLearner : public virtual Policy {
 
  public:
   virtual ~CfValueTreeLearner() = default;
-  virtual void Update(const std::vector<std::string>& initial_info_states,
-                      const InfoStateUvm<CfValueTreeNode>& cf_value_tree) = 0;
+  virtual void Update(const CfValueTree& cf_value_tree) = 0;
   virtual CfValueTreeLearnerPtr Clone() const = 0;
 };
 
-template <class T>  // Requires T#Response()
+template <class Store>
+// Concept Store requires
+// size_t Size() const;
+// size_t Add(Args...);  // Returns the new info set's slot.
+// std::vector<double> Response(size_t slot) const;
+// void Response(size_t slot, double* out) const;
 class TabularResponder : public virtual Policy {
  public:
-  TabularResponder() : local_info_map_() {}
+  TabularResponder()
+      : store_(),
+        slot_by_key_(),
+        id_space_(0),
+        id_player_(open_spiel::kInvalidPlayer),
+        slot_by_id_() {}
   virtual ~TabularResponder() = default;
 
   std::vector<double> Response(
       const open_spiel::State& state) const override final {
-    const std::string info_state = state.InformationStateString();
-    if (local_info_map_.contains(info_state)) {
-      return local_info_map_.at(info_state).Response();
+    const auto iter = slot_by_key_.find(state.InformationStateString());
+    if (iter != slot_by_key_.end()) {
+      return store_.Response(iter->second);
     } else {
       const int n = state.LegalActions().size();
       return std::vector<double>(n, 1.0 / n);
     }
   }
+  std::vector<double> Response(
+      const DecisionPoint& decision_point) const override final {
+    const size_t slot = Find(decision_point);
+    if (slot == kNoSlot) {
+      const int n = decision_point.NumActions();
+      return std::vector<double>(n, 1.0 / n);
+    }
+    return store_.Response(slot);
+  }
+  void ResponseInto(const DecisionPoint& decision_point,
+                    double* out) const override final {
+    const size_t slot = Find(decision_point);
+    if (slot == kNoSlot) {
+      const int n = decision_point.NumActions();
+      std::fill_n(out, n, 1.0 / n);
+    } else {
+      store_.Response(slot, out);
+    }
+  }
 
  protected:
-  InfoStateUvm<T> local_info_map_;
+  // The slot of `decision_point`'s info set in `store_`, or `kNoSlot` if it
+  // does not exist.
+  size_t Find(const DecisionPoint& decision_point) const {
+    if (decision_point.InfoSetIdSpace() == id_space_ &&
+        decision_point.PlayerToAct() == id_player_) {
+      const size_t id = decision_point.InfoSetId();
+      if (id < slot_by_id_.size() && slot_by_id_[id] != kNoSlot) {
+        return slot_by_id_[id];
+      }
+    }
+    const auto iter =
+        slot_by_key_.find(decision_point.InformationStateStringRef());
+    return iter == slot_by_key_.end() ? kNoSlot : iter->second;
+  }
+
+  // Binds info set IDs to `player`'s info sets in `info_set_id_space`. IDs
+  // bound to any other space are forgotten, since they may refer to other
+  // info sets.
+  void BindInfoSetIds(size_t info_set_id_space, open_spiel::Player player) {
+    if (info_set_id_space != id_space_ || player != id_player_) {
+      slot_by_id_.clear();
+      id_space_ = info_set_id_space;
+      id_player_ = player;
+    }
+  }
+
+  // Finds the slot of the info set with the given ID in the bound space,
+  // adding it to `store_` with `args` if it does not exist. The key is only
+  // hashed the first time an ID is seen since the space was bound.
+  template <class... Args>
+  size_t GetOrCreate(size_t info_set_id, const std::string& info_state,
+                     Args... args) {
+    if (id_space_ == 0) {
+      return GetOrCreateByKey(info_state, args...);
+    }
+    if (slot_by_id_.size() <= info_set_id) {
+      slot_by_id_.resize(info_set_id + 1, kNoSlot);
+    }
+    size_t& slot = slot_by_id_[info_set_id];
+    if (slot == kNoSlot) {
+      slot = GetOrCreateByKey(info_state, args...);
+    }
+    return slot;
+  }
+
+ protected:
+  static constexpr size_t kNoSlot = std::numeric_limits<size_t>::max();
+
+  Store store_;
+  InfoStateUvm<size_t> slot_by_key_;
+  // Zero if no space is bound, in which case `slot_by_id_` is empty.
+  size_t id_space_;
+  open_spiel::Player id_player_;
+  std::vector<size_t> slot_by_id_;
+
+ private:
+  template <class... Args>
+  size_t GetOrCreateByKey(const std::string& info_state, Args... args) {
+    const size_t slot =
+        slot_by_key_.try_emplace(info_state, store_.Size()).first->second;
+    if (slot == store_.Size()) {
+      store_.Add(args...);
+    }
+    return slot;
+  }
 };
 
 template <class DeviationSequencePredecessors>
 // Concept DeviationSequencePredecessors requires
-// virtual std::vector<double> ExternalPredecessorReachProbs(
-//     const std::vector<double>& pred_reach_probs) const;
-// virtual std::vector<double> InternalPredecessorReachProbs(
-//     const std::vector<double>& pred_reach_probs) const;
-// virtual std::vector<double> SuccessorReachProbs(
-//     const std::vector<double>& pred_reach_probs, const double* strat,
-//     size_t num_actions, size_t action) const;
+// size_t NumExternalPredecessorReachProbs(size_t num_pred_reach_probs) const;
+// void ExternalPredecessorReachProbs(
+//     absl::Span<const double> pred_reach_probs, double* out) const;
+// size_t NumInternalPredecessorReachProbs(size_t num_pred_reach_probs) const;
+// void InternalPredecessorReachProbs(
+//     absl::Span<const double> pred_reach_probs, double* out) const;
+// size_t NumSuccessorReachProbs(size_t num_pred_reach_probs,
+//                               size_t num_actions) const;
+// void SuccessorReachProbs(absl::Span<const double> pred_reach_probs,
+//                          const double* strat, size_t num_actions,
+//                          size_t action, double* out) const;
+// where each `out` holds as many values as the matching `Num` function
+// returns.
 class BehavioralDeviationTabularCfvLearner
     : public CfValueTreeLearner,
-      public TabularResponder<_tl::ImmediateDecisionInfo> {
+      public TabularResponder<_tl::DecisionInfoStore> {
  public:
   template <class... Args>
   static std::vector<CfValueTreeLearnerPtr> NewList(
@@ -333,18 +515,6 @@ class BehavioralDeviationTabularCfvLearner
         num_players, DeviationSequencePredecessors(), args...);
   }
 
- private:
-  struct StackState {
-    const std::string* info_state_string_;
-    const _tl::ReachProbLists* reach_prob_lists_;
-
-    void Reset(const std::string* info_state_string,
-               const _tl::ReachProbLists* reach_prob_lists) {
-      info_state_string_ = info_state_string;
-      reach_prob_lists_ = reach_prob_lists;
-    }
-  };
-
  public:
   BehavioralDeviationTabularCfvLearner(
       DeviationSequencePredecessors dev_seq_predecessors,
@@ -352,86 +522,119 @@ class BehavioralDeviationTabularCfvLearner
       : TabularResponder(),
         update_target_(std::move(update_target)),
         f_(std::move(f)),
-        dev_seq_predecessors_(std::move(dev_seq_predecessors)) {}
+        dev_seq_predecessors_(std::move(dev_seq_predecessors)),
+        plan_topology_id_(0),
+        node_slots_(),
+        node_inputs_(),
+        node_outputs_(),
+        list_offsets_(),
+        list_sizes_(),
+        reach_probs_(),
+        ex_reach_probs_(),
+        in_reach_probs_(),
+        level_order_(),
+        level_begins_(),
+        policy_offsets_(),
+        prev_policies_(),
+        phi_sums_(),
+        node_phi_sums_(),
+        batches_() {}
   virtual ~BehavioralDeviationTabularCfvLearner() = default;
 
-  void Update(
-      const std::vector<std::string>& initial_info_states,
-      const InfoStateUvm<CfValueTreeNode>& cf_value_tree) override final {
-    std::vector<StackState> state_stack(cf_value_tree.size());
-    const auto initial_reach_prob_lists = new _tl::ReachProbLists{{1.0}, {1.0}};
-    int stack_idx = 0;
-    for (; stack_idx < initial_info_states.size(); ++stack_idx) {
-      state_stack[stack_idx].Reset(&(initial_info_states[stack_idx]),
-                                   initial_reach_prob_lists);
+  // Sweeps the tree one level at a time, where a node's level is the number
+  // of nodes with more than one action above it. Nodes on the same level do
+  // not depend on each other, so their new policies are solved in batches
+  // by number of actions, and their children's predecessor reach
+  // probabilities are ready when the next level is reached.
+  void Update(const CfValueTree& cf_value_tree) override final {
+    if (cf_value_tree.topology_id_ != plan_topology_id_) {
+      Plan(cf_value_tree);
     }
-    --stack_idx;
-    std::vector<_tl::ReachProbLists*> all_reach_prob_lists = {
-        initial_reach_prob_lists};
-    all_reach_prob_lists.reserve(cf_value_tree.size());
-
-    while (stack_idx >= 0) {
-      const auto [info_state_string_ptr, pred_reach_probs] =
-          state_stack[stack_idx];
-      --stack_idx;
-
-      const auto& [cf_values, child_keys] =
-          cf_value_tree.at(*info_state_string_ptr);
-      const size_t num_actions = cf_values.Size();
-
-      if (num_actions < 2) {
-        for (size_t child_idx = 0; child_idx < child_keys[0].size();
-             ++child_idx) {
-          ++stack_idx;
-          state_stack[stack_idx].Reset(&(child_keys[0][child_idx]),
-                                       pred_reach_probs);
+    BindInfoSetIds(cf_value_tree.info_set_id_space_, cf_value_tree.player_);
+    for (size_t level = 0; level + 1 < level_begins_.size(); ++level) {
+      const size_t begin = level_begins_[level];
+      const size_t end = level_begins_[level + 1];
+      for (size_t i = begin; i < end; ++i) {
+        const size_t node_idx = level_order_[i];
+        const auto& [cf_values, children, info_set_id] =
+            cf_value_tree.nodes_[node_idx];
+        const size_t num_actions = cf_values.Size();
+        const _tl::ReachProbLists pred_reach_probs =
+            Lists(node_inputs_[node_idx]);
+        const size_t num_ex =
+            dev_seq_predecessors_.NumExternalPredecessorReachProbs(
+                pred_reach_probs.Size());
+        double* const ex_prev = ex_reach_probs_.data();
+        dev_seq_predecessors_.ExternalPredecessorReachProbs(
+            pred_reach_probs.Prev(), ex_prev);
+        dev_seq_predecessors_.ExternalPredecessorReachProbs(
+            pred_reach_probs.Next(), ex_prev + num_ex);
+        const _tl::ReachProbLists ex_reach_probs = {ex_prev, ex_prev + num_ex,
+                                                    num_ex};
+        const size_t num_in =
+            dev_seq_predecessors_.NumInternalPredecessorReachProbs(
+                pred_reach_probs.Size());
+        double* const in_prev = in_reach_probs_.data();
+        dev_seq_predecessors_.InternalPredecessorReachProbs(
+            pred_reach_probs.Prev(), in_prev);
+        dev_seq_predecessors_.InternalPredecessorReachProbs(
+            pred_reach_probs.Next(), in_prev + num_in);
+        const _tl::ReachProbLists in_reach_probs = {in_prev, in_prev + num_in,
+                                                    num_in};
+
+        size_t& slot = node_slots_[node_idx];
+        if (slot == kNoSlot) {
+          slot = GetOrCreate(info_set_id, cf_value_tree.keys_[node_idx],
+                             num_actions, ex_reach_probs.Size(),
+                             in_reach_probs.Size());
         }
-        continue;
+        store_.Response(slot,
+                        prev_policies_.data() + policy_offsets_[node_idx]);
+        store_.UpdateRegrets(slot, cf_values, update_target_, f_,
+                             ex_reach_probs, in_reach_probs,
+                             phi_sums_[num_actions][node_phi_sums_[node_idx]]);
       }
-      const _tl::ReachProbLists ex_reach_probs = {
-          dev_seq_predecessors_.ExternalPredecessorReachProbs(
-              pred_reach_probs->prev_),
-          dev_seq_predecessors_.ExternalPredecessorReachProbs(
-              pred_reach_probs->next_)};
-      const _tl::ReachProbLists in_reach_probs = {
-          dev_seq_predecessors_.InternalPredecessorReachProbs(
-              pred_reach_probs->prev_),
-          dev_seq_predecessors_.InternalPredecessorReachProbs(
-              pred_reach_probs->next_)};
-
-      auto& local_decision_info = GetOrCreateFromArgs(
-          local_info_map_, *info_state_string_ptr, num_actions,
-          ex_reach_probs.Size(), in_reach_probs.Size());
-
-      double prev_policy[num_actions];
-      local_decision_info.Response(prev_policy);
-
-      local_decision_info.Update(cf_values, update_target_, f_, ex_reach_probs,
-                                 in_reach_probs);
-
-      double next_policy[num_actions];
-      local_decision_info.Response(next_policy);
-      for (size_t a = 0; a < num_actions; ++a) {
-        if (child_keys[a].size() < 1) {
-          continue;
-        }
-        const auto successor_reach_prob_lists = new _tl::ReachProbLists{
-            dev_seq_predecessors_.SuccessorReachProbs(
-                pred_reach_probs->prev_, prev_policy, num_actions, a),
-            dev_seq_predecessors_.SuccessorReachProbs(
-                pred_reach_probs->next_, next_policy, num_actions, a)};
-        for (size_t child_idx = 0; child_idx < child_keys[a].size();
-             ++child_idx) {
-          ++stack_idx;
-          state_stack[stack_idx].Reset(&(child_keys[a][child_idx]),
-                                       successor_reach_prob_lists);
+      // Only once `store_` has stopped growing for this level.
+      for (size_t i = begin; i < end; ++i) {
+        const size_t node_idx = level_order_[i];
+        const size_t num_actions =
+            cf_value_tree.nodes_[node_idx].children_.size();
+        batches_[num_actions].Add(
+            phi_sums_[num_actions][node_phi_sums_[node_idx]],
+            store_.Policy(node_slots_[node_idx]));
+      }
+      for (auto& batch : batches_) {
+        batch.Solve();
+      }
+      for (size_t i = begin; i < end; ++i) {
+        const size_t node_idx = level_order_[i];
+        const auto& children = cf_value_tree.nodes_[node_idx].children_;
+        const size_t num_actions = children.size();
+        const size_t slot = node_slots_[node_idx];
+        store_.FinishUpdate(slot);
+        phi_sums_[num_actions][node_phi_sums_[node_idx]].Reset();
+
+        const double* prev_policy =
+            prev_policies_.data() + policy_offsets_[node_idx];
+        const double* next_policy = store_.Policy(slot);
+        const _tl::ReachProbLists pred_reach_probs =
+            Lists(node_inputs_[node_idx]);
+        for (size_t a = 0; a < num_actions; ++a) {
+          if (children[a].size() < 1) {
+            continue;
+          }
+          const size_t list = node_outputs_[node_idx] + a;
+          double* const successor_prev =
+              reach_probs_.data() + list_offsets_[list];
+          dev_seq_predecessors_.SuccessorReachProbs(
+              pred_reach_probs.Prev(), prev_policy, num_actions, a,
+              successor_prev);
+          dev_seq_predecessors_.SuccessorReachProbs(
+              pred_reach_probs.Next(), next_policy, num_actions, a,
+              successor_prev + list_sizes_[list]);
         }
-        all_reach_prob_lists.push_back(successor_reach_prob_lists);
       }
     }
-    for (auto ptr : all_reach_prob_lists) {
-      delete ptr;
-    }
   }
   CfValueTreeLearnerPtr Clone() const override final {
     return CfValueTreeLearnerPtr(
@@ -442,6 +645,150 @@ class BehavioralDeviationTabularCfvLearner
   const _tl::RegretTransformation update_target_;
   const _tl::LinkFn f_;
   const DeviationSequencePredecessors dev_seq_predecessors_;
+
+  _tl::ReachProbLists Lists(size_t list) const {
+    const double* prev = reach_probs_.data() + list_offsets_[list];
+    return {prev, prev + list_sizes_[list], list_sizes_[list]};
+  }
+
+  // Assigns each node the reach probability lists that it reads and writes,
+  // and where each list is kept in `reach_probs_`. List 0 is for roots and
+  // each node with more than one action writes one list per action, which
+  // its children under that action read. A node with one action passes its
+  // own list on.
+  void Plan(const CfValueTree& cf_value_tree) {
+    const size_t num_nodes = cf_value_tree.Size();
+    node_slots_.assign(num_nodes, kNoSlot);
+    node_inputs_.assign(num_nodes, 0);
+    node_outputs_.assign(num_nodes, 0);
+    policy_offsets_.assign(num_nodes, 0);
+    std::vector<size_t> node_levels(num_nodes, 0);
+    // The root list holds one reach probability before and after the
+    // update.
+    list_offsets_.assign(1, 0);
+    list_sizes_.assign(1, 1);
+    size_t num_lists = 1;
+    size_t num_reach_probs = 2;
+    size_t max_num_ex = 0;
+    size_t max_num_in = 0;
+    size_t num_policy_entries = 0;
+    size_t num_levels = 0;
+    for (size_t node_idx = 0; node_idx < num_nodes; ++node_idx) {
+      const auto& children = cf_value_tree.nodes_[node_idx].children_;
+      const size_t num_actions = children.size();
+      if (num_actions < 2) {
+        for (const size_t child : children[0]) {
+          SPIEL_CHECK_GT(child, node_idx);
+          node_inputs_[child] = node_inputs_[node_idx];
+          node_levels[child] = node_levels[node_idx];
+        }
+        continue;
+      }
+      const size_t num_pred_reach_probs = list_sizes_[node_inputs_[node_idx]];
+      max_num_ex = std::max(
+          max_num_ex, dev_seq_predecessors_.NumExternalPredecessorReachProbs(
+                          num_pred_reach_probs));
+      max_num_in = std::max(
+          max_num_in, dev_seq_predecessors_.NumInternalPredecessorReachProbs(
+                          num_pred_reach_probs));
+      const size_t num_successor_reach_probs =
+          dev_seq_predecessors_.NumSuccessorReachProbs(num_pred_reach_probs,
+                                                       num_actions);
+      node_outputs_[node_idx] = num_lists;
+      for (size_t a = 0; a < num_actions; ++a) {
+        for (const size_t child : children[a]) {
+          SPIEL_CHECK_GT(child, node_idx);
+          node_inputs_[child] = num_lists + a;
+          node_levels[child] = node_levels[node_idx] + 1;
+        }
+        list_offsets_.push_back(num_reach_probs);
+        list_sizes_.push_back(num_successor_reach_probs);
+        num_reach_probs += 2 * num_successor_reach_probs;
+      }
+      num_lists += num_actions;
+      policy_offsets_[node_idx] = num_policy_entries;
+      num_policy_entries += num_actions;
+      num_levels = std::max(num_levels, node_levels[node_idx] + 1);
+      while (batches_.size() <= num_actions) {
+        phi_sums_.emplace_back();
+        batches_.emplace_back(batches_.size());
+      }
+    }
+    reach_probs_.resize(num_reach_probs);
+    reach_probs_[0] = 1.0;
+    reach_probs_[1] = 1.0;
+    ex_reach_probs_.resize(2 * max_num_ex);
+    in_reach_probs_.resize(2 * max_num_in);
+    prev_policies_.resize(num_policy_entries);
+
+    // Counting sort of the nodes with more than one action by level.
+    level_begins_.assign(num_levels + 1, 0);
+    for (size_t node_idx = 0; node_idx < num_nodes; ++node_idx) {
+      if (cf_value_tree.nodes_[node_idx].children_.size() > 1) {
+        ++level_begins_[node_levels[node_idx] + 1];
+      }
+    }
+    for (size_t level = 0; level < num_levels; ++level) {
+      level_begins_[level + 1] += level_begins_[level];
+    }
+    level_order_.resize(level_begins_[num_levels]);
+    std::vector<size_t> next_position(level_begins_.begin(),
+                                      level_begins_.end() - 1);
+    for (size_t node_idx = 0; node_idx < num_nodes; ++node_idx) {
+      if (cf_value_tree.nodes_[node_idx].children_.size() > 1) {
+        level_order_[next_position[node_levels[node_idx]]++] = node_idx;
+      }
+    }
+
+    // Each node on a level needs its own sum until the level is solved.
+    node_phi_sums_.assign(num_nodes, 0);
+    std::vector<size_t> num_sums(phi_sums_.size());
+    for (size_t level = 0; level < num_levels; ++level) {
+      std::fill(num_sums.begin(), num_sums.end(), 0);
+      for (size_t i = level_begins_[level]; i < level_begins_[level + 1];
+           ++i) {
+        const size_t node_idx = level_order_[i];
+        const size_t num_actions =
+            cf_value_tree.nodes_[node_idx].children_.size();
+        node_phi_sums_[node_idx] = num_sums[num_actions]++;
+        auto& sums = phi_sums_[num_actions];
+        if (sums.size() < num_sums[num_actions]) {
+          sums.emplace_back(num_actions);
+        }
+      }
+    }
+    plan_topology_id_ = cf_value_tree.topology_id_;
+  }
+
+  // The plan for the tree topology with this ID.
+  size_t plan_topology_id_;
+  // Each node's slot in `store_`, or `kNoSlot` until it is first updated.
+  std::vector<size_t> node_slots_;
+  std::vector<size_t> node_inputs_;
+  std::vector<size_t> node_outputs_;
+  // Each list's reach probabilities before the update are at its offset in
+  // `reach_probs_` and those after it follow immediately.
+  std::vector<size_t> list_offsets_;
+  std::vector<size_t> list_sizes_;
+  std::vector<double> reach_probs_;
+  // The lists of the node being updated that its external and internal
+  // deviations use.
+  std::vector<double> ex_reach_probs_;
+  std::vector<double> in_reach_probs_;
+  // The nodes with more than one action, level by level. Level `l` is
+  // `level_order_[level_begins_[l]]` up to `level_order_[level_begins_[l +
+  // 1]]`.
+  std::vector<size_t> level_order_;
+  std::vector<size_t> level_begins_;
+  // Where each node's policy before the update is kept in `prev_policies_`.
+  std::vector<size_t> policy_offsets_;
+  std::vector<double> prev_policies_;
+  // Indexed by number of actions. `node_phi_sums_` is each node's index
+  // into `phi_sums_[num_actions]`, which is shared by nodes on different
+  // levels.
+  std::vector<std::vector<WeightedActionTransformation>> phi_sums_;
+  std::vector<size_t> node_phi_sums_;
+  std::vector<FixedPointBatch> batches_;
 };
 
 }  // namespace hr_edl
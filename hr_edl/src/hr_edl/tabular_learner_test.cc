@@ -0,0 +1,331 @@
+#include "hr_edl/tabular_learner.h"
+
+#include <memory>
+
+#include "open_spiel/spiel.h"
+#include "open_spiel/spiel_utils.h"
+#include "hr_edl/decision_point.h"
+#include "hr_edl/policy_evaluation.h"
+#include "hr_edl/samplers.h"
+#include "hr_edl/test_extra.h"
+
+namespace hr_edl {
+namespace test {
+namespace {
+
+double RmUpdate(double prev_regret, double next_regret, size_t _) {
+  return next_regret;
+}
+double LinearUpdate(double prev_regret, double next_regret,
+                    size_t round_number) {
+  return round_number * next_regret;
+}
+void RmLink(const std::vector<double>& regrets,
+            const EnumerationConsumer<double>& yield) {
+  for (size_t i = 0; i < regrets.size(); ++i) {
+    yield(i, Relu(regrets[i]));
+  }
+}
+
+// One info set of `ReferenceLearner`, which owns its policy, regrets, and
+// transformation sum.
+class ReferenceDecisionInfo {
+ public:
+  ReferenceDecisionInfo(size_t num_actions, size_t ex_num_pred_reach_probs,
+                        size_t in_num_pred_reach_probs)
+      : policy_(num_actions, 1.0 / num_actions),
+        round_number_(1),
+        ex_regrets_(num_actions * ex_num_pred_reach_probs, 0),
+        in_regrets_(num_actions * (num_actions - 1) * in_num_pred_reach_probs,
+                    0),
+        phi_sum_(num_actions) {}
+
+  const std::vector<double>& Policy() const { return policy_; }
+
+  void Update(const CfValues& cfvs,
+              const _tl::RegretTransformation& update_target,
+              const _tl::LinkFn& f,
+              const _tl::ReachProbLists& ex_pred_reach_prob_lists,
+              const _tl::ReachProbLists& in_pred_reach_prob_lists) {
+    const size_t num_actions = policy_.size();
+    if (ex_pred_reach_prob_lists.Size() > 0) {
+      std::vector<double> phi_regrets(num_actions);
+      ExternalRegrets(cfvs, policy_.data(), phi_regrets.data());
+      UpdatePhiSetRegrets(ex_regrets_, phi_regrets, update_target, f,
+                          ex_pred_reach_prob_lists,
+                          [this](size_t phi_idx, double weight) {
+                            phi_sum_.AddExternal(phi_idx, weight);
+                          });
+    }
+    if (in_pred_reach_prob_lists.Size() > 0) {
+      std::vector<double> phi_regrets(num_actions * (num_actions - 1));
+      InternalRegrets(cfvs, policy_.data(), phi_regrets.data());
+      UpdatePhiSetRegrets(
+          in_regrets_, phi_regrets, update_target, f, in_pred_reach_prob_lists,
+          [this, num_actions](size_t phi_idx, double weight) {
+            const size_t from = phi_idx / (num_actions - 1);
+            const size_t to = phi_idx % (num_actions - 1);
+            phi_sum_.AddInternal(from, to < from ? to : to + 1, weight);
+          });
+    }
+    phi_sum_.FixedPoint(policy_);
+    phi_sum_.Reset();
+    ++round_number_;
+  }
+
+ private:
+  template <class AddPhi>
+  void UpdatePhiSetRegrets(std::vector<double>& regrets,
+                           const std::vector<double>& phi_regrets,
+                           const _tl::RegretTransformation& update_target,
+                           const _tl::LinkFn& f,
+                           const _tl::ReachProbLists& pred_reach_prob_lists,
+                           const AddPhi& add_phi) {
+    const size_t num_reach_probs = pred_reach_prob_lists.Size();
+    size_t idx = 0;
+    for (const double regret : phi_regrets) {
+      for (size_t j = 0; j < num_reach_probs; ++j) {
+        regrets[idx] +=
+            update_target(regrets[idx], pred_reach_prob_lists.prev_[j] * regret,
+                          round_number_);
+        ++idx;
+      }
+    }
+    std::vector<double> sums(phi_regrets.size(), 0);
+    f(regrets, [&](size_t regret_idx, double link_output) {
+      sums[regret_idx / num_reach_probs] +=
+          pred_reach_prob_lists.next_[regret_idx % num_reach_probs] *
+          link_output;
+    });
+    for (size_t i = 0; i < sums.size(); ++i) {
+      add_phi(i, sums[i]);
+    }
+  }
+
+  std::vector<double> policy_;
+  size_t round_number_;
+  std::vector<double> ex_regrets_;
+  std::vector<double> in_regrets_;
+  WeightedActionTransformation phi_sum_;
+};
+
+// Reach probability lists that own their values.
+struct OwnedReachProbLists {
+  std::vector<double> prev_;
+  std::vector<double> next_;
+
+  _tl::ReachProbLists View() const {
+    return {prev_.data(), next_.data(), prev_.size()};
+  }
+};
+
+// `BehavioralDeviationTabularCfvLearner` as a depth-first walk that keeps
+// each info set in its own map entry.
+template <class DeviationSequencePredecessors>
+class ReferenceLearner : public Policy {
+ public:
+  ReferenceLearner(_tl::RegretTransformation&& update_target, _tl::LinkFn&& f)
+      : update_target_(std::move(update_target)),
+        f_(std::move(f)),
+        dev_seq_predecessors_(),
+        infos_() {}
+
+  std::vector<double> Response(
+      const open_spiel::State& state) const override final {
+    const auto iter = infos_.find(state.InformationStateString());
+    if (iter != infos_.end()) {
+      return iter->second.Policy();
+    }
+    const int n = state.LegalActions().size();
+    return std::vector<double>(n, 1.0 / n);
+  }
+  std::vector<double> Response(
+      const DecisionPoint& decision_point) const override final {
+    const auto iter = infos_.find(decision_point.InformationStateStringRef());
+    if (iter != infos_.end()) {
+      return iter->second.Policy();
+    }
+    const int n = decision_point.NumActions();
+    return std::vector<double>(n, 1.0 / n);
+  }
+
+  void Update(const CfValueTree& cf_value_tree) {
+    using ReachProbListsPtr = std::shared_ptr<const OwnedReachProbLists>;
+    std::vector<std::pair<size_t, ReachProbListsPtr>> stack;
+    const auto initial_reach_prob_lists =
+        std::make_shared<const OwnedReachProbLists>(
+            OwnedReachProbLists{{1.0}, {1.0}});
+    for (const size_t root : cf_value_tree.roots_) {
+      stack.emplace_back(root, initial_reach_prob_lists);
+    }
+    while (!stack.empty()) {
+      const auto [node_idx, pred_reach_probs] = stack.back();
+      stack.pop_back();
+      const auto& [cf_values, children, _] = cf_value_tree.nodes_[node_idx];
+      const size_t num_actions = cf_values.Size();
+      if (num_actions < 2) {
+        for (const size_t child : children[0]) {
+          stack.emplace_back(child, pred_reach_probs);
+        }
+        continue;
+      }
+      const OwnedReachProbLists ex_reach_probs = {
+          External(pred_reach_probs->prev_), External(pred_reach_probs->next_)};
+      const OwnedReachProbLists in_reach_probs = {
+          Internal(pred_reach_probs->prev_), Internal(pred_reach_probs->next_)};
+      auto& info = infos_
+                       .try_emplace(cf_value_tree.keys_[node_idx], num_actions,
+                                    ex_reach_probs.prev_.size(),
+                                    in_reach_probs.prev_.size())
+                       .first->second;
+      const std::vector<double> prev_policy = info.Policy();
+      info.Update(cf_values, update_target_, f_, ex_reach_probs.View(),
+                  in_reach_probs.View());
+      const std::vector<double>& next_policy = info.Policy();
+      for (size_t a = 0; a < num_actions; ++a) {
+        if (children[a].empty()) {
+          continue;
+        }
+        const auto successor_reach_probs =
+            std::make_shared<const OwnedReachProbLists>(OwnedReachProbLists{
+                Successor(pred_reach_probs->prev_, prev_policy, a),
+                Successor(pred_reach_probs->next_, next_policy, a)});
+        for (const size_t child : children[a]) {
+          stack.emplace_back(child, successor_reach_probs);
+        }
+      }
+    }
+  }
+
+ private:
+  std::vector<double> External(const std::vector<double>& pred) const {
+    std::vector<double> out(
+        dev_seq_predecessors_.NumExternalPredecessorReachProbs(pred.size()));
+    dev_seq_predecessors_.ExternalPredecessorReachProbs(pred, out.data());
+    return out;
+  }
+  std::vector<double> Internal(const std::vector<double>& pred) const {
+    std::vector<double> out(
+        dev_seq_predecessors_.NumInternalPredecessorReachProbs(pred.size()));
+    dev_seq_predecessors_.InternalPredecessorReachProbs(pred, out.data());
+    return out;
+  }
+  std::vector<double> Successor(const std::vector<double>& pred,
+                                const std::vector<double>& policy,
+                                size_t action) const {
+    std::vector<double> out(dev_seq_predecessors_.NumSuccessorReachProbs(
+        pred.size(), policy.size()));
+    dev_seq_predecessors_.SuccessorReachProbs(pred, policy.data(),
+                                              policy.size(), action,
+                                              out.data());
+    return out;
+  }
+
+ private:
+  const _tl::RegretTransformation update_target_;
+  const _tl::LinkFn f_;
+  const DeviationSequencePredecessors dev_seq_predecessors_;
+  InfoStateUvm<ReferenceDecisionInfo> infos_;
+};
+
+void CheckSameResponses(const Policy& expected, const Policy& actual,
+                        DecisionPoint& decision_point) {
+  if (decision_point.IsTerminal()) {
+    return;
+  }
+  if (decision_point.PlayerToAct() >= 0) {
+    const std::vector<double> expected_response =
+        expected.Response(decision_point);
+    const std::vector<double> actual_response = actual.Response(decision_point);
+    SPIEL_CHECK_EQ(actual_response.size(), expected_response.size());
+    for (size_t a = 0; a < actual_response.size(); ++a) {
+      SPIEL_CHECK_FLOAT_NEAR(actual_response[a], expected_response[a], 1e-12);
+    }
+  }
+  for (size_t a = 0; a < decision_point.NumActions(); ++a) {
+    for (size_t outcome = 0; outcome < decision_point.NumOutcomes(a);
+         ++outcome) {
+      decision_point.Apply(a, outcome);
+      CheckSameResponses(expected, actual, decision_point);
+      decision_point.Undo();
+    }
+  }
+}
+
+using UpdateFn = double (*)(double, double, size_t);
+
+template <class DeviationSequencePredecessors>
+void LearnerMatchesReference(const std::string& game_name,
+                             UpdateFn update_target) {
+  CachedDecisionPoint root(open_spiel::LoadGame(game_name)->NewInitialState());
+  NullSampler full_walk;
+  std::vector<CfValueTreeLearnerPtr> learners =
+      BehavioralDeviationTabularCfvLearner<DeviationSequencePredecessors>::
+          NewList(root.NumPlayers(), update_target, RmLink);
+  std::vector<ReferenceLearner<DeviationSequencePredecessors>> references;
+  std::vector<PolicyCfValueTreeEvaluator> evaluators;
+  for (int player = 0; player < root.NumPlayers(); ++player) {
+    references.emplace_back(update_target, RmLink);
+    evaluators.emplace_back(player);
+  }
+  for (int t = 0; t < 5; ++t) {
+    for (int player = 0; player < root.NumPlayers(); ++player) {
+      const auto [v, cf_value_tree, _] =
+          evaluators[player].ComputeCfValueTreeEvaluation(
+              root, PolicyRefProfile(learners), full_walk);
+      learners[player]->Update(*cf_value_tree);
+      references[player].Update(*cf_value_tree);
+      CheckSameResponses(references[player], *learners[player], root);
+    }
+  }
+}
+
+// Info set IDs from one tree must not be used to look up info sets in
+// another, even when the learner was last updated on the other tree.
+void LearnerFollowsInfoSetIdSpaces() {
+  CachedDecisionPoint leduc(
+      open_spiel::LoadGame("leduc_poker")->NewInitialState());
+  CachedDecisionPoint kuhn(
+      open_spiel::LoadGame("kuhn_poker")->NewInitialState());
+  NullSampler full_walk;
+  const MapPolicy uniform = UniformRandomPolicy();
+  BehavioralDeviationTabularCfvLearner<CausalPartialSequencePredecessors>
+      learner(CausalPartialSequencePredecessors(), RmUpdate, RmLink);
+  ReferenceLearner<CausalPartialSequencePredecessors> reference(RmUpdate,
+                                                                RmLink);
+  PolicyCfValueTreeEvaluator evaluator(0);
+  for (DecisionPoint* root : {static_cast<DecisionPoint*>(&leduc),
+                              static_cast<DecisionPoint*>(&kuhn),
+                              static_cast<DecisionPoint*>(&leduc),
+                              static_cast<DecisionPoint*>(&kuhn)}) {
+    const auto [v, cf_value_tree, _] = evaluator.ComputeCfValueTreeEvaluation(
+        *root, PolicyRefProfile({&learner, &uniform}), full_walk);
+    learner.Update(*cf_value_tree);
+    reference.Update(*cf_value_tree);
+    CheckSameResponses(reference, learner, leduc);
+    CheckSameResponses(reference, learner, kuhn);
+  }
+}
+}  // namespace
+}  // namespace test
+}  // namespace hr_edl
+
+using namespace hr_edl;
+using namespace hr_edl::test;
+
+int main(int argc, char** argv) {
+  for (const std::string game_name : {"kuhn_poker", "leduc_poker"}) {
+    RUN_TEST(LearnerMatchesReference<ImmediateExternalSequencePredecessors>,
+             game_name, RmUpdate);
+    RUN_TEST(LearnerMatchesReference<ImmediateExInSequencePredecessors>,
+             game_name, LinearUpdate);
+    RUN_TEST(LearnerMatchesReference<BehavioralPredecessors>, game_name,
+             RmUpdate);
+    RUN_TEST(LearnerMatchesReference<CausalPartialSequencePredecessors>,
+             game_name, LinearUpdate);
+    RUN_TEST(LearnerMatchesReference<
+                 TwiceInformedPartialSequenceExInPredecessors>,
+             game_name, RmUpdate);
+  }
+  RUN_TEST(LearnerFollowsInfoSetIdSpaces);
+}
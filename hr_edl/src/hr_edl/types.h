@@ -1,6 +1,7 @@
 #ifndef HR_EDL_TYPES_H_
 #define HR_EDL_TYPES_H_
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -21,6 +22,7 @@ struct CfValues {
   CfValues() = default;
   CfValues(CfValues&&) = default;
   CfValues(const CfValues&) = default;
+  CfValues& operator=(const CfValues&) = default;
   CfValues(std::pair<CfActionValues, Cfv>&& pair) : v_(std::move(pair.first)), ev_(pair.second) {}
   CfValues(CfActionValues&& v, Cfv ev) : v_(std::move(v)), ev_(ev) {}
   CfValues(const CfActionValues& v, Cfv ev) : v_(v), ev_(ev) {}
@@ -84,13 +86,64 @@ template <class T>
 using ActionsAndValues = std::vector<std::pair<open_spiel::Action, T>>;
 
 struct CfValueTreeNode {
-  CfValueTreeNode(size_t num_actions)
+  CfValueTreeNode(size_t num_actions, size_t info_set_id = 0)
       : cf_values_(num_actions),
-        child_keys_(num_actions, std::vector<std::string>()) {}
+        children_(num_actions, std::vector<size_t>()),
+        info_set_id_(info_set_id) {}
 
   void Reset() { cf_values_.Reset(); }
   CfValues cf_values_;
-  std::vector<std::vector<std::string>> child_keys_;
+  // Indices into `CfValueTree::nodes_` of the nodes under each action.
+  std::vector<std::vector<size_t>> children_;
+  size_t info_set_id_;
+};
+
+// Nodes are stored contiguously and link to their children by index. Info
+// state strings are only kept to look nodes up from outside the tree.
+struct CfValueTree {
+  size_t Size() const { return nodes_.size(); }
+  const CfValueTreeNode& At(const std::string& info_state) const {
+    return nodes_[index_by_key_.at(info_state)];
+  }
+  size_t AddNode(const std::string& info_state, size_t num_actions,
+                 size_t info_set_id) {
+    const size_t idx = nodes_.size();
+    nodes_.emplace_back(num_actions, info_set_id);
+    keys_.push_back(info_state);
+    index_by_key_.emplace(info_state, idx);
+    topology_id_ = NewTopologyId();
+    return idx;
+  }
+  void Clear() {
+    nodes_.clear();
+    keys_.clear();
+    roots_.clear();
+    index_by_key_.clear();
+    info_set_id_space_ = 0;
+    player_ = open_spiel::kInvalidPlayer;
+    topology_id_ = NewTopologyId();
+  }
+  // Unique across trees, so a learner can tell whether a tree has the same
+  // nodes and links as one it has seen before.
+  static size_t NewTopologyId() {
+    static std::atomic<size_t> next_id(1);
+    return next_id++;
+  }
+
+  std::vector<CfValueTreeNode> nodes_;
+  std::vector<std::string> keys_;
+  // The nodes that are not below any other node.
+  std::vector<size_t> roots_;
+  InfoStateUvm<size_t> index_by_key_;
+  // The `DecisionPoint::InfoSetIdSpace` of the nodes' info set IDs, or zero
+  // if it is unknown.
+  size_t info_set_id_space_ = 0;
+  // The player who acts at every node. Info set IDs are only unique per
+  // player.
+  open_spiel::Player player_ = open_spiel::kInvalidPlayer;
+  // Changes whenever a node is added or the tree is cleared. Links are only
+  // set when a node is added.
+  size_t topology_id_ = 0;
 };
 }  // namespace hr_edl
 
@@ -71,12 +71,14 @@ class ExperimentParameters():
   def num_iterations(self):
     return NUM_ITERATIONS_MAP[self.game_tag]
 
-  def command(self, exe_dir, sif):
+  def command(self, exe_dir, sif, tree_cache_dir=None):
     flags = [
         f'--game "{self.game()}"',
         f'--t {self.num_iterations()}',
         f'--alg_group 1'
     ]
+    if tree_cache_dir:
+        flags.append(f'--tree_cache_dir "{tree_cache_dir}"')
     executable_name = 'run_simultaneous_ltbr' if self.mode == 'sim' else 'run_fixed_ltbr'
     exe = exe_dir + '/' + executable_name
     if sif: